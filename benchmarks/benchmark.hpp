@@ -0,0 +1,142 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_BENCHMARKS_BENCHMARK_HPP
+#define NDNSD_BENCHMARKS_BENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ndnsd {
+namespace benchmark {
+
+/**
+  @brief Minimal harness for machine-readable benchmarks
+
+  Each case is run in batches of doubling size until a batch lasts at least the minimum
+  time, then timed over REPETITIONS such batches; the fastest one is reported. One line
+  is written per case, as JSON (default) or CSV:
+
+    {"benchmark":"details-encode","params":"meta=16","items":1,"iterations":65536,
+     "ns_per_item":812.4,"items_per_second":1230921}
+
+  Options: --csv, --filter=<substring of "benchmark/params">, --min-time=<ms>.
+**/
+class Runner
+{
+public:
+  static constexpr int REPETITIONS = 5;
+
+  Runner(int argc, char* argv[])
+  {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      if (arg == "--csv") {
+        m_isCsv = true;
+      }
+      else if (arg.rfind("--filter=", 0) == 0) {
+        m_filter = arg.substr(std::strlen("--filter="));
+      }
+      else if (arg.rfind("--min-time=", 0) == 0) {
+        m_minTime = std::chrono::milliseconds(std::atoi(arg.c_str() + std::strlen("--min-time=")));
+      }
+      else {
+        std::cerr << "usage: " << argv[0] << " [--csv] [--filter=<text>] [--min-time=<ms>]"
+                  << std::endl;
+        std::exit(2);
+      }
+    }
+    if (m_isCsv) {
+      std::cout << "benchmark,params,items,iterations,ns_per_item,items_per_second" << std::endl;
+    }
+  }
+
+  /**
+    @brief time fn, which processes nItems items per call
+  **/
+  template<typename Fn>
+  void
+  run(const std::string& name, const std::string& params, uint64_t nItems, Fn&& fn)
+  {
+    if (!m_filter.empty() && (name + "/" + params).find(m_filter) == std::string::npos) {
+      return;
+    }
+
+    uint64_t nIterations = 1;
+    while (timeBatch(fn, nIterations) < m_minTime && nIterations < (uint64_t(1) << 40)) {
+      nIterations *= 2;
+    }
+    auto best = std::chrono::nanoseconds::max();
+    for (int i = 0; i < REPETITIONS; ++i) {
+      best = std::min(best, timeBatch(fn, nIterations));
+    }
+
+    double nsPerItem = static_cast<double>(best.count()) / static_cast<double>(nIterations * nItems);
+    double itemsPerSecond = nsPerItem > 0 ? 1e9 / nsPerItem : 0;
+    if (m_isCsv) {
+      std::cout << name << "," << params << "," << nItems << "," << nIterations << ","
+                << nsPerItem << "," << static_cast<uint64_t>(itemsPerSecond) << std::endl;
+    }
+    else {
+      std::cout << "{\"benchmark\":\"" << name << "\",\"params\":\"" << params
+                << "\",\"items\":" << nItems << ",\"iterations\":" << nIterations
+                << ",\"ns_per_item\":" << nsPerItem
+                << ",\"items_per_second\":" << static_cast<uint64_t>(itemsPerSecond) << "}"
+                << std::endl;
+    }
+  }
+
+private:
+  template<typename Fn>
+  static std::chrono::nanoseconds
+  timeBatch(Fn& fn, uint64_t nIterations)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < nIterations; ++i) {
+      fn();
+    }
+    return std::chrono::steady_clock::now() - start;
+  }
+
+private:
+  bool m_isCsv = false;
+  std::string m_filter;
+  std::chrono::nanoseconds m_minTime = std::chrono::milliseconds(100);
+};
+
+/**
+  @brief keep the compiler from optimizing away a computed value
+**/
+template<typename T>
+inline void
+doNotOptimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+} // namespace benchmark
+} // namespace ndnsd
+
+#endif // NDNSD_BENCHMARKS_BENCHMARK_HPP
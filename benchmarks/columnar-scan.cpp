@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Ad-hoc predicate scan over N registry entries:
+//   publishTimestamp in [lo, hi] && serviceMetaInfo["type"] == "printer"
+// evaluated over a std::map<std::string, Details> (the layout ServiceDiscovery used to
+// keep), over ServiceRegistry::forEach and over the RegistryColumns mirror.
+//
+// usage: ndnsd-benchmark-columnar-scan [N ...]   (default 10000 100000 1000000)
+
+#include "ndnsd/discovery/service-registry.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace ndnsd::discovery;
+
+static const char* TYPES[] = {"printer", "scanner", "camera", "sensor", "display",
+                              "speaker", "router", "storage"};
+static constexpr int ROUNDS = 10;
+
+template<typename Fn>
+static double
+timeMicros(Fn&& fn, size_t& matches)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < ROUNDS; ++i) {
+    matches = fn();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() / ROUNDS;
+}
+
+static void
+run(size_t nEntries)
+{
+  std::map<std::string, Details> map;
+  ServiceRegistry registry;
+  registry.enableColumns({"type"});
+
+  for (size_t i = 0; i < nEntries; ++i) {
+    Details details;
+    details.serviceName = ndn::Name("/discovery").append(TYPES[i % 8]);
+    details.applicationPrefix = ndn::Name("/node").appendNumber(i);
+    details.serviceLifetime = 3600;
+    details.publishTimestamp = static_cast<time_t>(1600000000 + i % 1000);
+    details.serviceMetaInfo = {{"type", TYPES[i % 8]},
+                               {"location", "room-" + std::to_string(i % 64)},
+                               {"version", "1." + std::to_string(i % 5)}};
+    registry.insert(details);
+    map.emplace(ServiceRegistry::makeKey(details.applicationPrefix,
+                                         details.serviceName).toUri(), details);
+  }
+
+  const time_t lo = 1600000100;
+  const time_t hi = 1600000599;
+  size_t nMap = 0;
+  size_t nRegistry = 0;
+  size_t nColumns = 0;
+
+  double mapTime = timeMicros([&] {
+    size_t n = 0;
+    for (const auto& [key, details] : map) {
+      if (details.publishTimestamp < lo || details.publishTimestamp > hi) {
+        continue;
+      }
+      auto it = details.serviceMetaInfo.find("type");
+      n += it != details.serviceMetaInfo.end() && it->second == "printer";
+    }
+    return n;
+  }, nMap);
+
+  double registryTime = timeMicros([&] {
+    size_t n = 0;
+    registry.forEach([&] (ServiceRegistry::EntryId id) {
+      time_t timestamp = registry.getPublishTimestamp(id);
+      if (timestamp < lo || timestamp > hi) {
+        return;
+      }
+      auto type = registry.getMetaValue(id, "type");
+      n += type && *type == "printer";
+    });
+    return n;
+  }, nRegistry);
+
+  const RegistryColumns& columns = *registry.getColumns();
+  double columnTime = timeMicros([&] {
+    RowBitmap rows = columns.selectPublishTimestamp(lo, hi);
+    rows &= columns.selectMetaEquals("type", "printer");
+    rows &= columns.selectActive();
+    return rows.count();
+  }, nColumns);
+
+  if (nMap != nRegistry || nMap != nColumns) {
+    std::cerr << "result mismatch: " << nMap << " " << nRegistry << " " << nColumns << std::endl;
+    std::exit(1);
+  }
+
+  std::cout << std::setw(8) << nEntries
+            << std::fixed << std::setprecision(1)
+            << std::setw(14) << mapTime
+            << std::setw(14) << registryTime
+            << std::setw(14) << columnTime
+            << std::setw(10) << std::setprecision(1) << mapTime / columnTime << "x"
+            << std::setw(10) << nColumns << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = {10000, 100000, 1000000};
+  }
+
+  std::cout << "kernel: " << RegistryColumns::getKernelName() << "\n"
+            << std::setw(8) << "entries"
+            << std::setw(14) << "map (us)"
+            << std::setw(14) << "registry (us)"
+            << std::setw(14) << "columns (us)"
+            << std::setw(11) << "speedup"
+            << std::setw(10) << "matches" << std::endl;
+  for (size_t n : sizes) {
+    run(n);
+  }
+  return 0;
+}
@@ -0,0 +1,254 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Regression suite over the hot paths, one machine-readable line per case:
+//   details-encode / details-decode          by number of serviceMetaInfo entries
+//   details-decode-legacy                    the former hand-written Details::decode
+//   file-process                             ServiceInfoFileProcessor::processFile
+//   registry-insert / -lookup / -providers / -query / -scan   by registry size
+//   registry-range-query                     ordered index range
+//   registry-dispatch                        decode, registry insert, journal and callback of
+//                                            a publication; a model of the registry side of
+//                                            OnServiceUpdate, without ServiceDiscovery and SVS
+//
+// usage: ndnsd-benchmark-hot-paths [--csv] [--filter=<text>] [--min-time=<ms>]
+
+#include "benchmark.hpp"
+
+#include "ndnsd/discovery/change-journal.hpp"
+#include "ndnsd/discovery/file-processor.hpp"
+#include "ndnsd/discovery/info-parser.hpp"
+#include "ndnsd/discovery/service-registry.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <functional>
+#include <random>
+
+using namespace ndnsd::discovery;
+using ndnsd::benchmark::Runner;
+using ndnsd::benchmark::doNotOptimize;
+
+static const char* TYPES[] = {"printer", "scanner", "camera", "sensor", "display",
+                              "speaker", "router", "storage"};
+
+static Details
+makeDetails(size_t i, size_t nMeta)
+{
+  Details details;
+  details.serviceName = ndn::Name("/discovery").append(TYPES[i % 8]);
+  details.applicationPrefix = ndn::Name("/node").appendNumber(i);
+  details.serviceLifetime = 3600;
+  details.publishTimestamp = static_cast<time_t>(1600000000 + i % 1000);
+  details.serviceMetaInfo = {{"type", TYPES[i % 8]}};
+  for (size_t j = 1; j < nMeta; ++j) {
+    details.serviceMetaInfo.emplace("key" + std::to_string(j), "value-" + std::to_string(i % 64));
+  }
+  return details;
+}
+
+// what Details::decode did before the schema codec, a Block per element
+static Details
+decodeLegacy(const ndn::Block& block)
+{
+  Details details;
+  if (block.type() != tlv::ServiceInfo) {
+    throw Error("Invalid TLV type");
+  }
+  block.parse();
+
+  for (const auto& element : block.elements()) {
+    switch (element.type()) {
+      case tlv::Name:
+        details.serviceName = ndn::Name(ndn::readString(element));
+        break;
+      case tlv::ApplicationPrefix:
+        details.applicationPrefix = ndn::Name(ndn::readString(element));
+        break;
+      case tlv::ServiceLifetime:
+        details.serviceLifetime = ndn::readNonNegativeInteger(element);
+        break;
+      case tlv::PublishTimestamp:
+        details.publishTimestamp = ndn::readNonNegativeInteger(element);
+        break;
+      case tlv::ServiceMetaInfo:
+        element.parse();
+        for (const auto& keyValueElement : element.elements()) {
+          keyValueElement.parse();
+          std::string key = ndn::readString(keyValueElement.get(tlv::Key));
+          std::string value = ndn::readString(keyValueElement.get(tlv::Value));
+          details.serviceMetaInfo[key] = value;
+        }
+        break;
+      default:
+        throw Error("Unknown TLV type");
+    }
+  }
+  return details;
+}
+
+static void
+benchmarkCodec(Runner& runner)
+{
+  for (size_t nMeta : {0, 4, 16, 64, 256}) {
+    std::string params = "meta=" + std::to_string(nMeta);
+    Details details = makeDetails(1, nMeta);
+    runner.run("details-encode", params, 1, [&] {
+      doNotOptimize(details.encode());
+    });
+
+    ndn::Block block = details.encode();
+    runner.run("details-decode", params, 1, [&] {
+      doNotOptimize(Details::tryDecode(block.data(), block.data() + block.size()));
+    });
+
+    // a fresh Block each round, as parse() caches the elements
+    runner.run("details-decode-legacy", params, 1, [&] {
+      ndn::Block fresh(ndn::span<const uint8_t>(block.data(), block.size()));
+      doNotOptimize(decodeLegacy(fresh));
+    });
+  }
+}
+
+static void
+benchmarkFileProcessor(Runner& runner)
+{
+  auto directory = boost::filesystem::temp_directory_path() /
+                   boost::filesystem::unique_path("ndnsd-benchmark-%%%%%%");
+  boost::filesystem::create_directories(directory);
+  for (size_t nMeta : {4, 64, 1024}) {
+    std::string filename = (directory / ("service-" + std::to_string(nMeta) + ".info")).string();
+    {
+      std::ofstream os(filename);
+      writeServiceInfo(os, makeDetails(1, nMeta));
+    }
+    runner.run("file-process", "meta=" + std::to_string(nMeta), 1, [&] {
+      // the constructor runs processFile()
+      ServiceInfoFileProcessor processor(filename);
+      doNotOptimize(processor.getServiceMeta().size());
+    });
+  }
+  boost::filesystem::remove_all(directory);
+}
+
+static void
+benchmarkRegistry(Runner& runner)
+{
+  for (size_t nEntries : {1000, 10000, 100000}) {
+    std::string params = "entries=" + std::to_string(nEntries);
+    std::vector<Details> services;
+    for (size_t i = 0; i < nEntries; ++i) {
+      // four entries, one of them for the range queries
+      services.push_back(makeDetails(i, 3));
+      services.back().serviceMetaInfo.emplace("version", std::to_string(i % 8) + ".0");
+    }
+
+    runner.run("registry-insert", params, nEntries, [&] {
+      ServiceRegistry registry;
+      for (const auto& details : services) {
+        registry.insert(details);
+      }
+      doNotOptimize(registry.size());
+    });
+
+    ServiceRegistry registry;
+    registry.addIndex("type", IndexType::HASH);
+    for (const auto& details : services) {
+      registry.insert(details);
+    }
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<size_t> pick(0, nEntries - 1);
+    runner.run("registry-lookup", params, 1, [&] {
+      const Details& details = services[pick(random)];
+      doNotOptimize(registry.find(details.applicationPrefix, details.serviceName));
+    });
+
+    runner.run("registry-providers", params, 1, [&] {
+      doNotOptimize(registry.getProviders(services[pick(random)].serviceName).size());
+    });
+
+    Query query;
+    query.equals("type", "printer");
+    runner.run("registry-query", params, 1, [&] {
+      doNotOptimize(registry.query(query).size());
+    });
+
+    registry.addIndex("version", IndexType::VERSION);
+    Query rangeQuery;
+    rangeQuery.greaterOrEqual("version", "2.0").less("version", "4.0");
+    runner.run("registry-range-query", params, 1, [&] {
+      doNotOptimize(registry.query(rangeQuery).size());
+    });
+
+    runner.run("registry-scan", params, nEntries, [&] {
+      size_t nMatches = 0;
+      registry.forEach([&] (ServiceRegistry::EntryId id) {
+        auto type = registry.getMetaValue(id, "type");
+        nMatches += type && *type == "printer";
+      });
+      doNotOptimize(nMatches);
+    });
+  }
+}
+
+// does not call OnServiceUpdate, which needs an SVS subscription; changes to it are not
+// measured here
+static void
+benchmarkDispatch(Runner& runner)
+{
+  for (size_t nMeta : {4, 64}) {
+    std::vector<ndn::Block> publications;
+    for (size_t i = 0; i < 1024; ++i) {
+      Details details = makeDetails(i, nMeta);
+      publications.push_back(details.encode());
+      // every publication is an update, not a duplicate
+      details.publishTimestamp += 1;
+      publications.push_back(details.encode());
+    }
+
+    ServiceRegistry registry;
+    ChangeJournal journal;
+    size_t nCallbacks = 0;
+    std::function<void(const Details&)> callback = [&] (const Details&) { ++nCallbacks; };
+    size_t next = 0;
+    runner.run("registry-dispatch", "meta=" + std::to_string(nMeta), 1, [&] {
+      const ndn::Block& block = publications[next++ % publications.size()];
+      auto details = Details::tryDecode(block.data(), block.data() + block.size());
+      auto inserted = registry.insert(*details);
+      if (!inserted.isDuplicate) {
+        journal.append(inserted.isNew ? Change::ADDED : Change::UPDATED, *details);
+        callback(*details);
+      }
+    });
+    doNotOptimize(nCallbacks);
+  }
+}
+
+int
+main(int argc, char* argv[])
+{
+  Runner runner(argc, argv);
+  benchmarkCodec(runner);
+  benchmarkFileProcessor(runner);
+  benchmarkRegistry(runner);
+  benchmarkDispatch(runner);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Parse and write service files with N details entries, through boost::property_tree (the
+// former ServiceInfoFileProcessor path) and through the streaming InfoReader.
+//
+// usage: ndnsd-benchmark-info-parser [N ...]   (default 10 1000 100000)
+
+#include "ndnsd/discovery/info-parser.hpp"
+
+#include <boost/property_tree/info_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace ndnsd::discovery;
+
+template<typename Fn>
+static double
+timeMicros(Fn&& fn, int rounds)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    fn();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() / rounds;
+}
+
+// what ServiceInfoFileProcessor::processFile used to do
+static Details
+parsePtree(const std::string& input)
+{
+  std::istringstream is(input);
+  boost::property_tree::ptree pt;
+  boost::property_tree::read_info(is, pt);
+
+  Details details;
+  for (auto& block : pt) {
+    if (block.first == "required") {
+      for (auto& element : block.second) {
+        const auto& value = element.second.get_value<std::string>();
+        if (element.first == "serviceName") {
+          details.serviceName = value;
+        }
+        if (element.first == "appPrefix") {
+          details.applicationPrefix = value;
+        }
+        if (element.first == "lifetime") {
+          details.serviceLifetime = std::stoi(value);
+        }
+      }
+    }
+    if (block.first == "details") {
+      for (auto& element : block.second) {
+        details.serviceMetaInfo.emplace(element.first, element.second.get_value<std::string>());
+      }
+    }
+  }
+  return details;
+}
+
+static std::string
+writePtree(const Details& details)
+{
+  boost::property_tree::ptree pt;
+  boost::property_tree::ptree required;
+  required.put("serviceName", details.serviceName.toUri());
+  required.put("appPrefix", details.applicationPrefix.toUri());
+  required.put("lifetime", details.serviceLifetime);
+  pt.add_child("required", required);
+  boost::property_tree::ptree meta;
+  for (const auto& [key, value] : details.serviceMetaInfo) {
+    meta.put(key, value);
+  }
+  pt.add_child("details", meta);
+
+  std::ostringstream os;
+  boost::property_tree::write_info(os, pt);
+  return os.str();
+}
+
+static void
+run(size_t nEntries)
+{
+  Details details;
+  details.serviceName = ndn::Name("/printer");
+  details.applicationPrefix = ndn::Name("/uofm/printer1");
+  details.serviceLifetime = 100;
+  for (size_t i = 0; i < nEntries; ++i) {
+    details.serviceMetaInfo.emplace("key" + std::to_string(i),
+                                    i % 4 == 0 ? "value with spaces " + std::to_string(i)
+                                               : "value" + std::to_string(i));
+  }
+  std::ostringstream os;
+  writeServiceInfo(os, details);
+  const std::string input = os.str();
+
+  if (parsePtree(input).serviceMetaInfo != parseServiceInfo(input).serviceMetaInfo) {
+    std::cerr << "result mismatch" << std::endl;
+    std::exit(1);
+  }
+
+  int rounds = static_cast<int>(std::max<size_t>(1, 200000 / (nEntries + 1)));
+  double ptreeRead = timeMicros([&] { parsePtree(input); }, rounds);
+  double streamRead = timeMicros([&] { parseServiceInfo(input); }, rounds);
+  double ptreeWrite = timeMicros([&] { writePtree(details); }, rounds);
+  double streamWrite = timeMicros([&] {
+    std::ostringstream out;
+    writeServiceInfo(out, details);
+  }, rounds);
+
+  std::cout << std::setw(8) << nEntries << std::setw(10) << input.size()
+            << std::fixed << std::setprecision(1)
+            << std::setw(15) << ptreeRead << std::setw(15) << streamRead
+            << std::setw(9) << ptreeRead / streamRead << "x"
+            << std::setw(15) << ptreeWrite << std::setw(15) << streamWrite
+            << std::setw(9) << ptreeWrite / streamWrite << "x" << std::endl;
+}
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+  }
+  if (sizes.empty()) {
+    sizes = {10, 1000, 100000};
+  }
+
+  std::cout << std::setw(8) << "entries" << std::setw(10) << "bytes"
+            << std::setw(15) << "ptree rd (us)" << std::setw(15) << "stream rd (us)"
+            << std::setw(10) << "speedup"
+            << std::setw(15) << "ptree wr (us)" << std::setw(15) << "stream wr (us)"
+            << std::setw(10) << "speedup" << std::endl;
+  for (size_t n : sizes) {
+    run(n);
+  }
+  return 0;
+}
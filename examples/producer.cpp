@@ -17,6 +17,7 @@
  * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
  **/
 
+#include "ndnsd/discovery/directory-loader.hpp"
 #include "ndnsd/discovery/service-discovery.hpp"
 #include <ndn-cxx/util/logger.hpp>
 
@@ -37,13 +38,28 @@ class Producer
 {
 public:
 
-  Producer(ndn::Face& face, const std::string& syncGroupName, const std::string& nodeName)
+  Producer(ndn::Face& face, const std::string& syncGroupName, const std::string& nodeName,
+           const std::string& serviceDirectory = "")
     : m_face(face),
       m_syncGroupName(syncGroupName),
       m_nodeName(nodeName),
       m_serviceDiscovery(syncGroupName, nodeName, m_face, m_keyChain, std::bind(&Producer::processCallback, this, _1))
   {
     execute ();
+
+    if (!serviceDirectory.empty()) {
+      // publish every .info file of the directory, and again whenever one is edited
+      m_loader = std::make_unique<ndnsd::discovery::ServiceDirectoryLoader>(
+        m_face.getIoService(), serviceDirectory,
+        [this] (const ndnsd::discovery::Details& details) {
+          m_serviceDiscovery.publishServiceDetail(details);
+        },
+        [this] (const ndnsd::discovery::Details& details) {
+          m_serviceDiscovery.withdrawServiceDetail(details.serviceName);
+        });
+      m_loader->load();
+      m_loader->watch();
+    }
   }
   void
   execute ()
@@ -80,13 +96,14 @@ private:
   std::string m_syncGroupName;
   std::string m_nodeName;
   ndnsd::discovery::ServiceDiscovery m_serviceDiscovery;
+  std::unique_ptr<ndnsd::discovery::ServiceDirectoryLoader> m_loader;
 };
 
 int
 main(int argc, char* argv[])
 {
   if (argc < 3) {
-    std::cerr << "Usage: " << argv[0] << " <syncGroupName> <nodeName>" << std::endl;
+    std::cerr << "Usage: " << argv[0] << " <syncGroupName> <nodeName> [serviceDirectory]" << std::endl;
     return 1;
   }
 
@@ -94,7 +111,7 @@ main(int argc, char* argv[])
     NDN_LOG_INFO("Starting producer application");
     ndn::Face face;
     std::thread m_thread([&face](){face.processEvents(ndn::time::seconds(100),true);});
-    Producer producer(face, argv[1], argv[2]);
+    Producer producer(face, argv[1], argv[2], argc > 3 ? argv[3] : "");
     m_thread.join();
   }
   catch (const std::exception& e) {
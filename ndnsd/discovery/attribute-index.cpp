@@ -0,0 +1,495 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "attribute-index.hpp"
+#include "service-registry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace ndnsd {
+namespace discovery {
+
+// an indexed predicate is intersected rather than probed when its posting list is at most
+// this many times larger than the current candidate list
+static constexpr size_t INTERSECT_RATIO = 4;
+
+struct AttributeIndex::Constraint
+{
+  const std::string* key = nullptr;
+  const KeyIndex* index = nullptr;
+  IndexType type = IndexType::VERSION;
+
+  bool hasEquals = false;
+  std::string equals;
+  const void* equalsIdentity = nullptr;
+
+  std::optional<SortKey> lower;
+  bool lowerInclusive = true;
+  std::optional<SortKey> upper;
+  bool upperInclusive = true;
+
+  size_t estimate = std::numeric_limits<size_t>::max();
+
+  bool
+  isIndexed() const
+  {
+    if (index == nullptr) {
+      return false;
+    }
+    return index->type == IndexType::HASH ? hasEquals : true;
+  }
+
+  // the index answers the constraint exactly, no need to re-check candidates
+  bool
+  isCoveredByIndex() const
+  {
+    if (index == nullptr) {
+      return false;
+    }
+    if (index->type == IndexType::HASH) {
+      return hasEquals && !lower && !upper;
+    }
+    // ordered equality compares parsed values, "1.0" == "1.0.0"
+    return !hasEquals;
+  }
+
+  void
+  tightenLower(const SortKey& key, bool inclusive)
+  {
+    if (!lower || key > *lower || (key == *lower && !inclusive)) {
+      lower = key;
+      lowerInclusive = inclusive;
+    }
+  }
+
+  void
+  tightenUpper(const SortKey& key, bool inclusive)
+  {
+    if (!upper || key < *upper || (key == *upper && !inclusive)) {
+      upper = key;
+      upperInclusive = inclusive;
+    }
+  }
+
+  // the bounds admit no value
+  bool
+  isEmptyRange() const
+  {
+    if (!lower || !upper) {
+      return false;
+    }
+    return *lower > *upper || (*lower == *upper && (!lowerInclusive || !upperInclusive));
+  }
+
+  bool
+  isInRange(const SortKey& key) const
+  {
+    if (lower && (key < *lower || (key == *lower && !lowerInclusive))) {
+      return false;
+    }
+    if (upper && (key > *upper || (key == *upper && !upperInclusive))) {
+      return false;
+    }
+    return true;
+  }
+};
+
+static std::optional<uint64_t>
+parseNumber(std::string_view value)
+{
+  std::string str(value);
+  char* end = nullptr;
+  double number = std::strtod(str.c_str(), &end);
+  if (str.empty() || end != str.c_str() + str.size() || std::isnan(number)) {
+    return std::nullopt;
+  }
+  number += 0.0; // fold -0 into +0
+
+  uint64_t bits;
+  std::memcpy(&bits, &number, sizeof(bits));
+  // IEEE 754 bit patterns sort like integers once negatives are inverted
+  return (bits & (uint64_t(1) << 63)) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+static std::optional<AttributeIndex::SortKey>
+parseVersion(std::string_view value)
+{
+  if (!value.empty() && (value.front() == 'v' || value.front() == 'V')) {
+    value.remove_prefix(1);
+  }
+
+  AttributeIndex::SortKey key{};
+  size_t component = 0;
+  bool hasDigit = false;
+  for (char c : value) {
+    if (c >= '0' && c <= '9') {
+      if (component < key.size()) {
+        key[component] = key[component] * 10 + (c - '0');
+      }
+      hasDigit = true;
+    }
+    else if (c == '.' && hasDigit) {
+      ++component;
+      hasDigit = false;
+    }
+    else if ((c == '-' || c == '+') && hasDigit) {
+      // pre-release and build suffixes do not take part in ordering
+      break;
+    }
+    else {
+      return std::nullopt;
+    }
+  }
+  if (!hasDigit) {
+    return std::nullopt;
+  }
+  return key;
+}
+
+std::optional<AttributeIndex::SortKey>
+AttributeIndex::makeSortKey(std::string_view value, IndexType type)
+{
+  switch (type) {
+    case IndexType::NUMERIC: {
+      auto number = parseNumber(value);
+      if (!number) {
+        return std::nullopt;
+      }
+      return SortKey{*number, 0, 0, 0};
+    }
+    case IndexType::VERSION:
+      return parseVersion(value);
+    case IndexType::HASH:
+      break;
+  }
+  return std::nullopt;
+}
+
+void
+AttributeIndex::addIndex(const std::string& key, IndexType type, const ServiceRegistry& registry)
+{
+  auto [it, isNew] = m_indexes.try_emplace(key);
+  if (!isNew && it->second.type == type) {
+    return;
+  }
+  it->second = KeyIndex();
+  it->second.type = type;
+  registry.forEach([&] (EntryId id) { insert(id, it->first, it->second, registry); });
+}
+
+void
+AttributeIndex::insert(EntryId id, const ServiceRegistry& registry)
+{
+  for (auto& [key, index] : m_indexes) {
+    insert(id, key, index, registry);
+  }
+}
+
+void
+AttributeIndex::insert(EntryId id, const std::string& key, KeyIndex& index,
+                       const ServiceRegistry& registry)
+{
+  if (index.type == IndexType::HASH) {
+    auto value = registry.getMetaValueHandle(id, key);
+    if (!value) {
+      return;
+    }
+    auto& posting = index.postings[value.identity()];
+    posting.insert(std::lower_bound(posting.begin(), posting.end(), id), id);
+  }
+  else {
+    auto value = registry.getMetaValue(id, key);
+    if (!value) {
+      return;
+    }
+    auto sortKey = makeSortKey(*value, index.type);
+    if (sortKey) {
+      index.ordered.emplace(*sortKey, id);
+    }
+  }
+}
+
+void
+AttributeIndex::remove(EntryId id, const ServiceRegistry& registry)
+{
+  for (auto& [key, index] : m_indexes) {
+    if (index.type == IndexType::HASH) {
+      auto value = registry.getMetaValueHandle(id, key);
+      if (!value) {
+        continue;
+      }
+      auto posting = index.postings.find(value.identity());
+      if (posting == index.postings.end()) {
+        continue;
+      }
+      auto& ids = posting->second;
+      auto it = std::lower_bound(ids.begin(), ids.end(), id);
+      if (it != ids.end() && *it == id) {
+        ids.erase(it);
+      }
+      if (ids.empty()) {
+        index.postings.erase(posting);
+      }
+    }
+    else {
+      auto value = registry.getMetaValue(id, key);
+      if (!value) {
+        continue;
+      }
+      auto sortKey = makeSortKey(*value, index.type);
+      if (!sortKey) {
+        continue;
+      }
+      auto range = index.ordered.equal_range(*sortKey);
+      for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == id) {
+          index.ordered.erase(it);
+          break;
+        }
+      }
+    }
+  }
+}
+
+std::vector<AttributeIndex::EntryId>
+AttributeIndex::query(const Query& query, const ServiceRegistry& registry) const
+{
+  // group the predicates by key. Without an ordered index, the values of a key compare as
+  // versions ("1.10" > "1.9", "1.0" == "1.0.0") when every range operand of the key is one,
+  // as numbers otherwise; bounds and candidates are compared the same way
+  std::map<std::string_view, Constraint> constraints;
+  for (const auto& predicate : query.getPredicates()) {
+    Constraint& constraint = constraints[predicate.key];
+    if (constraint.key == nullptr) {
+      constraint.key = &predicate.key;
+      auto index = m_indexes.find(predicate.key);
+      if (index != m_indexes.end()) {
+        constraint.index = &index->second;
+      }
+      bool isOrdered = constraint.index != nullptr && constraint.index->type != IndexType::HASH;
+      constraint.type = isOrdered ? constraint.index->type : IndexType::VERSION;
+    }
+    bool isOrdered = constraint.index != nullptr && constraint.index->type != IndexType::HASH;
+    if (!isOrdered && predicate.op != Query::Predicate::EQUAL &&
+        !makeSortKey(predicate.value, IndexType::VERSION)) {
+      constraint.type = IndexType::NUMERIC;
+    }
+  }
+
+  for (const auto& predicate : query.getPredicates()) {
+    Constraint& constraint = constraints[predicate.key];
+    if (predicate.op == Query::Predicate::EQUAL) {
+      if (constraint.hasEquals && constraint.equals != predicate.value) {
+        return {};
+      }
+      constraint.hasEquals = true;
+      constraint.equals = predicate.value;
+      continue;
+    }
+
+    auto bound = makeSortKey(predicate.value, constraint.type);
+    if (!bound) {
+      return {};
+    }
+    switch (predicate.op) {
+      case Query::Predicate::GREATER:
+        constraint.tightenLower(*bound, false);
+        break;
+      case Query::Predicate::GREATER_EQUAL:
+        constraint.tightenLower(*bound, true);
+        break;
+      case Query::Predicate::LESS:
+        constraint.tightenUpper(*bound, false);
+        break;
+      case Query::Predicate::LESS_EQUAL:
+        constraint.tightenUpper(*bound, true);
+        break;
+      case Query::Predicate::EQUAL:
+        break;
+    }
+  }
+
+  std::vector<Constraint*> plan;
+  for (auto& [key, constraint] : constraints) {
+    if (constraint.hasEquals) {
+      // a value nobody published is not in the pool
+      auto value = registry.getStringPool().find(constraint.equals);
+      if (!value) {
+        return {};
+      }
+      constraint.equalsIdentity = value.identity();
+
+      if (constraint.index != nullptr && constraint.index->type != IndexType::HASH) {
+        auto sortKey = makeSortKey(constraint.equals, constraint.type);
+        if (!sortKey) {
+          return {};
+        }
+        constraint.tightenLower(*sortKey, true);
+        constraint.tightenUpper(*sortKey, true);
+      }
+    }
+    // e.g. > 2.0 and < 1.0, or == 1.0 and > 2.0
+    if (constraint.isEmptyRange()) {
+      return {};
+    }
+    plan.push_back(&constraint);
+  }
+
+  // cheapest indexed constraint first; ordered ranges are only counted up to the best so far
+  size_t best = std::numeric_limits<size_t>::max();
+  for (Constraint* constraint : plan) {
+    if (constraint->isIndexed() && constraint->index->type == IndexType::HASH) {
+      constraint->estimate = estimate(*constraint, best);
+      best = std::min(best, constraint->estimate);
+    }
+  }
+  for (Constraint* constraint : plan) {
+    if (constraint->isIndexed() && constraint->index->type != IndexType::HASH) {
+      constraint->estimate = estimate(*constraint, best);
+      best = std::min(best, constraint->estimate);
+    }
+  }
+  std::sort(plan.begin(), plan.end(),
+            [] (const Constraint* a, const Constraint* b) { return a->estimate < b->estimate; });
+
+  std::vector<EntryId> candidates;
+  auto first = plan.begin();
+  if (first != plan.end() && (*first)->isIndexed()) {
+    candidates = collect(**first);
+    if ((*first)->isCoveredByIndex()) {
+      ++first;
+    }
+  }
+  else {
+    // nothing indexed, scan
+    registry.forEach([&] (EntryId id) { candidates.push_back(id); });
+  }
+
+  for (auto it = first; it != plan.end() && !candidates.empty(); ++it) {
+    const Constraint& constraint = **it;
+    if (constraint.isIndexed() && constraint.isCoveredByIndex() &&
+        constraint.estimate <= candidates.size() * INTERSECT_RATIO) {
+      std::vector<EntryId> other = collect(constraint);
+      std::vector<EntryId> intersection;
+      std::set_intersection(candidates.begin(), candidates.end(), other.begin(), other.end(),
+                            std::back_inserter(intersection));
+      candidates.swap(intersection);
+    }
+    else {
+      candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                      [&] (EntryId id) { return !matches(id, constraint, registry); }),
+                       candidates.end());
+    }
+  }
+  return candidates;
+}
+
+size_t
+AttributeIndex::getMemoryUsage() const
+{
+  size_t bytes = 0;
+  for (const auto& [key, index] : m_indexes) {
+    bytes += key.capacity() + sizeof(KeyIndex) + index.postings.bucket_count() * sizeof(void*);
+    for (const auto& [value, ids] : index.postings) {
+      bytes += sizeof(std::pair<const void* const, std::vector<EntryId>>) + 2 * sizeof(void*) +
+               ids.capacity() * sizeof(EntryId);
+    }
+    bytes += index.ordered.size() * (sizeof(std::pair<const SortKey, EntryId>) + 4 * sizeof(void*));
+  }
+  return bytes;
+}
+
+std::vector<AttributeIndex::EntryId>
+AttributeIndex::collect(const Constraint& constraint) const
+{
+  const KeyIndex& index = *constraint.index;
+  if (index.type == IndexType::HASH) {
+    auto posting = index.postings.find(constraint.equalsIdentity);
+    if (posting == index.postings.end()) {
+      return {};
+    }
+    return posting->second;
+  }
+
+  auto begin = !constraint.lower ? index.ordered.begin() :
+               constraint.lowerInclusive ? index.ordered.lower_bound(*constraint.lower) :
+                                           index.ordered.upper_bound(*constraint.lower);
+  auto end = !constraint.upper ? index.ordered.end() :
+             constraint.upperInclusive ? index.ordered.upper_bound(*constraint.upper) :
+                                         index.ordered.lower_bound(*constraint.upper);
+  std::vector<EntryId> ids;
+  // begin is after end for an inverted range
+  if (constraint.isEmptyRange()) {
+    return ids;
+  }
+  for (auto it = begin; it != end; ++it) {
+    ids.push_back(it->second);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+size_t
+AttributeIndex::estimate(const Constraint& constraint, size_t limit) const
+{
+  const KeyIndex& index = *constraint.index;
+  if (index.type == IndexType::HASH) {
+    auto posting = index.postings.find(constraint.equalsIdentity);
+    return posting == index.postings.end() ? 0 : posting->second.size();
+  }
+
+  auto it = !constraint.lower ? index.ordered.begin() :
+            constraint.lowerInclusive ? index.ordered.lower_bound(*constraint.lower) :
+                                        index.ordered.upper_bound(*constraint.lower);
+  size_t count = 0;
+  for (; it != index.ordered.end() && constraint.isInRange(it->first); ++it) {
+    if (++count > limit) {
+      break;
+    }
+  }
+  return count;
+}
+
+bool
+AttributeIndex::matches(EntryId id, const Constraint& constraint,
+                        const ServiceRegistry& registry) const
+{
+  if (constraint.hasEquals) {
+    auto value = registry.getMetaValueHandle(id, *constraint.key);
+    if (value.identity() != constraint.equalsIdentity) {
+      return false;
+    }
+  }
+  if (constraint.lower || constraint.upper) {
+    auto value = registry.getMetaValue(id, *constraint.key);
+    if (!value) {
+      return false;
+    }
+    auto sortKey = makeSortKey(*value, constraint.type);
+    return sortKey && constraint.isInRange(*sortKey);
+  }
+  return true;
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,206 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_ATTRIBUTE_INDEX_HPP
+#define NDNSD_ATTRIBUTE_INDEX_HPP
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+class ServiceRegistry;
+
+enum class IndexType : uint8_t {
+  // equality only, keyed by the interned value
+  HASH,
+  // ordered, values compared as decimal numbers
+  NUMERIC,
+  // ordered, values compared as dot separated versions ("1.10.2" > "1.9")
+  VERSION,
+};
+
+/**
+  @brief Conjunction of predicates over serviceMetaInfo
+
+  @code
+    Query().equals("type", "flight control").greaterOrEqual("version", "1.0")
+  @endcode
+**/
+class Query
+{
+public:
+  struct Predicate
+  {
+    enum Op : uint8_t {
+      EQUAL,
+      GREATER,
+      GREATER_EQUAL,
+      LESS,
+      LESS_EQUAL,
+    };
+
+    std::string key;
+    Op op;
+    std::string value;
+  };
+
+  Query&
+  equals(std::string key, std::string value)
+  {
+    return add(std::move(key), Predicate::EQUAL, std::move(value));
+  }
+
+  Query&
+  greater(std::string key, std::string value)
+  {
+    return add(std::move(key), Predicate::GREATER, std::move(value));
+  }
+
+  Query&
+  greaterOrEqual(std::string key, std::string value)
+  {
+    return add(std::move(key), Predicate::GREATER_EQUAL, std::move(value));
+  }
+
+  Query&
+  less(std::string key, std::string value)
+  {
+    return add(std::move(key), Predicate::LESS, std::move(value));
+  }
+
+  Query&
+  lessOrEqual(std::string key, std::string value)
+  {
+    return add(std::move(key), Predicate::LESS_EQUAL, std::move(value));
+  }
+
+  const std::vector<Predicate>&
+  getPredicates() const
+  {
+    return m_predicates;
+  }
+
+private:
+  Query&
+  add(std::string key, Predicate::Op op, std::string value)
+  {
+    m_predicates.push_back({std::move(key), op, std::move(value)});
+    return *this;
+  }
+
+private:
+  std::vector<Predicate> m_predicates;
+};
+
+/**
+  @brief Secondary indexes over selected serviceMetaInfo keys of a ServiceRegistry
+
+  HASH indexes map an interned value to a sorted posting list of entries, NUMERIC and
+  VERSION indexes keep entries ordered by the parsed value. The registry keeps them current
+  on every insert, replacement and expiry.
+
+  query() plans a conjunction: the most selective indexed predicate produces the candidate
+  list, other indexed predicates of similar size are intersected with it, and the rest are
+  checked against the candidates directly. Only queries without any indexed predicate fall
+  back to a full scan. Range predicates on a key without an ordered index compare the
+  values as versions if all their operands are versions, as numbers otherwise.
+**/
+class AttributeIndex
+{
+public:
+  using EntryId = uint32_t;
+  // order preserving encoding of a NUMERIC or VERSION value
+  using SortKey = std::array<uint64_t, 4>;
+
+  static std::optional<SortKey>
+  makeSortKey(std::string_view value, IndexType type);
+
+  bool
+  hasIndex(std::string_view key) const
+  {
+    return m_indexes.find(key) != m_indexes.end();
+  }
+
+  void
+  addIndex(const std::string& key, IndexType type, const ServiceRegistry& registry);
+
+  void
+  removeIndex(const std::string& key)
+  {
+    auto it = m_indexes.find(key);
+    if (it != m_indexes.end()) {
+      m_indexes.erase(it);
+    }
+  }
+
+  void
+  insert(EntryId id, const ServiceRegistry& registry);
+
+  void
+  remove(EntryId id, const ServiceRegistry& registry);
+
+  /**
+    @return matching entries in ascending id order
+  **/
+  std::vector<EntryId>
+  query(const Query& query, const ServiceRegistry& registry) const;
+
+  size_t
+  getMemoryUsage() const;
+
+private:
+  struct KeyIndex
+  {
+    IndexType type;
+    // HASH: value identity -> sorted entries
+    std::unordered_map<const void*, std::vector<EntryId>> postings;
+    // NUMERIC, VERSION
+    std::multimap<SortKey, EntryId> ordered;
+  };
+
+  struct Constraint;
+
+  void
+  insert(EntryId id, const std::string& key, KeyIndex& index, const ServiceRegistry& registry);
+
+  std::vector<EntryId>
+  collect(const Constraint& constraint) const;
+
+  size_t
+  estimate(const Constraint& constraint, size_t limit) const;
+
+  bool
+  matches(EntryId id, const Constraint& constraint, const ServiceRegistry& registry) const;
+
+private:
+  std::map<std::string, KeyIndex, std::less<>> m_indexes;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_ATTRIBUTE_INDEX_HPP
@@ -0,0 +1,66 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "change-journal.hpp"
+
+#include <algorithm>
+
+namespace ndnsd {
+namespace discovery {
+
+ChangeJournal::ChangeJournal(size_t capacity)
+  : m_ring(std::max<size_t>(capacity, 1))
+{
+}
+
+uint64_t
+ChangeJournal::append(Change::Type type, const Details& details, const ndn::Name& group)
+{
+  uint64_t seqNo = m_nextSeqNo++;
+  Change& slot = m_ring[seqNo % m_ring.size()];
+  slot.seqNo = seqNo;
+  slot.type = type;
+  slot.details = details;
+  slot.group = group;
+  m_size = std::min(m_size + 1, m_ring.size());
+  return seqNo;
+}
+
+ChangeBatch
+ChangeJournal::changesSince(uint64_t cursor, size_t limit) const
+{
+  ChangeBatch batch;
+  // a cursor from the future was issued by another journal instance
+  if (cursor + 1 < getFirstSeqNo() || cursor > getLastSeqNo()) {
+    batch.isBehind = true;
+    batch.cursor = getLastSeqNo();
+    return batch;
+  }
+
+  uint64_t last = std::min(getLastSeqNo(), cursor + std::min<uint64_t>(limit, m_size));
+  batch.changes.reserve(last - cursor);
+  for (uint64_t seqNo = cursor + 1; seqNo <= last; ++seqNo) {
+    batch.changes.push_back(m_ring[seqNo % m_ring.size()]);
+  }
+  batch.cursor = last;
+  return batch;
+}
+
+} // namespace discovery
+} // namespace ndnsd
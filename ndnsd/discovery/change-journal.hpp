@@ -0,0 +1,127 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_CHANGE_JOURNAL_HPP
+#define NDNSD_CHANGE_JOURNAL_HPP
+
+#include "details.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+struct Change
+{
+  enum Type : uint8_t {
+    ADDED,
+    UPDATED,
+    EXPIRED,
+    // dropped to keep the registry within its memory budget, may come back as ADDED
+    EVICTED,
+  };
+
+  uint64_t seqNo = 0;
+  Type type = ADDED;
+  // for EXPIRED and EVICTED, the last details that were registered
+  Details details;
+  // service group the details were received in
+  ndn::Name group;
+};
+
+struct ChangeBatch
+{
+  // changes newer than the requested cursor, oldest first
+  std::vector<Change> changes;
+  // cursor to pass to the next changesSince() call
+  uint64_t cursor = 0;
+  /**
+    the requested cursor is older than the oldest retained change (or unknown to this
+    journal); changes is empty and the caller must resync from a snapshot, then continue
+    from cursor
+  **/
+  bool isBehind = false;
+};
+
+/**
+  @brief Bounded journal of registry changes
+
+  Every change gets the next sequence number, starting at 1. Only the last capacity changes
+  are retained, older ones are overwritten in place. A cursor is the sequence number of the
+  last change a consumer has seen, 0 before the first one.
+**/
+class ChangeJournal
+{
+public:
+  static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+  explicit
+  ChangeJournal(size_t capacity = DEFAULT_CAPACITY);
+
+  /**
+    @return sequence number of the appended change
+  **/
+  uint64_t
+  append(Change::Type type, const Details& details, const ndn::Name& group = ndn::Name());
+
+  /**
+    @param cursor sequence number of the last change already seen
+    @param limit maximum number of changes to return
+  **/
+  ChangeBatch
+  changesSince(uint64_t cursor, size_t limit = std::numeric_limits<size_t>::max()) const;
+
+  // sequence number of the newest change, 0 if none
+  uint64_t
+  getLastSeqNo() const
+  {
+    return m_nextSeqNo - 1;
+  }
+
+  // sequence number of the oldest retained change
+  uint64_t
+  getFirstSeqNo() const
+  {
+    return m_nextSeqNo - m_size;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  size_t
+  capacity() const
+  {
+    return m_ring.size();
+  }
+
+private:
+  std::vector<Change> m_ring;
+  size_t m_size = 0;
+  uint64_t m_nextSeqNo = 1;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_CHANGE_JOURNAL_HPP
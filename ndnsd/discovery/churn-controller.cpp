@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "churn-controller.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ndnsd {
+namespace discovery {
+
+ChurnController::ChurnController(const TuningBounds& bounds)
+  : m_bounds(bounds)
+  // a group starts quiet
+  , m_republishWindow(bounds.maxRepublishWindow)
+  , m_batchInterval(bounds.maxBatchInterval)
+  , m_syncInterval(bounds.maxSyncInterval)
+{
+}
+
+bool
+ChurnController::tick(ndn::time::nanoseconds elapsed)
+{
+  double seconds = ndn::time::duration_cast<ndn::time::duration<double>>(elapsed).count();
+  if (seconds <= 0) {
+    return false;
+  }
+  double halfLife = ndn::time::duration_cast<ndn::time::duration<double>>(m_bounds.halfLife)
+                      .count();
+  double alpha = halfLife > 0 ? 1 - std::exp2(-seconds / halfLife) : 1;
+
+  m_updateRate += alpha * (m_nUpdates / seconds - m_updateRate);
+  m_joinRate += alpha * (m_nJoins / seconds - m_joinRate);
+  // a period without fetches counts as one without losses, so that a group that went quiet
+  // also stops resyncing
+  double lossSample = m_nFetches > 0 ? static_cast<double>(m_nLateFetches) / m_nFetches : 0;
+  m_lossRate += alpha * (lossSample - m_lossRate);
+  m_nUpdates = m_nJoins = m_nFetches = m_nLateFetches = 0;
+
+  double churn = m_bounds.busyRate > 0 ? (m_updateRate + m_joinRate) / m_bounds.busyRate : 1;
+  double loss = m_bounds.busyLossRate > 0 ? m_lossRate / m_bounds.busyLossRate : 1;
+
+  // losses call for answering discovery messages sooner too
+  bool isChanged = adopt(m_republishWindow, m_bounds.minRepublishWindow,
+                         m_bounds.maxRepublishWindow, std::max(churn, loss));
+  isChanged = adopt(m_batchInterval, m_bounds.minBatchInterval, m_bounds.maxBatchInterval,
+                    churn) || isChanged;
+  isChanged = adopt(m_syncInterval, m_bounds.minSyncInterval, m_bounds.maxSyncInterval,
+                    std::max(churn, loss)) || isChanged;
+  return isChanged;
+}
+
+bool
+ChurnController::adopt(ndn::time::milliseconds& current, ndn::time::milliseconds min,
+                       ndn::time::milliseconds max, double churn)
+{
+  churn = std::clamp(churn, 0.0, 1.0);
+  ndn::time::milliseconds decided = min;
+  if (min.count() > 0 && max > min) {
+    // geometric, so that equal steps of churn scale the interval by equal factors
+    double ratio = static_cast<double>(min.count()) / max.count();
+    decided = ndn::time::milliseconds(std::llround(max.count() * std::pow(ratio, churn)));
+  }
+
+  auto difference = decided > current ? decided - current : current - decided;
+  // the bounds themselves are always reached
+  if (decided == current || (difference * 5 <= current && decided != min && decided != max)) {
+    return false;
+  }
+  current = decided;
+  return true;
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,170 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_CHURN_CONTROLLER_HPP
+#define NDNSD_CHURN_CONTROLLER_HPP
+
+#include <ndn-cxx/util/time.hpp>
+
+#include <cstddef>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief bounds of the intervals ChurnController picks, and the rates at which they reach
+         their minimum
+**/
+struct TuningBounds
+{
+  // discovery messages received within this window of the previous one are not answered;
+  // the maximum is the fixed ServiceDiscoveryOptions::republishWindow, widen it to answer
+  // quiet groups less often at the cost of their join latency
+  ndn::time::milliseconds minRepublishWindow = ndn::time::seconds(1);
+  ndn::time::milliseconds maxRepublishWindow = ndn::time::seconds(5);
+  // delay over which changes are batched, e.g. into one summary
+  ndn::time::milliseconds minBatchInterval = ndn::time::milliseconds(100);
+  ndn::time::milliseconds maxBatchInterval = ndn::time::seconds(10);
+  // least time between two resyncs of a group, which only happen after losses
+  ndn::time::milliseconds minSyncInterval = ndn::time::seconds(5);
+  ndn::time::milliseconds maxSyncInterval = ndn::time::minutes(5);
+  // updates plus joins per second at which the group counts as fully churning
+  double busyRate = 1.0;
+  // fraction of late fetches at which the sync interval reaches its minimum
+  double busyLossRate = 0.1;
+  // a fetch that takes longer than this after the sync notification counts as a loss
+  ndn::time::milliseconds lateFetchDelay = ndn::time::seconds(1);
+  // of the moving averages of the rates
+  ndn::time::milliseconds halfLife = ndn::time::seconds(30);
+};
+
+/**
+  @brief Picks the republish window, batching interval and sync interval of a group from
+         its observed update, join and loss rates
+
+  Rates are exponential moving averages updated by tick(). Each interval is interpolated
+  geometrically between its bounds, at the maximum in a quiet group and at the minimum once
+  the churn reaches busyRate; the republish window and the sync interval also reach their
+  minimum with busyLossRate.
+  A new interval is only adopted when it differs from the current one by more than a
+  fifth, so that decisions do not flap around a steady rate.
+**/
+class ChurnController
+{
+public:
+  explicit
+  ChurnController(const TuningBounds& bounds = {});
+
+  void
+  recordUpdates(size_t nUpdates)
+  {
+    m_nUpdates += nUpdates;
+  }
+
+  void
+  recordJoin()
+  {
+    ++m_nJoins;
+  }
+
+  /**
+    @brief a publication fetched delay after its sync notification
+    @return whether the fetch was late
+  **/
+  bool
+  recordFetch(ndn::time::nanoseconds delay)
+  {
+    ++m_nFetches;
+    if (delay <= m_bounds.lateFetchDelay) {
+      return false;
+    }
+    ++m_nLateFetches;
+    return true;
+  }
+
+  /**
+    @brief fold the events recorded over the last elapsed time into the rates and decide
+    @return true if one of the intervals changed
+  **/
+  bool
+  tick(ndn::time::nanoseconds elapsed);
+
+  // per second
+  double
+  getUpdateRate() const
+  {
+    return m_updateRate;
+  }
+
+  double
+  getJoinRate() const
+  {
+    return m_joinRate;
+  }
+
+  // fraction of the fetches that were late
+  double
+  getLossRate() const
+  {
+    return m_lossRate;
+  }
+
+  ndn::time::milliseconds
+  getRepublishWindow() const
+  {
+    return m_republishWindow;
+  }
+
+  ndn::time::milliseconds
+  getBatchInterval() const
+  {
+    return m_batchInterval;
+  }
+
+  ndn::time::milliseconds
+  getSyncInterval() const
+  {
+    return m_syncInterval;
+  }
+
+private:
+  // set current to the interval for churn, max at 0 and min from 1, if far enough from it;
+  // returns whether it changed
+  static bool
+  adopt(ndn::time::milliseconds& current, ndn::time::milliseconds min,
+        ndn::time::milliseconds max, double churn);
+
+private:
+  TuningBounds m_bounds;
+  size_t m_nUpdates = 0;
+  size_t m_nJoins = 0;
+  size_t m_nFetches = 0;
+  size_t m_nLateFetches = 0;
+  double m_updateRate = 0;
+  double m_joinRate = 0;
+  double m_lossRate = 0;
+  ndn::time::milliseconds m_republishWindow;
+  ndn::time::milliseconds m_batchInterval;
+  ndn::time::milliseconds m_syncInterval;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_CHURN_CONTROLLER_HPP
@@ -0,0 +1,298 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_DETAILS_HPP
+#define NDNSD_DETAILS_HPP
+
+#include "tlv-schema.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <ctime>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+namespace tlv {
+
+  enum {
+    DiscoveryData = 128,
+    ServiceInfo = 129,
+    ServiceStatus = 130,
+    Name = 131,               // New TLV type for serviceName
+    ApplicationPrefix = 132,  // New TLV type for applicationPrefix
+    ServiceLifetime = 133,    // New TLV type for serviceLifetime
+    PublishTimestamp = 134,   // New TLV type for publishTimestamp
+    ServiceMetaInfo = 135,    // New TLV type for serviceMetaInfo
+    Key = 136,                // New TLV type for keys in serviceMetaInfo
+    Value = 137,               // New TLV type for values in serviceMetaInfo
+    KeyValuePair = 138,        // New TLV type for key-value pairs in serviceMetaInfo
+    PublishTimestampMs = 140,
+    HopTrace = 142,
+    Hop = 144,
+    HopNode = 146,
+    HopTimestamp = 148,
+    WithdrawnTimestampMs = 166,
+    LeaseEnd = 168,
+  };
+
+} // namespace tlv
+
+class Error : public std::runtime_error
+{
+public:
+  using std::runtime_error::runtime_error;
+};
+
+/**
+  @brief a node the details went through, see Details::hopTrace
+**/
+struct Hop
+{
+  ndn::Name node;
+  // milliseconds since the epoch when the node sent the details on
+  uint64_t timestamp = 0;
+};
+
+struct Details
+{
+  ndn::Name serviceName;
+  ndn::Name applicationPrefix;
+  int serviceLifetime = 0;
+  // start of the lease, in seconds since the epoch; also the version of the details, only
+  // the producer changes it
+  time_t publishTimestamp = 0;
+  std::map<std::string, std::string> serviceMetaInfo;
+  /**
+    milliseconds since the epoch when these details were sent, set by ServiceDiscovery on
+    every publication, 0 if the publisher does not set it. Receivers compute propagation
+    latency from it; it is not kept in the registry.
+  **/
+  uint64_t publishTimestampMs = 0;
+  /**
+    nodes the details went through, the first publisher first, each added when the node
+    publishes them or relays them in a lookup reply with ServiceDiscoveryOptions::traceHops
+    set. Not kept in the registry either; ServiceDiscovery keeps the received traces aside
+    for the lookups it answers.
+  **/
+  std::vector<Hop> hopTrace;
+  /**
+    milliseconds since the epoch when the publisher withdrew the service, see
+    ServiceDiscovery::withdrawServiceDetail(), 0 for a live service. Receivers drop the
+    service instead of registering it.
+  **/
+  uint64_t withdrawnTimestampMs = 0;
+  /**
+    seconds since the epoch when the lease renewed by the last heartbeat ends, 0 if no
+    heartbeat renewed it. Not part of the version: details differing only in leaseEnd are
+    the same publication, see getLeaseEnd().
+  **/
+  uint64_t leaseEnd = 0;
+
+  // end of the lease in seconds since the epoch, 0 if it never ends
+  time_t
+  getLeaseEnd() const
+  {
+    if (leaseEnd != 0) {
+      return static_cast<time_t>(leaseEnd);
+    }
+    return serviceLifetime <= 0 ? 0 : publishTimestamp + serviceLifetime;
+  }
+
+  // Function to decode an NDN Block into a Details object, throws Error on failure
+  static Details
+  decode(const ndn::Block& block);
+
+  // Decode a complete ServiceInfo TLV without throwing
+  static schema::DecodeResult<Details>
+  tryDecode(const uint8_t* begin, const uint8_t* end);
+
+  // Function to encode a Details object into an NDN Block
+  ndn::Block
+  encode() const;
+
+  template<ndn::encoding::Tag TAG>
+  size_t
+  wireEncode(ndn::EncodingImpl<TAG>& encoder) const;
+
+  std::string toString() const
+  {
+    std::stringstream ss;
+    ss << "ServiceName: " << serviceName << "\n";
+    ss << "ApplicationPrefix: " << applicationPrefix << "\n";
+    ss << "ServiceLifetime: " << serviceLifetime << "\n";
+    ss << "PublishTimestamp: " << publishTimestamp << "\n";
+    if (publishTimestampMs != 0) {
+      ss << "PublishTimestampMs: " << publishTimestampMs << "\n";
+    }
+    if (leaseEnd != 0) {
+      ss << "LeaseEnd: " << leaseEnd << "\n";
+    }
+    for (const auto& hop : hopTrace) {
+      ss << "Hop: " << hop.node << " " << hop.timestamp << "\n";
+    }
+    ss << "ServiceMetaInfo: \n";
+    for (const auto& [key, value] : serviceMetaInfo) {
+      ss << key << ": " << value << "\n";
+    }
+    return ss.str();
+  }
+};
+
+/**
+  @brief Details::hopTrace as a sequence of <Hop><HopNode/><HopTimestamp/></Hop>, omitted when
+         empty
+**/
+struct HopTraceCodec
+{
+  using value_type = std::vector<Hop>;
+
+  static bool
+  isPresent(const value_type& hops)
+  {
+    return !hops.empty();
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, const value_type& hops)
+  {
+    size_t totalLength = 0;
+    for (auto it = hops.rbegin(); it != hops.rend(); ++it) {
+      size_t hopLength = ndn::encoding::prependNonNegativeIntegerBlock(encoder, tlv::HopTimestamp,
+                                                                       it->timestamp);
+      hopLength += schema::NameUriCodec::prepend(encoder, tlv::HopNode, it->node);
+      hopLength += encoder.prependVarNumber(hopLength);
+      hopLength += encoder.prependVarNumber(tlv::Hop);
+      totalLength += hopLength;
+    }
+    totalLength += encoder.prependVarNumber(totalLength);
+    totalLength += encoder.prependVarNumber(type);
+    return totalLength;
+  }
+
+  static schema::DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, value_type& hops)
+  {
+    schema::ElementReader elements(begin, end);
+    uint32_t type = 0;
+    const uint8_t* hopBegin = nullptr;
+    const uint8_t* hopEnd = nullptr;
+    while (elements.next(type, hopBegin, hopEnd)) {
+      if (type != tlv::Hop) {
+        if (ndn::tlv::isCriticalType(type)) {
+          return schema::DecodeStatus::UNKNOWN_CRITICAL;
+        }
+        continue;
+      }
+
+      schema::ElementReader fields(hopBegin, hopEnd);
+      const uint8_t* valueBegin = nullptr;
+      const uint8_t* valueEnd = nullptr;
+      Hop hop;
+      while (fields.next(type, valueBegin, valueEnd)) {
+        auto status = schema::DecodeStatus::OK;
+        if (type == tlv::HopNode) {
+          status = schema::NameUriCodec::read(valueBegin, valueEnd, hop.node);
+        }
+        else if (type == tlv::HopTimestamp) {
+          status = schema::NonNegativeIntegerCodec<uint64_t>::read(valueBegin, valueEnd,
+                                                                   hop.timestamp);
+        }
+        else if (ndn::tlv::isCriticalType(type)) {
+          status = schema::DecodeStatus::UNKNOWN_CRITICAL;
+        }
+        if (status != schema::DecodeStatus::OK) {
+          return status;
+        }
+      }
+      if (fields.isMalformed()) {
+        return schema::DecodeStatus::MALFORMED;
+      }
+      hops.push_back(std::move(hop));
+    }
+    return elements.isMalformed() ? schema::DecodeStatus::MALFORMED : schema::DecodeStatus::OK;
+  }
+};
+
+/**
+  @brief uint64 field omitted when 0
+**/
+struct OptionalTimestampCodec : schema::NonNegativeIntegerCodec<uint64_t>
+{
+  static bool
+  isPresent(uint64_t value)
+  {
+    return value != 0;
+  }
+};
+
+// Wire layout of Details, in encoding order. New fields must use even (non-critical)
+// TLV types so that older decoders skip them.
+using DetailsSchema = schema::Schema<tlv::ServiceInfo, Details,
+  schema::Field<tlv::Name, &Details::serviceName, schema::NameUriCodec>,
+  schema::Field<tlv::ApplicationPrefix, &Details::applicationPrefix, schema::NameUriCodec>,
+  schema::Field<tlv::ServiceLifetime, &Details::serviceLifetime,
+                schema::NonNegativeIntegerCodec<int>>,
+  schema::Field<tlv::PublishTimestamp, &Details::publishTimestamp,
+                schema::NonNegativeIntegerCodec<time_t>>,
+  schema::Field<tlv::ServiceMetaInfo, &Details::serviceMetaInfo,
+                schema::StringMapCodec<tlv::KeyValuePair, tlv::Key, tlv::Value>>,
+  schema::Field<tlv::PublishTimestampMs, &Details::publishTimestampMs, OptionalTimestampCodec>,
+  schema::Field<tlv::HopTrace, &Details::hopTrace, HopTraceCodec>,
+  schema::Field<tlv::WithdrawnTimestampMs, &Details::withdrawnTimestampMs, OptionalTimestampCodec>,
+  schema::Field<tlv::LeaseEnd, &Details::leaseEnd, OptionalTimestampCodec>>;
+
+inline Details
+Details::decode(const ndn::Block& block)
+{
+  auto result = DetailsSchema::decode(block);
+  if (!result) {
+    throw Error(result.errorMessage());
+  }
+  return std::move(*result);
+}
+
+inline schema::DecodeResult<Details>
+Details::tryDecode(const uint8_t* begin, const uint8_t* end)
+{
+  return DetailsSchema::decode(begin, end);
+}
+
+inline ndn::Block
+Details::encode() const
+{
+  return DetailsSchema::encode(*this);
+}
+
+template<ndn::encoding::Tag TAG>
+size_t
+Details::wireEncode(ndn::EncodingImpl<TAG>& encoder) const
+{
+  return DetailsSchema::prepend(encoder, *this);
+}
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_DETAILS_HPP
@@ -0,0 +1,297 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "directory-loader.hpp"
+#include "file-processor.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+INIT_LOGGER(DirectoryLoader);
+
+namespace ndnsd {
+namespace discovery {
+
+static bool
+isInfoFile(const std::string& file)
+{
+  return boost::filesystem::path(file).extension() == ".info";
+}
+
+static bool
+isSameService(const Details& a, const Details& b)
+{
+  return a.serviceName == b.serviceName && a.applicationPrefix == b.applicationPrefix &&
+         a.serviceLifetime == b.serviceLifetime && a.serviceMetaInfo == b.serviceMetaInfo;
+}
+
+ServiceDirectoryLoader::ServiceDirectoryLoader(boost::asio::io_service& io,
+                                               const std::string& directory,
+                                               const ChangeCallback& onChange,
+                                               const RemoveCallback& onRemove,
+                                               size_t nThreads)
+  : m_directory(directory)
+  , m_onChange(onChange)
+  , m_onRemove(onRemove)
+  , m_nThreads(nThreads > 0 ? nThreads : std::max(1u, std::thread::hardware_concurrency()))
+  , m_scheduler(io)
+  , m_inotify(io)
+{
+}
+
+ServiceDirectoryLoader::~ServiceDirectoryLoader()
+{
+  stop();
+}
+
+size_t
+ServiceDirectoryLoader::load()
+{
+  std::vector<std::string> files;
+  boost::system::error_code ec;
+  for (boost::filesystem::directory_iterator it(m_directory, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (boost::filesystem::is_regular_file(it->status()) && isInfoFile(it->path().string())) {
+      files.push_back(it->path().string());
+    }
+  }
+  if (ec) {
+    NDNSD_LOG_ERROR("Cannot list " << m_directory << ": " << ec.message());
+    return 0;
+  }
+
+  // files loaded before but no longer listed are applied as missing
+  std::set<std::string> listed(files.begin(), files.end());
+  for (const auto& [file, details] : m_services) {
+    if (listed.count(file) == 0) {
+      files.push_back(file);
+    }
+  }
+  return apply(files);
+}
+
+void
+ServiceDirectoryLoader::watch()
+{
+#ifdef __linux__
+  if (m_inotify.is_open()) {
+    return;
+  }
+  int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    NDNSD_LOG_ERROR("inotify_init1: " << std::strerror(errno));
+    return;
+  }
+  if (::inotify_add_watch(fd, m_directory.data(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+    NDNSD_LOG_ERROR("Cannot watch " << m_directory << ": " << std::strerror(errno));
+    ::close(fd);
+    return;
+  }
+  m_inotify.assign(fd);
+  readEvents();
+#else
+  NDNSD_LOG_WARN("Directory watching is not supported on this platform, call load() to reload");
+#endif
+}
+
+void
+ServiceDirectoryLoader::stop()
+{
+  m_reloadEvent.cancel();
+  if (m_inotify.is_open()) {
+    boost::system::error_code ec;
+    m_inotify.close(ec);
+  }
+}
+
+std::vector<std::optional<Details>>
+ServiceDirectoryLoader::parse(const std::vector<std::string>& files) const
+{
+  std::vector<std::optional<Details>> results(files.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    for (size_t i = next++; i < files.size(); i = next++) {
+      results[i] = parseFile(files[i]);
+    }
+  };
+
+  size_t nThreads = std::min(m_nThreads, files.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < nThreads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+std::optional<Details>
+ServiceDirectoryLoader::parseFile(const std::string& file)
+{
+  if (!boost::filesystem::exists(file)) {
+    return std::nullopt;
+  }
+  try {
+    ServiceInfoFileProcessor processor(file);
+    if (processor.getServiceName().empty() || processor.getAppPrefix().empty()) {
+      NDNSD_LOG_ERROR("Missing serviceName or appPrefix in " << file);
+      return std::nullopt;
+    }
+    Details details;
+    details.serviceName = processor.getServiceName();
+    details.applicationPrefix = processor.getAppPrefix();
+    details.serviceLifetime = static_cast<int>(processor.getServiceLifetime().count());
+    details.serviceMetaInfo = processor.getServiceMeta();
+    return details;
+  }
+  catch (const std::exception& e) {
+    NDNSD_LOG_ERROR("Cannot parse " << file << ": " << e.what());
+    return std::nullopt;
+  }
+}
+
+size_t
+ServiceDirectoryLoader::apply(const std::vector<std::string>& files)
+{
+  auto results = parse(files);
+  time_t now = ndn::time::system_clock::to_time_t(ndn::time::system_clock::now());
+  size_t nChanged = 0;
+
+  // removals first, so that a file renamed or a second file of the same service is not
+  // withdrawn after being published
+  std::vector<Details> removed;
+  for (size_t i = 0; i < files.size(); ++i) {
+    auto it = m_services.find(files[i]);
+    // unreadable files keep their last good content until they are removed
+    if (!results[i] && it != m_services.end() && !boost::filesystem::exists(files[i])) {
+      NDNSD_LOG_INFO("Service file removed: " << files[i]);
+      removed.push_back(std::move(it->second));
+      m_services.erase(it);
+      ++nChanged;
+    }
+  }
+
+  std::set<ndn::Name> published;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!results[i]) {
+      continue;
+    }
+    Details& details = *results[i];
+    auto it = m_services.find(files[i]);
+    if (it != m_services.end() && isSameService(it->second, details)) {
+      continue;
+    }
+    details.publishTimestamp = now;
+    m_services[files[i]] = details;
+    published.insert(details.serviceName);
+    ++nChanged;
+    m_onChange(details);
+  }
+
+  // services are withdrawn by serviceName, only once no file provides them
+  for (const auto& details : removed) {
+    if (published.count(details.serviceName) > 0) {
+      continue;
+    }
+    auto remaining = std::find_if(m_services.begin(), m_services.end(), [&] (const auto& item) {
+      return item.second.serviceName == details.serviceName;
+    });
+    if (remaining == m_services.end()) {
+      if (m_onRemove) {
+        m_onRemove(details);
+      }
+    }
+    else {
+      // the removed file may have been the last one published, publish the remaining one
+      remaining->second.publishTimestamp = now;
+      m_onChange(remaining->second);
+    }
+    published.insert(details.serviceName);
+  }
+  NDNSD_LOG_DEBUG("Parsed " << files.size() << " files, " << nChanged << " changed");
+  return nChanged;
+}
+
+void
+ServiceDirectoryLoader::readEvents()
+{
+#ifdef __linux__
+  m_inotify.async_read_some(boost::asio::buffer(m_eventBuffer),
+    [this] (const boost::system::error_code& error, size_t nBytes) {
+      if (error) {
+        if (error != boost::asio::error::operation_aborted) {
+          NDNSD_LOG_ERROR("inotify read: " << error.message());
+        }
+        return;
+      }
+
+      for (size_t offset = 0; offset + sizeof(inotify_event) <= nBytes;) {
+        inotify_event event;
+        std::memcpy(&event, m_eventBuffer.data() + offset, sizeof(event));
+        if (event.mask & IN_Q_OVERFLOW) {
+          m_needsFullReload = true;
+        }
+        else if (event.len > 0) {
+          std::string name(m_eventBuffer.data() + offset + sizeof(event));
+          if (isInfoFile(name)) {
+            m_pending.insert((boost::filesystem::path(m_directory) / name).string());
+          }
+        }
+        offset += sizeof(event) + event.len;
+      }
+
+      if (m_needsFullReload || !m_pending.empty()) {
+        m_reloadEvent = m_scheduler.schedule(RELOAD_DELAY, [this] { reloadPending(); });
+      }
+      readEvents();
+    });
+#endif
+}
+
+void
+ServiceDirectoryLoader::reloadPending()
+{
+  if (m_needsFullReload) {
+    NDNSD_LOG_INFO("inotify queue overflowed, reloading " << m_directory);
+    m_needsFullReload = false;
+    m_pending.clear();
+    load();
+    return;
+  }
+
+  std::vector<std::string> files(m_pending.begin(), m_pending.end());
+  m_pending.clear();
+  apply(files);
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,144 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_DIRECTORY_LOADER_HPP
+#define NDNSD_DIRECTORY_LOADER_HPP
+
+#include "details.hpp"
+
+#include <ndn-cxx/util/scheduler.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Loads every .info service file of a directory and keeps them current
+
+  Files are parsed with ServiceInfoFileProcessor on a pool of worker threads. The change
+  callback runs on the calling thread (load()) or on the io_service (watched reloads), and
+  only for files whose service content differs from the last load; publishTimestamp is set
+  to the load time. When the last file providing a serviceName is removed, the remove
+  callback runs with the details last loaded from it, so that the caller can withdraw the
+  service; without one, the service stays published until its lease ends. While another
+  file still provides the serviceName, that file is reported as changed instead. A file
+  that cannot be parsed keeps its last good content and is not reported as removed.
+
+  On Linux, watch() follows the directory with inotify and re-parses only the files that
+  were written, moved in or removed, batching events that arrive within RELOAD_DELAY.
+  Elsewhere watch() does nothing and callers reload with load().
+
+  @code
+    ServiceDirectoryLoader loader(face.getIoService(), "/etc/ndnsd/services",
+                                  [&] (const Details& details) {
+                                    serviceDiscovery.publishServiceDetail(details);
+                                  },
+                                  [&] (const Details& details) {
+                                    serviceDiscovery.withdrawServiceDetail(details.serviceName);
+                                  });
+    loader.load();
+    loader.watch();
+  @endcode
+**/
+class ServiceDirectoryLoader
+{
+public:
+  using ChangeCallback = std::function<void(const Details& details)>;
+  using RemoveCallback = std::function<void(const Details& details)>;
+
+  static constexpr ndn::time::milliseconds RELOAD_DELAY = ndn::time::milliseconds(100);
+
+  /**
+    @param nThreads parser threads, 0 for one per core
+  **/
+  ServiceDirectoryLoader(boost::asio::io_service& io, const std::string& directory,
+                         const ChangeCallback& onChange, const RemoveCallback& onRemove = nullptr,
+                         size_t nThreads = 0);
+
+  ~ServiceDirectoryLoader();
+
+  /**
+    @brief parse all .info files of the directory
+    @return number of services reported as changed or removed
+  **/
+  size_t
+  load();
+
+  void
+  watch();
+
+  void
+  stop();
+
+  /**
+    @brief loaded services keyed by file path
+  **/
+  const std::map<std::string, Details>&
+  getServices() const
+  {
+    return m_services;
+  }
+
+private:
+  // parse files in parallel, nullopt for files that could not be parsed
+  std::vector<std::optional<Details>>
+  parse(const std::vector<std::string>& files) const;
+
+  static std::optional<Details>
+  parseFile(const std::string& file);
+
+  // apply parsed files, report changes; a missing file is forgotten
+  size_t
+  apply(const std::vector<std::string>& files);
+
+  void
+  readEvents();
+
+  void
+  reloadPending();
+
+private:
+  const std::string m_directory;
+  ChangeCallback m_onChange;
+  RemoveCallback m_onRemove;
+  size_t m_nThreads;
+  std::map<std::string, Details> m_services;
+
+  ndn::Scheduler m_scheduler;
+  ndn::scheduler::ScopedEventId m_reloadEvent;
+  boost::asio::posix::stream_descriptor m_inotify;
+  std::array<char, 4096> m_eventBuffer;
+  std::set<std::string> m_pending;
+  bool m_needsFullReload = false;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_DIRECTORY_LOADER_HPP
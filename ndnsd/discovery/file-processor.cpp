@@ -18,12 +18,14 @@
  **/
 
 #include "file-processor.hpp"
+#include "info-parser.hpp"
 
+#include <fstream>
 #include <iostream>
 
-#include <ndn-cxx/util/logger.hpp>
+#include "ndnsd/logger.hpp"
 
-NDN_LOG_INIT(ndnsd.FileProcessor);
+INIT_LOGGER(FileProcessor);
 
 namespace ndnsd {
 namespace discovery {
@@ -42,83 +44,41 @@ ServiceInfoFileProcessor::processFile()
 {
   try
   {
-    NDN_LOG_INFO("Reading file: "<< m_filename);
-    boost::property_tree::ptree pt;
-    read_info(m_filename, pt);
-    for (auto& block: pt)
-    {
-      if (block.first == "required")
-      {
-        for (auto& requiredElement: block.second)
-        {
-          const auto& val = requiredElement.second.get_value<std::string >();
-
-          if (requiredElement.first == "serviceName")
-          {
-            m_serviceName = val;
-          }
-          if (requiredElement.first == "appPrefix")
-          {
-            m_applicationPrefix = val;
-          }
-          if (requiredElement.first == "lifetime")
-          {
-              uint32_t lifetime = std::stoi(val);
-              m_serviceLifeTime = ndn::time::seconds(lifetime);
-          }
-        }
-      }
-
-      if (block.first == "details")
-      {
-        m_serviceMetaInfo.clear();
-        for (auto& details: block.second)
-        {
-          const auto& key = details.first; //get_value<std::string >();
-          const auto& val = details.second.get_value<std::string >();
-
-          NDN_LOG_DEBUG("Key: " << key << "Value: " << val);
-
-          m_serviceMetaInfo.insert(std::pair<std::string, std::string>(key, val));
-        }
-      }
-    }
-    NDN_LOG_INFO("Successfully updated the file content: ");
+    NDNSD_LOG_INFO("Reading file: "<< m_filename);
+    Details details = parseServiceInfoFile(m_filename);
+    m_serviceName = details.serviceName;
+    m_applicationPrefix = details.applicationPrefix;
+    m_serviceLifeTime = ndn::time::seconds(details.serviceLifetime);
+    m_serviceMetaInfo = std::move(details.serviceMetaInfo);
+    NDNSD_LOG_INFO("Successfully updated the file content: ");
   }
   catch (std::exception const& e)
   {
     std::cerr << e.what() << std::endl;
-    NDN_LOG_INFO("Error reading file: " << m_filename);
-    throw e;
+    NDNSD_LOG_INFO("Error reading file: " << m_filename);
+    throw;
   }
 }
 
 void ServiceInfoFileProcessor::writeToFile(const std::string& filename)
   {
     try {
-      boost::property_tree::ptree pt;
-
-      // required
-      boost::property_tree::ptree required;
-      required.put("serviceName", m_serviceName.toUri());
-      required.put("appPrefix", m_applicationPrefix.toUri());
-      required.put("lifetime", m_serviceLifeTime.count());
-      pt.add_child("required", required);
-
-      // details
-      boost::property_tree::ptree details;
-      for (const auto& entry : m_serviceMetaInfo) {
-        details.put(entry.first, entry.second);
+      Details details;
+      details.serviceName = m_serviceName;
+      details.applicationPrefix = m_applicationPrefix;
+      details.serviceLifetime = static_cast<int>(m_serviceLifeTime.count());
+      details.serviceMetaInfo = m_serviceMetaInfo;
+
+      std::ofstream file(filename);
+      writeServiceInfo(file, details);
+      if (!file) {
+        throw std::runtime_error("Cannot write " + filename);
       }
-      pt.add_child("details", details);
-
-      // Write to file
-      boost::property_tree::write_info(filename, pt);
-      NDN_LOG_INFO("Successfully wrote to file: " << filename);
+      NDNSD_LOG_INFO("Successfully wrote to file: " << filename);
     } catch (std::exception const& e) {
       std::cerr << e.what() << std::endl;
-      NDN_LOG_ERROR("Error writing to file: " << filename);
-      throw e;
+      NDNSD_LOG_ERROR("Error writing to file: " << filename);
+      throw;
     }
   }
 
@@ -24,8 +24,6 @@
 #include <ndn-cxx/util/time.hpp>
 
 #include <boost/filesystem.hpp>
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/info_parser.hpp>
 
 namespace ndnsd {
 namespace discovery {
@@ -0,0 +1,65 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "heartbeat.hpp"
+
+namespace ndnsd {
+namespace discovery {
+
+static void
+writeUint32(uint8_t* out, uint32_t value)
+{
+  out[0] = static_cast<uint8_t>(value >> 24);
+  out[1] = static_cast<uint8_t>(value >> 16);
+  out[2] = static_cast<uint8_t>(value >> 8);
+  out[3] = static_cast<uint8_t>(value);
+}
+
+static uint32_t
+readUint32(const uint8_t* in)
+{
+  return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+         (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+std::array<uint8_t, Heartbeat::WIRE_SIZE>
+Heartbeat::encode() const
+{
+  std::array<uint8_t, WIRE_SIZE> wire;
+  writeUint32(wire.data(), load);
+  writeUint32(wire.data() + 4, queueDepth);
+  writeUint32(wire.data() + 8, lease);
+  return wire;
+}
+
+std::optional<Heartbeat>
+Heartbeat::decode(const uint8_t* data, size_t size)
+{
+  if (size != WIRE_SIZE) {
+    return std::nullopt;
+  }
+  Heartbeat heartbeat;
+  heartbeat.load = readUint32(data);
+  heartbeat.queueDepth = readUint32(data + 4);
+  heartbeat.lease = readUint32(data + 8);
+  return heartbeat;
+}
+
+} // namespace discovery
+} // namespace ndnsd
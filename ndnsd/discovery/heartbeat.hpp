@@ -0,0 +1,60 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_HEARTBEAT_HPP
+#define NDNSD_HEARTBEAT_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Load report of a published service, sent without its Details
+
+  Published as <applicationPrefix>/<serviceName>/NDNSD/heartbeat/<version>, the prefix
+  being a single component like the node name of service-info publications. The content
+  is WIRE_SIZE bytes: load, queueDepth and lease as big-endian uint32.
+**/
+struct Heartbeat
+{
+  static constexpr size_t WIRE_SIZE = 12;
+
+  // application defined, lower is less loaded
+  uint32_t load = 0;
+  uint32_t queueDepth = 0;
+  // renew the lease for this many seconds from reception, 0 to leave it unchanged
+  uint32_t lease = 0;
+
+  std::array<uint8_t, WIRE_SIZE>
+  encode() const;
+
+  /**
+    @return nullopt unless size is WIRE_SIZE
+  **/
+  static std::optional<Heartbeat>
+  decode(const uint8_t* data, size_t size);
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_HEARTBEAT_HPP
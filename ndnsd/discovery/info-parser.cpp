@@ -0,0 +1,343 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "info-parser.hpp"
+#include "mapped-file.hpp"
+
+#include <charconv>
+
+namespace ndnsd {
+namespace discovery {
+
+bool
+InfoReader::next(Event& event)
+{
+  while (true) {
+    skipBlanks();
+    if (m_pos == m_end) {
+      if (m_depth > 0) {
+        fail("unexpected end of input, missing '}'");
+      }
+      return false;
+    }
+
+    switch (*m_pos) {
+    case ';':
+      while (m_pos != m_end && *m_pos != '\n') {
+        ++m_pos;
+      }
+      continue;
+    case '\n':
+      newLine();
+      continue;
+    case '{':
+      if (!m_hasLastKey) {
+        fail("'{' without a key");
+      }
+      event = {Event::BEGIN_BLOCK, m_lastKey, {}, m_depth, m_line, getColumn()};
+      ++m_pos;
+      ++m_depth;
+      m_hasLastKey = false;
+      return true;
+    case '}':
+      if (m_depth == 0) {
+        fail("unmatched '}'");
+      }
+      event = {Event::END_BLOCK, {}, {}, m_depth - 1, m_line, getColumn()};
+      ++m_pos;
+      --m_depth;
+      m_hasLastKey = false;
+      return true;
+    case '#':
+      fail("#include is not supported");
+    default:
+      break;
+    }
+
+    size_t line = m_line;
+    size_t column = getColumn();
+    std::string_view key = readString(m_keyScratch);
+    std::string_view value;
+    skipBlanks();
+    if (!atLineEnd()) {
+      value = readString(m_valueScratch);
+      skipBlanks();
+      if (!atLineEnd()) {
+        fail("unexpected text after value");
+      }
+    }
+    m_lastKey = key;
+    m_hasLastKey = true;
+    event = {Event::ENTRY, key, value, m_depth, line, column};
+    return true;
+  }
+}
+
+void
+InfoReader::fail(const std::string& what) const
+{
+  throw Error(what, m_line, getColumn());
+}
+
+void
+InfoReader::skipBlanks()
+{
+  while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\r')) {
+    ++m_pos;
+  }
+}
+
+std::string_view
+InfoReader::readString(std::string& scratch)
+{
+  if (*m_pos == '"') {
+    return readQuoted(scratch);
+  }
+
+  const char* begin = m_pos;
+  while (m_pos != m_end && *m_pos != ' ' && *m_pos != '\t' && *m_pos != '\r' &&
+         *m_pos != '\n' && *m_pos != ';' && *m_pos != '{' && *m_pos != '}' && *m_pos != '"') {
+    ++m_pos;
+  }
+  return std::string_view(begin, static_cast<size_t>(m_pos - begin));
+}
+
+std::string_view
+InfoReader::readQuoted(std::string& scratch)
+{
+  // the string is a view into the input until an escape or a continuation forces a copy
+  bool isCopied = false;
+  std::string_view view;
+  for (bool isFirst = true; ; isFirst = false) {
+    if (!isFirst && !isCopied) {
+      scratch.assign(view.data(), view.size());
+      isCopied = true;
+    }
+    const char* run = ++m_pos;
+    while (true) {
+      if (m_pos == m_end || *m_pos == '\n') {
+        fail("unterminated string");
+      }
+      if (*m_pos == '"') {
+        break;
+      }
+      if (*m_pos != '\\') {
+        ++m_pos;
+        continue;
+      }
+
+      if (isCopied) {
+        scratch.append(run, m_pos);
+      }
+      else {
+        scratch.assign(run, m_pos);
+        isCopied = true;
+      }
+      if (++m_pos == m_end) {
+        fail("unterminated string");
+      }
+      switch (*m_pos) {
+      case '0': scratch.push_back('\0'); break;
+      case 'a': scratch.push_back('\a'); break;
+      case 'b': scratch.push_back('\b'); break;
+      case 'f': scratch.push_back('\f'); break;
+      case 'n': scratch.push_back('\n'); break;
+      case 'r': scratch.push_back('\r'); break;
+      case 't': scratch.push_back('\t'); break;
+      case 'v': scratch.push_back('\v'); break;
+      case '"': scratch.push_back('"'); break;
+      case '\'': scratch.push_back('\''); break;
+      case '\\': scratch.push_back('\\'); break;
+      default:
+        fail(std::string("unknown escape sequence '\\") + *m_pos + "'");
+      }
+      run = ++m_pos;
+    }
+
+    if (isCopied) {
+      scratch.append(run, m_pos);
+    }
+    else {
+      view = std::string_view(run, static_cast<size_t>(m_pos - run));
+    }
+    ++m_pos;
+
+    // a backslash at the end of the line continues the string with the next quoted one
+    skipBlanks();
+    if (m_pos == m_end || *m_pos != '\\') {
+      return isCopied ? std::string_view(scratch) : view;
+    }
+    ++m_pos;
+    skipBlanks();
+    if (m_pos == m_end || *m_pos != '\n') {
+      fail("expected end of line after '\\'");
+    }
+    newLine();
+    skipBlanks();
+    if (m_pos == m_end || *m_pos != '"') {
+      fail("expected a string after line continuation");
+    }
+  }
+}
+
+Details
+parseServiceInfo(std::string_view input)
+{
+  enum Section {
+    NONE,
+    REQUIRED,
+    DETAILS,
+    OTHER,
+  };
+
+  Details details;
+  Section section = NONE;
+  InfoReader reader(input);
+  InfoReader::Event event;
+  while (reader.next(event)) {
+    if (event.type == InfoReader::Event::BEGIN_BLOCK && event.depth == 0) {
+      if (event.key == "required") {
+        section = REQUIRED;
+      }
+      else if (event.key == "details") {
+        section = DETAILS;
+        details.serviceMetaInfo.clear();
+      }
+      else {
+        section = OTHER;
+      }
+      continue;
+    }
+    if (event.type == InfoReader::Event::END_BLOCK && event.depth == 0) {
+      section = NONE;
+      continue;
+    }
+    // entries nested deeper than a section are not part of the service description
+    if (event.type != InfoReader::Event::ENTRY || event.depth != 1) {
+      continue;
+    }
+
+    if (section == REQUIRED) {
+      try {
+        if (event.key == "serviceName") {
+          details.serviceName = ndn::Name(std::string(event.value));
+        }
+        else if (event.key == "appPrefix") {
+          details.applicationPrefix = ndn::Name(std::string(event.value));
+        }
+        else if (event.key == "lifetime") {
+          uint32_t lifetime = 0;
+          auto [end, ec] = std::from_chars(event.value.data(),
+                                           event.value.data() + event.value.size(), lifetime);
+          if (ec != std::errc() || end != event.value.data() + event.value.size()) {
+            throw InfoReader::Error("invalid lifetime '" + std::string(event.value) + "'",
+                                    event.line, event.column);
+          }
+          details.serviceLifetime = static_cast<int>(lifetime);
+        }
+      }
+      catch (const ndn::Name::Error& e) {
+        throw InfoReader::Error(e.what(), event.line, event.column);
+      }
+    }
+    else if (section == DETAILS) {
+      details.serviceMetaInfo.emplace(event.key, event.value);
+    }
+  }
+  return details;
+}
+
+Details
+parseServiceInfoFile(const std::string& filename)
+{
+  MappedFile file(filename);
+  if (!file.isOpen()) {
+    throw InfoReader::Error("cannot read " + filename, 0, 0);
+  }
+  return parseServiceInfo(file.view());
+}
+
+static bool
+needsQuotes(std::string_view text)
+{
+  if (text.empty() || text.front() == '#') {
+    return true;
+  }
+  for (char c : text) {
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ';' || c == '{' || c == '}' ||
+        c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+writeString(std::ostream& os, std::string_view text)
+{
+  if (!needsQuotes(text)) {
+    os << text;
+    return;
+  }
+
+  os << '"';
+  for (char c : text) {
+    switch (c) {
+    case '\0': os << "\\0"; break;
+    case '\a': os << "\\a"; break;
+    case '\b': os << "\\b"; break;
+    case '\f': os << "\\f"; break;
+    case '\n': os << "\\n"; break;
+    case '\r': os << "\\r"; break;
+    case '\t': os << "\\t"; break;
+    case '\v': os << "\\v"; break;
+    case '"': os << "\\\""; break;
+    case '\\': os << "\\\\"; break;
+    default: os << c; break;
+    }
+  }
+  os << '"';
+}
+
+static void
+writeEntry(std::ostream& os, std::string_view key, std::string_view value)
+{
+  os << "    ";
+  writeString(os, key);
+  os << ' ';
+  writeString(os, value);
+  os << '\n';
+}
+
+void
+writeServiceInfo(std::ostream& os, const Details& details)
+{
+  os << "required\n{\n";
+  writeEntry(os, "serviceName", details.serviceName.toUri());
+  writeEntry(os, "appPrefix", details.applicationPrefix.toUri());
+  writeEntry(os, "lifetime", std::to_string(details.serviceLifetime));
+  os << "}\ndetails\n{\n";
+  for (const auto& [key, value] : details.serviceMetaInfo) {
+    writeEntry(os, key, value);
+  }
+  os << "}\n";
+}
+
+} // namespace discovery
+} // namespace ndnsd
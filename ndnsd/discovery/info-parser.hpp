@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_INFO_PARSER_HPP
+#define NDNSD_INFO_PARSER_HPP
+
+#include "details.hpp"
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Single pass pull parser for the INFO format of service files
+
+  Supports the subset of boost::property_tree's INFO syntax that service files use: lines
+  of "key [value]", blocks in braces (on the key line or the next one), ";" comments, and
+  quoted strings with C escapes and "\" line continuation. #include is not supported.
+
+  Keys and values are views into the input unless they had to be unescaped, in which case
+  they point into a buffer reused by the next event. The input must outlive the reader.
+**/
+class InfoReader
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    Error(const std::string& what, size_t line, size_t column)
+      : std::runtime_error(std::to_string(line) + ":" + std::to_string(column) + ": " + what)
+      , m_line(line)
+      , m_column(column)
+    {
+    }
+
+    size_t
+    getLine() const
+    {
+      return m_line;
+    }
+
+    size_t
+    getColumn() const
+    {
+      return m_column;
+    }
+
+  private:
+    size_t m_line;
+    size_t m_column;
+  };
+
+  struct Event
+  {
+    enum Type : uint8_t {
+      // "key [value]", value is empty if absent
+      ENTRY,
+      // "{" opening the children of the last ENTRY, key is that entry's key
+      BEGIN_BLOCK,
+      END_BLOCK,
+    };
+
+    Type type;
+    std::string_view key;
+    std::string_view value;
+    // nesting level of the entry, or of the entry owning the block; 0 at top level
+    size_t depth;
+    size_t line;
+    size_t column;
+  };
+
+  explicit
+  InfoReader(std::string_view input)
+    : m_pos(input.data())
+    , m_end(input.data() + input.size())
+    , m_lineStart(input.data())
+  {
+  }
+
+  /**
+    @brief read the next event
+    @return false at the end of input
+    @throw Error on a syntax error, with the line and column of the offending character
+  **/
+  bool
+  next(Event& event);
+
+private:
+  [[noreturn]] void
+  fail(const std::string& what) const;
+
+  size_t
+  getColumn() const
+  {
+    return static_cast<size_t>(m_pos - m_lineStart) + 1;
+  }
+
+  void
+  skipBlanks();
+
+  void
+  newLine()
+  {
+    ++m_pos;
+    ++m_line;
+    m_lineStart = m_pos;
+  }
+
+  // read a quoted or bare string, scratch holds it if it had to be unescaped
+  std::string_view
+  readString(std::string& scratch);
+
+  std::string_view
+  readQuoted(std::string& scratch);
+
+  bool
+  atLineEnd() const
+  {
+    return m_pos == m_end || *m_pos == '\n' || *m_pos == ';' || *m_pos == '{' || *m_pos == '}';
+  }
+
+private:
+  const char* m_pos;
+  const char* m_end;
+  const char* m_lineStart;
+  size_t m_line = 1;
+  size_t m_depth = 0;
+  // key of the last entry at the current depth, for BEGIN_BLOCK
+  std::string_view m_lastKey;
+  bool m_hasLastKey = false;
+  std::string m_keyScratch;
+  std::string m_valueScratch;
+};
+
+/**
+  @brief fill Details from a service file: required { serviceName, appPrefix, lifetime }
+         and details { key value ... } blocks
+  @throw InfoReader::Error
+**/
+Details
+parseServiceInfo(std::string_view input);
+
+/**
+  @brief parseServiceInfo over a memory-mapped file
+  @throw InfoReader::Error, also when the file cannot be read
+**/
+Details
+parseServiceInfoFile(const std::string& filename);
+
+/**
+  @brief write details in the service file format read by parseServiceInfo
+**/
+void
+writeServiceInfo(std::ostream& os, const Details& details);
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_INFO_PARSER_HPP
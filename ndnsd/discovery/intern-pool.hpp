@@ -0,0 +1,209 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_INTERN_POOL_HPP
+#define NDNSD_INTERN_POOL_HPP
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Pool of unique, reference-counted values.
+
+  intern() returns a Handle to the single pooled copy of a value; two handles from the same
+  pool are equal iff they point at the same node, so equality and hashing are pointer
+  operations. A value is removed from the pool when its last handle goes away.
+
+  The pool is not thread-safe and must outlive every handle it gave out.
+**/
+template<typename T, typename Hash = std::hash<T>>
+class InternPool
+{
+private:
+  struct RefCount
+  {
+    uint32_t count;
+    InternPool* pool;
+  };
+
+  using Node = std::pair<const T, RefCount>;
+
+public:
+  class Handle
+  {
+  public:
+    Handle() = default;
+
+    Handle(const Handle& other) noexcept
+      : m_node(other.m_node)
+    {
+      acquire();
+    }
+
+    Handle(Handle&& other) noexcept
+      : m_node(std::exchange(other.m_node, nullptr))
+    {
+    }
+
+    Handle&
+    operator=(Handle other) noexcept
+    {
+      std::swap(m_node, other.m_node);
+      return *this;
+    }
+
+    ~Handle()
+    {
+      release();
+    }
+
+    const T&
+    operator*() const
+    {
+      return m_node->first;
+    }
+
+    const T*
+    operator->() const
+    {
+      return &m_node->first;
+    }
+
+    explicit
+    operator bool() const
+    {
+      return m_node != nullptr;
+    }
+
+    // stable identity of the pooled value, usable as a hash key
+    const void*
+    identity() const
+    {
+      return m_node;
+    }
+
+    friend bool
+    operator==(const Handle& a, const Handle& b)
+    {
+      return a.m_node == b.m_node;
+    }
+
+    friend bool
+    operator!=(const Handle& a, const Handle& b)
+    {
+      return a.m_node != b.m_node;
+    }
+
+  private:
+    explicit
+    Handle(Node* node) noexcept
+      : m_node(node)
+    {
+      acquire();
+    }
+
+    void
+    acquire() noexcept
+    {
+      if (m_node != nullptr) {
+        ++m_node->second.count;
+      }
+    }
+
+    void
+    release() noexcept
+    {
+      if (m_node != nullptr && --m_node->second.count == 0) {
+        m_node->second.pool->erase(m_node);
+      }
+      m_node = nullptr;
+    }
+
+  private:
+    Node* m_node = nullptr;
+
+    friend InternPool;
+  };
+
+  InternPool() = default;
+  InternPool(const InternPool&) = delete;
+  InternPool& operator=(const InternPool&) = delete;
+
+  Handle
+  intern(const T& value)
+  {
+    auto it = m_values.try_emplace(value, RefCount{0, this}).first;
+    return Handle(&*it);
+  }
+
+  /**
+    @brief look up a value without adding it
+    @return an empty handle if the value is not pooled
+  **/
+  Handle
+  find(const T& value) const
+  {
+    auto it = m_values.find(value);
+    if (it == m_values.end()) {
+      return Handle();
+    }
+    return Handle(const_cast<Node*>(&*it));
+  }
+
+  size_t
+  size() const
+  {
+    return m_values.size();
+  }
+
+  template<typename Visitor>
+  void
+  forEach(Visitor&& visitor) const
+  {
+    for (const auto& node : m_values) {
+      visitor(node.first, node.second.count);
+    }
+  }
+
+  size_t
+  bucket_count() const
+  {
+    return m_values.bucket_count();
+  }
+
+private:
+  void
+  erase(Node* node)
+  {
+    m_values.erase(m_values.find(node->first));
+  }
+
+private:
+  std::unordered_map<T, RefCount, Hash> m_values;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_INTERN_POOL_HPP
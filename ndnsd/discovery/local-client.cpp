@@ -0,0 +1,85 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "local-client.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace ndnsd {
+namespace discovery {
+
+static int
+connectTo(const std::string& socketPath)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    throw LocalClient::Error("Socket path too long: " + socketPath);
+  }
+  std::memcpy(address.sun_path, socketPath.data(), socketPath.size());
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw LocalClient::Error(std::string("Cannot create socket: ") + std::strerror(errno));
+  }
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+    std::string reason = std::strerror(errno);
+    ::close(fd);
+    throw LocalClient::Error("Cannot connect to ndnsd on " + socketPath + ": " + reason);
+  }
+  return fd;
+}
+
+LocalClient::LocalClient(const std::string& socketPath, const std::string& sharedRegistryName)
+  : m_registry(sharedRegistryName)
+  , m_fd(connectTo(socketPath))
+{
+}
+
+LocalClient::~LocalClient()
+{
+  ::close(m_fd);
+}
+
+void
+LocalClient::publishServiceDetail(const Details& details)
+{
+  ndn::Block block = details.encode();
+  const uint8_t* data = block.data();
+  size_t size = block.size();
+  while (size > 0) {
+    ssize_t n = ::send(m_fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw Error(std::string("Cannot send to ndnsd: ") + std::strerror(errno));
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,91 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_LOCAL_CLIENT_HPP
+#define NDNSD_LOCAL_CLIENT_HPP
+
+#include "details.hpp"
+#include "shared-registry.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Access to the host's ndnsd daemon for applications that do not run their own
+         ServiceDiscovery
+
+  Services are published through the daemon's Unix socket (see LocalServer); received
+  services are read from the daemon's shared memory registry, without any IPC round trip.
+  The client takes no part in sync and needs no Face.
+
+  @code
+    LocalClient ndnsd;
+    ndnsd.publishServiceDetail(details);
+    auto printer = ndnsd.getRegistry().find("/uofm/printer1", "/printer");
+  @endcode
+**/
+class LocalClient
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  static constexpr const char* DEFAULT_SOCKET_PATH = "/run/ndnsd.sock";
+  static constexpr const char* DEFAULT_SHARED_REGISTRY = "/ndnsd";
+
+  /**
+    @throw Error if the daemon is not running
+  **/
+  explicit
+  LocalClient(const std::string& socketPath = DEFAULT_SOCKET_PATH,
+              const std::string& sharedRegistryName = DEFAULT_SHARED_REGISTRY);
+
+  LocalClient(const LocalClient&) = delete;
+  LocalClient& operator=(const LocalClient&) = delete;
+
+  ~LocalClient();
+
+  /**
+    @brief have the daemon publish details in its service group
+    @throw Error if the daemon closed the connection
+  **/
+  void
+  publishServiceDetail(const Details& details);
+
+  const SharedRegistryReader&
+  getRegistry() const
+  {
+    return m_registry;
+  }
+
+private:
+  SharedRegistryReader m_registry;
+  int m_fd = -1;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_LOCAL_CLIENT_HPP
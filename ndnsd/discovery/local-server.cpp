@@ -0,0 +1,185 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "local-server.hpp"
+#include "ndnsd/logger.hpp"
+
+#include <ndn-cxx/encoding/block.hpp>
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <array>
+#include <cstring>
+
+#include <unistd.h>
+
+INIT_LOGGER(LocalServer);
+
+namespace ndnsd {
+namespace discovery {
+
+class LocalServer::Session : public std::enable_shared_from_this<Session>
+{
+public:
+  Session(LocalServer& server, boost::asio::local::stream_protocol::socket socket)
+    : m_server(server)
+    , m_socket(std::move(socket))
+  {
+  }
+
+  void
+  read()
+  {
+    m_socket.async_read_some(boost::asio::buffer(m_buffer.data() + m_size,
+                                                 m_buffer.size() - m_size),
+      [self = shared_from_this()] (const boost::system::error_code& ec, size_t nRead) {
+        // the server is gone when the operation was aborted
+        if (ec == boost::asio::error::operation_aborted) {
+          return;
+        }
+        if (ec) {
+          self->close();
+          return;
+        }
+        self->m_size += nRead;
+        if (self->process()) {
+          self->read();
+        }
+      });
+  }
+
+  void
+  close()
+  {
+    boost::system::error_code ec;
+    m_socket.close(ec);
+    m_server.m_sessions.erase(shared_from_this());
+  }
+
+  void
+  cancel()
+  {
+    boost::system::error_code ec;
+    m_socket.close(ec);
+  }
+
+private:
+  // hand over the complete TLVs in the buffer, false if the client was dropped
+  bool
+  process()
+  {
+    size_t offset = 0;
+    while (offset < m_size) {
+      auto [isOk, block] = ndn::Block::fromBuffer(
+        ndn::span<const uint8_t>(m_buffer.data() + offset, m_size - offset));
+      if (!isOk) {
+        break;
+      }
+      offset += block.size();
+
+      auto details = Details::tryDecode(block.data(), block.data() + block.size());
+      if (!details) {
+        NDNSD_LOG_DEBUG("Dropping client sending an invalid service: " << details.errorMessage());
+        close();
+        return false;
+      }
+      m_server.m_onPublish(*details);
+    }
+
+    std::memmove(m_buffer.data(), m_buffer.data() + offset, m_size - offset);
+    m_size -= offset;
+    if (m_size == m_buffer.size()) {
+      NDNSD_LOG_DEBUG("Dropping client sending a service over " << m_buffer.size() << " bytes");
+      close();
+      return false;
+    }
+    return true;
+  }
+
+private:
+  LocalServer& m_server;
+  boost::asio::local::stream_protocol::socket m_socket;
+  std::array<uint8_t, ndn::MAX_NDN_PACKET_SIZE> m_buffer;
+  size_t m_size = 0;
+};
+
+LocalServer::LocalServer(boost::asio::io_service& io, const std::string& socketPath,
+                         const PublishCallback& onPublish)
+  : m_acceptor(io)
+  , m_socketPath(socketPath)
+  , m_onPublish(onPublish)
+{
+}
+
+LocalServer::~LocalServer()
+{
+  boost::system::error_code ec;
+  if (m_acceptor.is_open()) {
+    m_acceptor.close(ec);
+    ::unlink(m_socketPath.data());
+  }
+  for (const auto& session : m_sessions) {
+    session->cancel();
+  }
+}
+
+void
+LocalServer::start()
+{
+  // a socket file left by a previous daemon would make bind() fail
+  ::unlink(m_socketPath.data());
+
+  boost::system::error_code ec;
+  boost::asio::local::stream_protocol::endpoint endpoint(m_socketPath);
+  m_acceptor.open(endpoint.protocol(), ec);
+  if (!ec) {
+    m_acceptor.bind(endpoint, ec);
+  }
+  if (!ec) {
+    m_acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
+  }
+  if (ec) {
+    throw Error("Cannot listen on " + m_socketPath + ": " + ec.message());
+  }
+  NDNSD_LOG_INFO("Listening on " << m_socketPath);
+  accept();
+}
+
+void
+LocalServer::accept()
+{
+  m_acceptor.async_accept([this] (const boost::system::error_code& ec,
+                                  boost::asio::local::stream_protocol::socket socket) {
+    if (ec == boost::asio::error::operation_aborted) {
+      return;
+    }
+    if (ec) {
+      NDNSD_LOG_WARN("Cannot accept a client: " << ec.message());
+    }
+    else {
+      auto session = std::make_shared<Session>(*this, std::move(socket));
+      m_sessions.insert(session);
+      NDNSD_LOG_DEBUG("Client connected, " << m_sessions.size() << " clients");
+      session->read();
+    }
+    accept();
+  });
+}
+
+} // namespace discovery
+} // namespace ndnsd
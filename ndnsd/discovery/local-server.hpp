@@ -0,0 +1,90 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_LOCAL_SERVER_HPP
+#define NDNSD_LOCAL_SERVER_HPP
+
+#include "details.hpp"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Unix stream socket on which local applications hand services to the ndnsd daemon
+
+  A client sends a sequence of ServiceInfo TLVs, each one is decoded and passed to the
+  publish callback on the io_service. There is no reply; a client sending a malformed TLV
+  or one larger than ndn::MAX_NDN_PACKET_SIZE is disconnected.
+**/
+class LocalServer
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  using PublishCallback = std::function<void(const Details& details)>;
+
+  LocalServer(boost::asio::io_service& io, const std::string& socketPath,
+              const PublishCallback& onPublish);
+
+  // removes the socket file
+  ~LocalServer();
+
+  /**
+    @brief listen on the socket path, replacing a stale socket file
+    @throw Error if the socket cannot be bound
+  **/
+  void
+  start();
+
+  size_t
+  getClientCount() const
+  {
+    return m_sessions.size();
+  }
+
+private:
+  class Session;
+
+  void
+  accept();
+
+private:
+  boost::asio::local::stream_protocol::acceptor m_acceptor;
+  std::string m_socketPath;
+  PublishCallback m_onPublish;
+  std::set<std::shared_ptr<Session>> m_sessions;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_LOCAL_SERVER_HPP
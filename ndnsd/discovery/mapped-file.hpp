@@ -0,0 +1,78 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_MAPPED_FILE_HPP
+#define NDNSD_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Read-only mapping of a whole file, empty if the file cannot be opened
+**/
+class MappedFile
+{
+public:
+  explicit
+  MappedFile(const std::string& path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool
+  isOpen() const
+  {
+    return m_isOpen;
+  }
+
+  const uint8_t*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  std::string_view
+  view() const
+  {
+    return std::string_view(reinterpret_cast<const char*>(m_data), m_size);
+  }
+
+private:
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  bool m_isOpen = false;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_MAPPED_FILE_HPP
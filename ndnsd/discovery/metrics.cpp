@@ -0,0 +1,218 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "metrics.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+INIT_LOGGER(Metrics);
+
+namespace ndnsd {
+namespace discovery {
+
+uint64_t
+Counter::get() const
+{
+  uint64_t value = 0;
+  for (const auto& slot : m_slots) {
+    value += slot.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+int64_t
+Gauge::get() const
+{
+  int64_t value = 0;
+  for (const auto& slot : m_slots) {
+    value += slot.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+uint64_t
+HistogramSnapshot::getUpperBound(size_t i)
+{
+  return i + 1 < Histogram::N_BUCKETS ? Histogram::getLowerBound(i + 1)
+                                      : std::numeric_limits<uint64_t>::max();
+}
+
+uint64_t
+HistogramSnapshot::getQuantile(double q) const
+{
+  if (count == 0) {
+    return 0;
+  }
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      return getUpperBound(i);
+    }
+  }
+  return getUpperBound(buckets.size() - 1);
+}
+
+HistogramSnapshot&
+HistogramSnapshot::operator+=(const HistogramSnapshot& other)
+{
+  count += other.count;
+  sum += other.sum;
+  buckets.resize(std::max(buckets.size(), other.buckets.size()));
+  for (size_t i = 0; i < other.buckets.size(); ++i) {
+    buckets[i] += other.buckets[i];
+  }
+  return *this;
+}
+
+HistogramSnapshot
+Histogram::snapshot() const
+{
+  HistogramSnapshot snapshot;
+  snapshot.buckets.resize(N_BUCKETS);
+  for (const auto& slot : m_slots) {
+    for (size_t i = 0; i < N_BUCKETS; ++i) {
+      uint64_t n = slot.buckets[i].load(std::memory_order_relaxed);
+      snapshot.buckets[i] += n;
+      snapshot.count += n;
+    }
+    snapshot.sum += slot.sum.load(std::memory_order_relaxed);
+  }
+  return snapshot;
+}
+
+Counter&
+Metrics::getCounter(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_counters[name];
+  if (entry.metric == nullptr) {
+    entry.help = help;
+    entry.metric = std::make_unique<Counter>();
+  }
+  return *entry.metric;
+}
+
+Gauge&
+Metrics::getGauge(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_gauges[name];
+  if (entry.metric == nullptr) {
+    entry.help = help;
+    entry.metric = std::make_unique<Gauge>();
+  }
+  return *entry.metric;
+}
+
+Histogram&
+Metrics::getHistogram(const std::string& name, const std::string& help)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_histograms[name];
+  if (entry.metric == nullptr) {
+    entry.help = help;
+    entry.metric = std::make_unique<Histogram>();
+  }
+  return *entry.metric;
+}
+
+MetricsSnapshot
+Metrics::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  MetricsSnapshot snapshot;
+  for (const auto& [name, entry] : m_counters) {
+    snapshot.counters[name] = entry.metric->get();
+  }
+  for (const auto& [name, entry] : m_gauges) {
+    snapshot.gauges[name] = entry.metric->get();
+  }
+  for (const auto& [name, entry] : m_histograms) {
+    snapshot.histograms[name] = entry.metric->snapshot();
+  }
+  return snapshot;
+}
+
+void
+Metrics::writePrometheus(std::ostream& os) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& [name, entry] : m_counters) {
+    os << "# HELP " << name << ' ' << entry.help << '\n'
+       << "# TYPE " << name << " counter\n"
+       << name << ' ' << entry.metric->get() << '\n';
+  }
+  for (const auto& [name, entry] : m_gauges) {
+    os << "# HELP " << name << ' ' << entry.help << '\n'
+       << "# TYPE " << name << " gauge\n"
+       << name << ' ' << entry.metric->get() << '\n';
+  }
+  for (const auto& [name, entry] : m_histograms) {
+    HistogramSnapshot snapshot = entry.metric->snapshot();
+    os << "# HELP " << name << ' ' << entry.help << '\n'
+       << "# TYPE " << name << " histogram\n";
+    // buckets are cumulative and bounded in seconds; the log-linear buckets are merged into
+    // power of two ones, which keeps the exposition short
+    uint64_t cumulative = 0;
+    auto precision = os.precision(10);
+    for (size_t i = 0; i + 1 < snapshot.buckets.size(); ++i) {
+      cumulative += snapshot.buckets[i];
+      uint64_t bound = HistogramSnapshot::getUpperBound(i);
+      if ((bound & (bound - 1)) == 0) {
+        os << name << "_bucket{le=\"" << bound / 1e6 << "\"} " << cumulative << '\n';
+      }
+    }
+    os.precision(precision);
+    os << name << "_bucket{le=\"+Inf\"} " << snapshot.count << '\n'
+       << name << "_sum " << snapshot.sum / 1e6 << '\n'
+       << name << "_count " << snapshot.count << '\n';
+  }
+}
+
+bool
+Metrics::dump(const std::string& path) const
+{
+  std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::trunc);
+    writePrometheus(file);
+    if (!file.flush()) {
+      NDNSD_LOG_WARN("Cannot write " << tmpPath);
+      std::remove(tmpPath.data());
+      return false;
+    }
+  }
+  if (std::rename(tmpPath.data(), path.data()) != 0) {
+    NDNSD_LOG_WARN("Cannot replace " << path << ": " << std::strerror(errno));
+    std::remove(tmpPath.data());
+    return false;
+  }
+  return true;
+}
+
+} // namespace discovery
+} // namespace ndnsd
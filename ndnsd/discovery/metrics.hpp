@@ -0,0 +1,265 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_METRICS_HPP
+#define NDNSD_METRICS_HPP
+
+#include <ndn-cxx/util/time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+namespace detail {
+
+// counters and histograms are split in this many slots, each written by its own threads
+constexpr size_t N_METRIC_SLOTS = 16;
+
+inline size_t
+getThreadSlot()
+{
+  static std::atomic<size_t> nThreads{0};
+  thread_local size_t slot = nThreads.fetch_add(1, std::memory_order_relaxed) % N_METRIC_SLOTS;
+  return slot;
+}
+
+} // namespace detail
+
+/**
+  @brief monotonic counter, lock-free to increment from any thread
+
+  Each thread adds to its own cache line, get() sums them.
+**/
+class Counter
+{
+public:
+  void
+  add(uint64_t n = 1)
+  {
+    m_slots[detail::getThreadSlot()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  uint64_t
+  get() const;
+
+private:
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t> value{0};
+  };
+  std::array<Slot, detail::N_METRIC_SLOTS> m_slots;
+};
+
+/**
+  @brief value that goes up and down, like Counter but signed
+
+  Instances sharing a Gauge add their own contribution to it, so that it holds their sum.
+**/
+class Gauge
+{
+public:
+  void
+  add(int64_t n)
+  {
+    m_slots[detail::getThreadSlot()].value.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  int64_t
+  get() const;
+
+private:
+  struct alignas(64) Slot
+  {
+    std::atomic<int64_t> value{0};
+  };
+  std::array<Slot, detail::N_METRIC_SLOTS> m_slots;
+};
+
+struct HistogramSnapshot
+{
+  uint64_t count = 0;
+  // of the recorded values, in microseconds
+  uint64_t sum = 0;
+  // buckets[i] counts the values up to getUpperBound(i) and above the previous bound
+  std::vector<uint64_t> buckets;
+
+  /**
+    @return upper bound of bucket i in microseconds, the last bucket has none
+  **/
+  static uint64_t
+  getUpperBound(size_t i);
+
+  /**
+    @return upper bound of the bucket holding quantile q, within 12.5% of the exact
+            quantile, 0 if empty
+  **/
+  uint64_t
+  getQuantile(double q) const;
+
+  HistogramSnapshot&
+  operator+=(const HistogramSnapshot& other);
+};
+
+/**
+  @brief distribution of durations from 1us to 2^32us (71 min), lock-free to record from
+         any thread
+
+  Buckets are log-linear as in HdrHistogram: every power of two range is split in
+  N_SUB_BUCKETS equal buckets, which bounds the relative error of a bucket to 1/N_SUB_BUCKETS
+  while recording stays a few instructions.
+**/
+class Histogram
+{
+public:
+  static constexpr size_t SUB_BUCKET_BITS = 3;
+  static constexpr size_t N_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+  static constexpr size_t MAX_EXPONENT = 32;
+  // values below N_SUB_BUCKETS have one bucket each, the last bucket is for overflows
+  static constexpr size_t N_BUCKETS =
+    N_SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS) * N_SUB_BUCKETS + 1;
+
+  void
+  record(uint64_t microseconds)
+  {
+    Slot& slot = m_slots[detail::getThreadSlot()];
+    slot.buckets[getBucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    slot.sum.fetch_add(microseconds, std::memory_order_relaxed);
+  }
+
+  void
+  record(ndn::time::nanoseconds duration)
+  {
+    auto microseconds = ndn::time::duration_cast<ndn::time::microseconds>(duration).count();
+    record(static_cast<uint64_t>(std::max<int64_t>(microseconds, 0)));
+  }
+
+  HistogramSnapshot
+  snapshot() const;
+
+  /**
+    @brief bucket of the values in (getLowerBound(i), getLowerBound(i + 1)]
+  **/
+  static size_t
+  getBucket(uint64_t microseconds)
+  {
+    uint64_t x = microseconds == 0 ? 0 : microseconds - 1;
+    if (x < N_SUB_BUCKETS) {
+      return x;
+    }
+    size_t exponent = 63 - __builtin_clzll(x);
+    if (exponent >= MAX_EXPONENT) {
+      return N_BUCKETS - 1;
+    }
+    size_t shift = exponent - SUB_BUCKET_BITS;
+    return N_SUB_BUCKETS + shift * N_SUB_BUCKETS + ((x >> shift) & (N_SUB_BUCKETS - 1));
+  }
+
+  static uint64_t
+  getLowerBound(size_t bucket)
+  {
+    if (bucket < N_SUB_BUCKETS) {
+      return bucket;
+    }
+    size_t shift = (bucket - N_SUB_BUCKETS) / N_SUB_BUCKETS;
+    uint64_t subBucket = (bucket - N_SUB_BUCKETS) % N_SUB_BUCKETS;
+    return (uint64_t(1) << (shift + SUB_BUCKET_BITS)) + (subBucket << shift);
+  }
+
+private:
+  struct alignas(64) Slot
+  {
+    std::array<std::atomic<uint64_t>, N_BUCKETS> buckets{};
+    std::atomic<uint64_t> sum{0};
+  };
+  std::array<Slot, detail::N_METRIC_SLOTS> m_slots;
+};
+
+struct MetricsSnapshot
+{
+  std::map<std::string, uint64_t> counters;
+  std::map<std::string, int64_t> gauges;
+  std::map<std::string, HistogramSnapshot> histograms;
+};
+
+/**
+  @brief named counters, gauges and histograms, see ServiceDiscoveryOptions::metrics
+
+  Metrics are created once and then updated without locks; only creating one takes the
+  registry mutex. Names follow the Prometheus conventions: counters end in _total and
+  histograms, which hold durations, in _seconds.
+**/
+class Metrics
+{
+public:
+  /**
+    @brief the counter called name, created if needed
+  **/
+  Counter&
+  getCounter(const std::string& name, const std::string& help);
+
+  Gauge&
+  getGauge(const std::string& name, const std::string& help);
+
+  Histogram&
+  getHistogram(const std::string& name, const std::string& help);
+
+  MetricsSnapshot
+  snapshot() const;
+
+  /**
+    @brief write every metric in the Prometheus text exposition format
+  **/
+  void
+  writePrometheus(std::ostream& os) const;
+
+  /**
+    @brief replace the file at path by the output of writePrometheus(), atomically so that a
+           collector never reads a partial file
+    @return false if it could not be written
+  **/
+  bool
+  dump(const std::string& path) const;
+
+private:
+  template<typename T>
+  struct Entry
+  {
+    std::string help;
+    std::unique_ptr<T> metric;
+  };
+
+  mutable std::mutex m_mutex;
+  std::map<std::string, Entry<Counter>> m_counters;
+  std::map<std::string, Entry<Gauge>> m_gauges;
+  std::map<std::string, Entry<Histogram>> m_histograms;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_METRICS_HPP
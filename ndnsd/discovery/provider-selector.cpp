@@ -0,0 +1,158 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "provider-selector.hpp"
+
+#include <ndn-cxx/util/random.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+namespace ndnsd {
+namespace discovery {
+
+ProviderSelector::ProviderSelector(const ServiceRegistry& registry, std::string weightKey,
+                                   std::string loadKey)
+  : m_registry(registry)
+  , m_weightKey(std::move(weightKey))
+  , m_loadKey(std::move(loadKey))
+{
+}
+
+ServiceRegistry::EntryId
+ProviderSelector::select(const ndn::Name& serviceName, SelectionPolicy policy)
+{
+  const auto& providers = m_registry.getProviders(serviceName);
+  if (providers.empty()) {
+    m_nextProvider.erase(serviceName);
+    return ServiceRegistry::INVALID_ENTRY;
+  }
+  if (providers.size() == 1) {
+    return providers.front();
+  }
+
+  switch (policy) {
+  case SelectionPolicy::ROUND_ROBIN: {
+    auto inserted = m_nextProvider.emplace(serviceName, 0);
+    if (inserted.second && m_nextProvider.size() > m_pruneSize) {
+      // services that went away without being selected again
+      pruneNextProviders();
+      inserted.first = m_nextProvider.find(serviceName);
+    }
+    size_t& next = inserted.first->second;
+    next = next % providers.size();
+    return providers[next++];
+  }
+  case SelectionPolicy::WEIGHTED_RANDOM:
+    return selectWeighted(providers);
+  case SelectionPolicy::POWER_OF_TWO_CHOICES:
+    return selectLessLoaded(providers);
+  }
+  return providers.front();
+}
+
+void
+ProviderSelector::pruneNextProviders()
+{
+  for (auto it = m_nextProvider.begin(); it != m_nextProvider.end();) {
+    it = m_registry.getProviders(it->first).empty() ? m_nextProvider.erase(it) : std::next(it);
+  }
+  // amortized over as many insertions as there are positions left
+  m_pruneSize = std::max(MIN_PRUNE_SIZE, 2 * m_nextProvider.size());
+}
+
+std::optional<double>
+ProviderSelector::getNumber(ServiceRegistry::EntryId id, const std::string& key) const
+{
+  auto value = m_registry.getMetaValue(id, key);
+  if (!value || value->empty()) {
+    return std::nullopt;
+  }
+  // the view is not null-terminated
+  std::string text(*value);
+  char* end = nullptr;
+  double number = std::strtod(text.data(), &end);
+  if (end != text.data() + text.size() || !std::isfinite(number)) {
+    return std::nullopt;
+  }
+  return number;
+}
+
+std::optional<double>
+ProviderSelector::getLoad(ServiceRegistry::EntryId id) const
+{
+  auto heartbeat = m_registry.getHeartbeat(id);
+  if (heartbeat) {
+    return heartbeat->load;
+  }
+  return getNumber(id, m_loadKey);
+}
+
+ServiceRegistry::EntryId
+ProviderSelector::selectWeighted(const std::vector<ServiceRegistry::EntryId>& providers)
+{
+  std::vector<double> weights;
+  weights.reserve(providers.size());
+  double total = 0;
+  for (auto id : providers) {
+    double weight = std::max(0.0, getNumber(id, m_weightKey).value_or(1.0));
+    weights.push_back(weight);
+    total += weight;
+  }
+  if (total <= 0) {
+    std::uniform_int_distribution<size_t> pick(0, providers.size() - 1);
+    return providers[pick(ndn::random::getRandomNumberEngine())];
+  }
+
+  std::uniform_real_distribution<double> pick(0, total);
+  double point = pick(ndn::random::getRandomNumberEngine());
+  for (size_t i = 0; i < providers.size(); ++i) {
+    if (point < weights[i]) {
+      return providers[i];
+    }
+    point -= weights[i];
+  }
+  return providers.back();
+}
+
+ServiceRegistry::EntryId
+ProviderSelector::selectLessLoaded(const std::vector<ServiceRegistry::EntryId>& providers)
+{
+  auto& engine = ndn::random::getRandomNumberEngine();
+  std::uniform_int_distribution<size_t> pickFirst(0, providers.size() - 1);
+  std::uniform_int_distribution<size_t> pickSecond(0, providers.size() - 2);
+  size_t first = pickFirst(engine);
+  size_t second = pickSecond(engine);
+  // distinct from first without rejection
+  if (second >= first) {
+    ++second;
+  }
+
+  auto firstLoad = getLoad(providers[first]);
+  auto secondLoad = getLoad(providers[second]);
+  if (secondLoad && (!firstLoad || *secondLoad < *firstLoad)) {
+    return providers[second];
+  }
+  return providers[first];
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_PROVIDER_SELECTOR_HPP
+#define NDNSD_PROVIDER_SELECTOR_HPP
+
+#include "service-registry.hpp"
+
+#include <map>
+#include <string>
+
+namespace ndnsd {
+namespace discovery {
+
+enum class SelectionPolicy : uint8_t {
+  // each provider in turn
+  ROUND_ROBIN,
+  // proportionally to the provider's weight metadata, 1 if absent or not a number
+  WEIGHTED_RANDOM,
+  /**
+    the less loaded of two random providers according to their last heartbeat, or their
+    load metadata if they never sent one; a provider reporting no load loses against one
+    that does
+  **/
+  POWER_OF_TWO_CHOICES,
+};
+
+/**
+  @brief Picks one of the providers registered under a serviceName
+
+  Works on the serviceName index of the registry, so a selection costs one lookup plus,
+  for WEIGHTED_RANDOM only, a pass over the providers of that service.
+**/
+class ProviderSelector
+{
+public:
+  ProviderSelector(const ServiceRegistry& registry, std::string weightKey = "weight",
+                   std::string loadKey = "load");
+
+  /**
+    @return the selected entry, ServiceRegistry::INVALID_ENTRY if serviceName has no provider
+  **/
+  ServiceRegistry::EntryId
+  select(const ndn::Name& serviceName, SelectionPolicy policy);
+
+private:
+  // value of a numeric metadata key, nullopt if absent or not a number
+  std::optional<double>
+  getNumber(ServiceRegistry::EntryId id, const std::string& key) const;
+
+  std::optional<double>
+  getLoad(ServiceRegistry::EntryId id) const;
+
+  ServiceRegistry::EntryId
+  selectWeighted(const std::vector<ServiceRegistry::EntryId>& providers);
+
+  ServiceRegistry::EntryId
+  selectLessLoaded(const std::vector<ServiceRegistry::EntryId>& providers);
+
+  // drop the round-robin positions of services that have no provider left
+  void
+  pruneNextProviders();
+
+private:
+  // m_nextProvider size that triggers pruneNextProviders()
+  static constexpr size_t MIN_PRUNE_SIZE = 64;
+
+  const ServiceRegistry& m_registry;
+  std::string m_weightKey;
+  std::string m_loadKey;
+  // round-robin position per serviceName, erased once it has no provider left
+  std::map<ndn::Name, size_t> m_nextProvider;
+  size_t m_pruneSize = MIN_PRUNE_SIZE;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_PROVIDER_SELECTOR_HPP
@@ -0,0 +1,367 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "registry-cache.hpp"
+#include "mapped-file.hpp"
+#include "service-registry.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <optional>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+INIT_LOGGER(RegistryCache);
+
+namespace ndnsd {
+namespace discovery {
+
+static const char MAGIC[8] = {'N', 'D', 'N', 'S', 'D', 'R', 'C', '1'};
+
+static bool
+writeAll(int fd, const char* data, size_t size)
+{
+  while (size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+static bool
+hasMagic(const MappedFile& file)
+{
+  return file.size() >= sizeof(MAGIC) && std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) == 0;
+}
+
+RegistryCache::RegistryCache(const std::string& directory)
+  : m_snapshotPath(directory + "/snapshot")
+  , m_logPath(directory + "/log")
+{
+  boost::system::error_code ec;
+  boost::filesystem::create_directories(directory, ec);
+  if (ec) {
+    throw Error("Cannot create cache directory " + directory + ": " + ec.message());
+  }
+  openLog();
+}
+
+RegistryCache::~RegistryCache()
+{
+  if (m_logFd >= 0) {
+    flush();
+    ::close(m_logFd);
+  }
+}
+
+size_t
+RegistryCache::load(ServiceRegistry& registry)
+{
+  size_t nApplied = 0;
+  auto apply = [&] (Op op, const Details& details, const ndn::Name& scope,
+                    const uint8_t*, size_t) {
+    if (op == PUT) {
+      // publishTimestamp is the version, an older record does not replace the entry
+      auto id = registry.find(details.applicationPrefix, details.serviceName, scope);
+      if (id == ServiceRegistry::INVALID_ENTRY ||
+          registry.getPublishTimestamp(id) <= details.publishTimestamp) {
+        registry.insert(details, scope);
+      }
+    }
+    else {
+      registry.erase(details.applicationPrefix, details.serviceName, scope);
+    }
+    ++nApplied;
+  };
+  {
+    MappedFile snapshot(m_snapshotPath);
+    if (hasMagic(snapshot)) {
+      forEachRecord(snapshot.data() + sizeof(MAGIC), snapshot.data() + snapshot.size(), apply);
+    }
+  }
+
+  MappedFile log(m_logPath);
+  if (!hasMagic(log)) {
+    return nApplied;
+  }
+  size_t nSnapshot = nApplied;
+  size_t good = sizeof(MAGIC) + forEachRecord(log.data() + sizeof(MAGIC),
+                                              log.data() + log.size(), apply);
+  m_nLogRecords = nApplied - nSnapshot;
+  if (good != log.size()) {
+    NDNSD_LOG_WARN("Dropping " << (log.size() - good) << " bytes of torn log");
+    if (::ftruncate(m_logFd, static_cast<off_t>(good)) != 0) {
+      NDNSD_LOG_WARN("Cannot truncate " << m_logPath << ": " << std::strerror(errno));
+    }
+  }
+  NDNSD_LOG_DEBUG("Loaded " << registry.size() << " services from " << nApplied << " records");
+  return nApplied;
+}
+
+void
+RegistryCache::recordInsert(const Details& details, const ndn::Name& scope)
+{
+  append(PUT, details, scope);
+}
+
+void
+RegistryCache::recordErase(const Details& details, const ndn::Name& scope)
+{
+  Details key;
+  key.serviceName = details.serviceName;
+  key.applicationPrefix = details.applicationPrefix;
+  append(ERASE, key, scope);
+}
+
+void
+RegistryCache::flush()
+{
+  if (m_pending.empty()) {
+    return;
+  }
+  if (!writeAll(m_logFd, m_pending.data(), m_pending.size())) {
+    NDNSD_LOG_WARN("Cannot append to " << m_logPath << ": " << std::strerror(errno));
+  }
+  else {
+    m_nLogRecords += m_nPendingRecords;
+  }
+  m_pending.clear();
+  m_nPendingRecords = 0;
+}
+
+size_t
+RegistryCache::recover(const ndn::Name& serviceName, ServiceRegistry& registry,
+                       const RecordFilter& filter)
+{
+  flush();
+  // last state of each provider of serviceName, nullopt once erased
+  std::map<std::pair<ndn::Name, ndn::Name>, std::optional<Details>> providers;
+  forEachFile([&] (Op op, const Details& details, const ndn::Name& scope,
+                   const uint8_t*, size_t) {
+    if (details.serviceName != serviceName) {
+      return;
+    }
+    auto& provider = providers[{scope, details.applicationPrefix}];
+    if (op == PUT) {
+      provider = details;
+    }
+    else {
+      provider.reset();
+    }
+  });
+
+  size_t nRecovered = 0;
+  for (const auto& [key, details] : providers) {
+    const ndn::Name& scope = key.first;
+    if (!details ||
+        registry.find(details->applicationPrefix, serviceName, scope) !=
+          ServiceRegistry::INVALID_ENTRY ||
+        (filter && !filter(*details, scope))) {
+      continue;
+    }
+    registry.insert(*details, scope);
+    ++nRecovered;
+  }
+  NDNSD_LOG_DEBUG("Recovered " << nRecovered << " providers of " << serviceName);
+  return nRecovered;
+}
+
+void
+RegistryCache::compact(const ServiceRegistry& registry, const RecordFilter& keep)
+{
+  // the buffered erasures decide which cached services are kept
+  flush();
+  std::string buffer(MAGIC, sizeof(MAGIC));
+  registry.forEach([&] (ServiceRegistry::EntryId id) {
+    appendRecord(buffer, PUT, registry.get(id), registry.getScope(id));
+  });
+
+  if (keep) {
+    // last record of each service missing from the registry, by scope then key
+    std::map<std::pair<ndn::Name, ndn::Name>, std::string> missing;
+    forEachFile([&] (Op op, const Details& details, const ndn::Name& scope,
+                     const uint8_t* record, size_t size) {
+      auto key = std::make_pair(scope, ServiceRegistry::makeKey(details.applicationPrefix,
+                                                                details.serviceName));
+      if (op == PUT &&
+          registry.find(details.applicationPrefix, details.serviceName, scope) ==
+            ServiceRegistry::INVALID_ENTRY &&
+          keep(details, scope)) {
+        missing[key].assign(reinterpret_cast<const char*>(record), size);
+      }
+      else {
+        missing.erase(key);
+      }
+    });
+    for (const auto& item : missing) {
+      buffer.append(item.second);
+    }
+  }
+
+  std::string tmpPath = m_snapshotPath + ".tmp";
+  int fd = ::open(tmpPath.data(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    NDNSD_LOG_WARN("Cannot create " << tmpPath << ": " << std::strerror(errno));
+    return;
+  }
+  bool isWritten = writeAll(fd, buffer.data(), buffer.size()) && ::fsync(fd) == 0;
+  ::close(fd);
+  if (!isWritten || ::rename(tmpPath.data(), m_snapshotPath.data()) != 0) {
+    NDNSD_LOG_WARN("Cannot write snapshot " << m_snapshotPath << ": " << std::strerror(errno));
+    ::unlink(tmpPath.data());
+    return;
+  }
+
+  // replaying a log on top of the snapshot that already contains it is harmless, so a crash
+  // before the truncation below only costs time
+  if (::ftruncate(m_logFd, sizeof(MAGIC)) != 0) {
+    NDNSD_LOG_WARN("Cannot truncate " << m_logPath << ": " << std::strerror(errno));
+    return;
+  }
+  NDNSD_LOG_DEBUG("Compacted " << m_nLogRecords << " log records into a snapshot of "
+                << registry.size() << " services");
+  m_nLogRecords = 0;
+}
+
+uint32_t
+RegistryCache::checksum(const uint8_t* data, size_t size)
+{
+  // FNV-1a, enough to catch torn and garbled records
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+void
+RegistryCache::appendRecord(std::string& buffer, Op op, const Details& details,
+                            const ndn::Name& scope)
+{
+  size_t headerOffset = buffer.size();
+  buffer.append(sizeof(RecordHeader), '\0');
+
+  ndn::Block block = details.encode();
+  buffer.append(reinterpret_cast<const char*>(block.data()), block.size());
+  if (!scope.empty()) {
+    ndn::Block scopeBlock = ndn::encoding::makeStringBlock(tlv::Name, scope.toUri());
+    buffer.append(reinterpret_cast<const char*>(scopeBlock.data()), scopeBlock.size());
+  }
+
+  RecordHeader header{};
+  header.op = op;
+  header.length = static_cast<uint32_t>(buffer.size() - headerOffset - sizeof(header));
+  header.checksum = checksum(reinterpret_cast<const uint8_t*>(buffer.data()) + headerOffset +
+                             sizeof(header), header.length);
+  std::memcpy(&buffer[headerOffset], &header, sizeof(header));
+}
+
+size_t
+RegistryCache::forEachRecord(const uint8_t* begin, const uint8_t* end,
+                             const RecordVisitor& visitor)
+{
+  const uint8_t* pos = begin;
+  while (static_cast<size_t>(end - pos) >= sizeof(RecordHeader)) {
+    RecordHeader header;
+    std::memcpy(&header, pos, sizeof(header));
+    const uint8_t* payload = pos + sizeof(header);
+    if (static_cast<size_t>(end - payload) < header.length ||
+        checksum(payload, header.length) != header.checksum) {
+      break;
+    }
+
+    // ServiceInfo, then the scope if it is not the default one
+    schema::ElementReader elements(payload, payload + header.length);
+    uint32_t type = 0;
+    const uint8_t* valueBegin = nullptr;
+    const uint8_t* valueEnd = nullptr;
+    if (!elements.next(type, valueBegin, valueEnd)) {
+      break;
+    }
+    auto details = Details::tryDecode(payload, valueEnd);
+    ndn::Name scope;
+    if (elements.next(type, valueBegin, valueEnd) &&
+        (type != tlv::Name ||
+         schema::NameUriCodec::read(valueBegin, valueEnd, scope) != schema::DecodeStatus::OK)) {
+      break;
+    }
+    if (!details || elements.isMalformed() || (header.op != PUT && header.op != ERASE)) {
+      break;
+    }
+    visitor(static_cast<Op>(header.op), *details, scope, pos, sizeof(header) + header.length);
+    pos = payload + header.length;
+  }
+  return static_cast<size_t>(pos - begin);
+}
+
+void
+RegistryCache::forEachFile(const RecordVisitor& visitor) const
+{
+  for (const auto& path : {m_snapshotPath, m_logPath}) {
+    MappedFile file(path);
+    if (hasMagic(file)) {
+      forEachRecord(file.data() + sizeof(MAGIC), file.data() + file.size(), visitor);
+    }
+  }
+}
+
+void
+RegistryCache::append(Op op, const Details& details, const ndn::Name& scope)
+{
+  appendRecord(m_pending, op, details, scope);
+  ++m_nPendingRecords;
+}
+
+void
+RegistryCache::openLog()
+{
+  m_logFd = ::open(m_logPath.data(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (m_logFd < 0) {
+    throw Error("Cannot open " + m_logPath + ": " + std::strerror(errno));
+  }
+
+  char magic[sizeof(MAGIC)];
+  if (::pread(m_logFd, magic, sizeof(magic), 0) == sizeof(magic) &&
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0) {
+    return;
+  }
+  // new or unusable log, start over
+  if (::ftruncate(m_logFd, 0) != 0 || !writeAll(m_logFd, MAGIC, sizeof(MAGIC))) {
+    std::string reason = std::strerror(errno);
+    ::close(m_logFd);
+    m_logFd = -1;
+    throw Error("Cannot initialize " + m_logPath + ": " + reason);
+  }
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_REGISTRY_CACHE_HPP
+#define NDNSD_REGISTRY_CACHE_HPP
+
+#include "details.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace ndnsd {
+namespace discovery {
+
+class ServiceRegistry;
+
+/**
+  @brief On-disk copy of a ServiceRegistry for warm restarts
+
+  The cache directory holds two files of the same record format, each record being an
+  operation (PUT or ERASE), the length and checksum of the payload, and the encoded Details
+  (ServiceInfo TLV, only the names for ERASE) followed by the registry scope unless it is
+  the default one:
+
+    snapshot  compacted state, written to a temporary file and renamed into place, read
+              back through mmap
+    log       records appended since the snapshot was taken
+
+  load() replays the snapshot and then the log; publishTimestamp is the version of an
+  entry, a PUT older than the entry in the registry is skipped. A torn or corrupted record ends the replay
+  of that file; the log is truncated to its last good record so appends continue from a
+  consistent point. compact() folds the log into a new snapshot.
+
+  recordInsert() and recordErase() only buffer their records; flush() appends the buffer to
+  the log in one write, so the owner can batch the updates of a burst. Records not flushed
+  yet are lost on a crash, which only costs a refetch.
+
+  Entries evicted from a memory-bounded registry are not erased from the cache: recover()
+  brings the providers of one service back, and compact() can keep them in the snapshot.
+
+  Only the services are cached, not the SVS state vector: a restarted node still fetches
+  the publication history of its peers, the warm cache only spares the discovery message
+  and the wait for the first publications.
+**/
+class RegistryCache
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+    @throw Error if the directory cannot be created or the log cannot be opened
+  **/
+  explicit
+  RegistryCache(const std::string& directory);
+
+  // flushes the buffered records
+  ~RegistryCache();
+
+  RegistryCache(const RegistryCache&) = delete;
+  RegistryCache& operator=(const RegistryCache&) = delete;
+
+  /**
+    @brief replay the cache into registry
+    @return number of records applied
+  **/
+  size_t
+  load(ServiceRegistry& registry);
+
+  void
+  recordInsert(const Details& details, const ndn::Name& scope = ndn::Name());
+
+  void
+  recordErase(const Details& details, const ndn::Name& scope = ndn::Name());
+
+  /**
+    @brief append the records buffered since the last flush to the log
+  **/
+  void
+  flush();
+
+  using RecordFilter = std::function<bool(const Details& details, const ndn::Name& scope)>;
+
+  /**
+    @brief insert into registry the cached providers of serviceName it does not hold
+    @param filter if set, only the providers it accepts are inserted
+    @return number of inserted entries
+  **/
+  size_t
+  recover(const ndn::Name& serviceName, ServiceRegistry& registry,
+          const RecordFilter& filter = nullptr);
+
+  /**
+    @brief replace the snapshot by the current content of registry and empty the log
+    @param keep if set, the cached services that registry does not hold and that keep
+           accepts stay in the snapshot
+  **/
+  void
+  compact(const ServiceRegistry& registry, const RecordFilter& keep = nullptr);
+
+  /**
+    @brief whether the log has grown large compared to a registry of registrySize entries
+  **/
+  bool
+  shouldCompact(size_t registrySize) const
+  {
+    size_t nRecords = m_nLogRecords + m_nPendingRecords;
+    return nRecords > MIN_COMPACT_RECORDS && nRecords > 2 * registrySize;
+  }
+
+  // records in the log, buffered ones included
+  size_t
+  getLogRecordCount() const
+  {
+    return m_nLogRecords + m_nPendingRecords;
+  }
+
+private:
+  enum Op : uint8_t {
+    PUT = 1,
+    ERASE = 2,
+  };
+
+  struct RecordHeader
+  {
+    uint8_t op;
+    uint8_t reserved[3];
+    uint32_t length;
+    uint32_t checksum;
+  };
+
+  static uint32_t
+  checksum(const uint8_t* data, size_t size);
+
+  // append one record to the buffer
+  static void
+  appendRecord(std::string& buffer, Op op, const Details& details, const ndn::Name& scope);
+
+  // a decoded record and its bytes, header included
+  using RecordVisitor = std::function<void(Op op, const Details& details,
+                                           const ndn::Name& scope,
+                                           const uint8_t* record, size_t size)>;
+
+  /**
+    @brief pass the records of [begin, end) to visitor
+    @return offset just past the last good record
+  **/
+  static size_t
+  forEachRecord(const uint8_t* begin, const uint8_t* end, const RecordVisitor& visitor);
+
+  // the records of the snapshot, then of the log
+  void
+  forEachFile(const RecordVisitor& visitor) const;
+
+  void
+  append(Op op, const Details& details, const ndn::Name& scope);
+
+  void
+  openLog();
+
+private:
+  static constexpr size_t MIN_COMPACT_RECORDS = 1024;
+
+  std::string m_snapshotPath;
+  std::string m_logPath;
+  int m_logFd = -1;
+  size_t m_nLogRecords = 0;
+  // records not flushed yet
+  std::string m_pending;
+  size_t m_nPendingRecords = 0;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_REGISTRY_CACHE_HPP
@@ -0,0 +1,472 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "registry-columns.hpp"
+#include "service-registry.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NDNSD_HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace ndnsd {
+namespace discovery {
+
+namespace {
+
+// Kernels set bit i of out (which is zeroed by the caller) when row i matches.
+// Full 64-row blocks go through the vector loop, the tail through the scalar one.
+
+void
+rangeI64Scalar(const int64_t* column, size_t begin, size_t n, int64_t lower, int64_t upper,
+               uint64_t* out)
+{
+  for (size_t i = begin; i < n; ++i) {
+    out[i / 64] |= uint64_t(column[i] >= lower && column[i] <= upper) << (i % 64);
+  }
+}
+
+void
+rangeI32Scalar(const int32_t* column, size_t begin, size_t n, int32_t lower, int32_t upper,
+               uint64_t* out)
+{
+  for (size_t i = begin; i < n; ++i) {
+    out[i / 64] |= uint64_t(column[i] >= lower && column[i] <= upper) << (i % 64);
+  }
+}
+
+void
+equalU32Scalar(const uint32_t* column, size_t begin, size_t n, uint32_t value, uint64_t* out)
+{
+  for (size_t i = begin; i < n; ++i) {
+    out[i / 64] |= uint64_t(column[i] == value) << (i % 64);
+  }
+}
+
+void
+equalU8Scalar(const uint8_t* column, size_t begin, size_t n, uint8_t value, uint64_t* out)
+{
+  for (size_t i = begin; i < n; ++i) {
+    out[i / 64] |= uint64_t(column[i] == value) << (i % 64);
+  }
+}
+
+void
+rangeI64Generic(const int64_t* column, size_t n, int64_t lower, int64_t upper, uint64_t* out)
+{
+  rangeI64Scalar(column, 0, n, lower, upper, out);
+}
+
+void
+rangeI32Generic(const int32_t* column, size_t n, int32_t lower, int32_t upper, uint64_t* out)
+{
+  rangeI32Scalar(column, 0, n, lower, upper, out);
+}
+
+void
+equalU32Generic(const uint32_t* column, size_t n, uint32_t value, uint64_t* out)
+{
+  equalU32Scalar(column, 0, n, value, out);
+}
+
+void
+equalU8Generic(const uint8_t* column, size_t n, uint8_t value, uint64_t* out)
+{
+  equalU8Scalar(column, 0, n, value, out);
+}
+
+#ifdef NDNSD_HAVE_X86_KERNELS
+
+__attribute__((target("avx2"))) void
+rangeI64Avx2(const int64_t* column, size_t n, int64_t lower, int64_t upper, uint64_t* out)
+{
+  const __m256i lo = _mm256_set1_epi64x(lower);
+  const __m256i hi = _mm256_set1_epi64x(upper);
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const int64_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 4) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + j));
+      __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi64(lo, v), _mm256_cmpgt_epi64(v, hi));
+      uint64_t bits = ~_mm256_movemask_pd(_mm256_castsi256_pd(outside)) & 0xF;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  rangeI64Scalar(column, nBlocks * 64, n, lower, upper, out);
+}
+
+__attribute__((target("avx2"))) void
+rangeI32Avx2(const int32_t* column, size_t n, int32_t lower, int32_t upper, uint64_t* out)
+{
+  const __m256i lo = _mm256_set1_epi32(lower);
+  const __m256i hi = _mm256_set1_epi32(upper);
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const int32_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 8) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + j));
+      __m256i outside = _mm256_or_si256(_mm256_cmpgt_epi32(lo, v), _mm256_cmpgt_epi32(v, hi));
+      uint64_t bits = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  rangeI32Scalar(column, nBlocks * 64, n, lower, upper, out);
+}
+
+__attribute__((target("avx2"))) void
+equalU32Avx2(const uint32_t* column, size_t n, uint32_t value, uint64_t* out)
+{
+  const __m256i needle = _mm256_set1_epi32(static_cast<int32_t>(value));
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const uint32_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 8) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + j));
+      uint64_t bits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, needle))) & 0xFF;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  equalU32Scalar(column, nBlocks * 64, n, value, out);
+}
+
+__attribute__((target("avx2"))) void
+equalU8Avx2(const uint8_t* column, size_t n, uint8_t value, uint64_t* out)
+{
+  const __m256i needle = _mm256_set1_epi8(static_cast<char>(value));
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const uint8_t* block = column + b * 64;
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    uint64_t low = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v0, needle)));
+    uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v1, needle)));
+    out[b] = low | (high << 32);
+  }
+  equalU8Scalar(column, nBlocks * 64, n, value, out);
+}
+
+__attribute__((target("sse4.2"))) void
+rangeI64Sse(const int64_t* column, size_t n, int64_t lower, int64_t upper, uint64_t* out)
+{
+  const __m128i lo = _mm_set1_epi64x(lower);
+  const __m128i hi = _mm_set1_epi64x(upper);
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const int64_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 2) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + j));
+      __m128i outside = _mm_or_si128(_mm_cmpgt_epi64(lo, v), _mm_cmpgt_epi64(v, hi));
+      uint64_t bits = ~_mm_movemask_pd(_mm_castsi128_pd(outside)) & 0x3;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  rangeI64Scalar(column, nBlocks * 64, n, lower, upper, out);
+}
+
+__attribute__((target("sse4.2"))) void
+rangeI32Sse(const int32_t* column, size_t n, int32_t lower, int32_t upper, uint64_t* out)
+{
+  const __m128i lo = _mm_set1_epi32(lower);
+  const __m128i hi = _mm_set1_epi32(upper);
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const int32_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + j));
+      __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(lo, v), _mm_cmpgt_epi32(v, hi));
+      uint64_t bits = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  rangeI32Scalar(column, nBlocks * 64, n, lower, upper, out);
+}
+
+__attribute__((target("sse4.2"))) void
+equalU32Sse(const uint32_t* column, size_t n, uint32_t value, uint64_t* out)
+{
+  const __m128i needle = _mm_set1_epi32(static_cast<int32_t>(value));
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const uint32_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 4) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + j));
+      uint64_t bits = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, needle))) & 0xF;
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  equalU32Scalar(column, nBlocks * 64, n, value, out);
+}
+
+__attribute__((target("sse4.2"))) void
+equalU8Sse(const uint8_t* column, size_t n, uint8_t value, uint64_t* out)
+{
+  const __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+  size_t nBlocks = n / 64;
+  for (size_t b = 0; b < nBlocks; ++b) {
+    const uint8_t* block = column + b * 64;
+    uint64_t word = 0;
+    for (size_t j = 0; j < 64; j += 16) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + j));
+      uint64_t bits = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)));
+      word |= bits << j;
+    }
+    out[b] = word;
+  }
+  equalU8Scalar(column, nBlocks * 64, n, value, out);
+}
+
+#endif // NDNSD_HAVE_X86_KERNELS
+
+struct Kernels
+{
+  const char* name;
+  void (*rangeI64)(const int64_t*, size_t, int64_t, int64_t, uint64_t*);
+  void (*rangeI32)(const int32_t*, size_t, int32_t, int32_t, uint64_t*);
+  void (*equalU32)(const uint32_t*, size_t, uint32_t, uint64_t*);
+  void (*equalU8)(const uint8_t*, size_t, uint8_t, uint64_t*);
+};
+
+const Kernels&
+getKernels()
+{
+  static const Kernels kernels = [] {
+#ifdef NDNSD_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      return Kernels{"avx2", &rangeI64Avx2, &rangeI32Avx2, &equalU32Avx2, &equalU8Avx2};
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+      return Kernels{"sse", &rangeI64Sse, &rangeI32Sse, &equalU32Sse, &equalU8Sse};
+    }
+#endif
+    return Kernels{"scalar", &rangeI64Generic, &rangeI32Generic, &equalU32Generic, &equalU8Generic};
+  }();
+  return kernels;
+}
+
+} // namespace
+
+RowBitmap&
+RowBitmap::operator&=(const RowBitmap& other)
+{
+  for (size_t i = 0; i < m_words.size() && i < other.m_words.size(); ++i) {
+    m_words[i] &= other.m_words[i];
+  }
+  return *this;
+}
+
+RowBitmap&
+RowBitmap::operator|=(const RowBitmap& other)
+{
+  for (size_t i = 0; i < m_words.size() && i < other.m_words.size(); ++i) {
+    m_words[i] |= other.m_words[i];
+  }
+  return *this;
+}
+
+size_t
+RowBitmap::count() const
+{
+  size_t n = 0;
+  for (uint64_t word : m_words) {
+    n += __builtin_popcountll(word);
+  }
+  return n;
+}
+
+std::vector<uint32_t>
+RowBitmap::toRows() const
+{
+  std::vector<uint32_t> rows;
+  for (size_t i = 0; i < m_words.size(); ++i) {
+    for (uint64_t word = m_words[i]; word != 0; word &= word - 1) {
+      rows.push_back(static_cast<uint32_t>(i * 64 + __builtin_ctzll(word)));
+    }
+  }
+  return rows;
+}
+
+RegistryColumns::RegistryColumns(std::vector<std::string> metaKeys)
+{
+  for (auto& key : metaKeys) {
+    // code 0 is never handed out
+    m_meta.push_back(MetaColumn{std::move(key), {}, {}, {0}, {nullptr}, {}});
+  }
+}
+
+void
+RegistryColumns::update(EntryId id, const ServiceRegistry& registry)
+{
+  ensureRow(id);
+  m_serviceLifetime[id] = registry.getServiceLifetime(id);
+  m_publishTimestamp[id] = registry.getPublishTimestamp(id);
+  m_status[id] = ACTIVE;
+  for (auto& column : m_meta) {
+    auto value = registry.getMetaValue(id, column.key);
+    // acquired first, an unchanged value must not leave the dictionary in between
+    uint32_t code = value ? acquireCode(column, *value) : 0;
+    releaseCode(column, column.codes[id]);
+    column.codes[id] = code;
+  }
+}
+
+void
+RegistryColumns::clear(EntryId id)
+{
+  ensureRow(id);
+  m_serviceLifetime[id] = 0;
+  m_publishTimestamp[id] = 0;
+  m_status[id] = EXPIRED;
+  for (auto& column : m_meta) {
+    releaseCode(column, column.codes[id]);
+    column.codes[id] = 0;
+  }
+}
+
+RowBitmap
+RegistryColumns::selectActive() const
+{
+  RowBitmap rows(getRowCount());
+  getKernels().equalU8(m_status.data(), m_status.size(), ACTIVE, rows.data());
+  return rows;
+}
+
+RowBitmap
+RegistryColumns::selectPublishTimestamp(int64_t lower, int64_t upper) const
+{
+  RowBitmap rows(getRowCount());
+  getKernels().rangeI64(m_publishTimestamp.data(), m_publishTimestamp.size(), lower, upper,
+                        rows.data());
+  return rows;
+}
+
+RowBitmap
+RegistryColumns::selectServiceLifetime(int32_t lower, int32_t upper) const
+{
+  RowBitmap rows(getRowCount());
+  getKernels().rangeI32(m_serviceLifetime.data(), m_serviceLifetime.size(), lower, upper,
+                        rows.data());
+  return rows;
+}
+
+RowBitmap
+RegistryColumns::selectMetaEquals(std::string_view key, std::string_view value) const
+{
+  RowBitmap rows(getRowCount());
+  for (const auto& column : m_meta) {
+    if (column.key != key) {
+      continue;
+    }
+    auto code = column.dictionary.find(std::string(value));
+    if (code != column.dictionary.end()) {
+      getKernels().equalU32(column.codes.data(), column.codes.size(), code->second, rows.data());
+    }
+    break;
+  }
+  return rows;
+}
+
+const char*
+RegistryColumns::getKernelName()
+{
+  return getKernels().name;
+}
+
+size_t
+RegistryColumns::getMemoryUsage() const
+{
+  size_t bytes = m_serviceLifetime.capacity() * sizeof(int32_t) +
+                 m_publishTimestamp.capacity() * sizeof(int64_t) +
+                 m_status.capacity() * sizeof(uint8_t);
+  for (const auto& column : m_meta) {
+    bytes += column.codes.capacity() * sizeof(uint32_t) +
+             column.dictionary.bucket_count() * sizeof(void*) +
+             column.nRows.capacity() * sizeof(uint32_t) +
+             column.values.capacity() * sizeof(const std::string*) +
+             column.freeCodes.capacity() * sizeof(uint32_t);
+    for (const auto& [value, code] : column.dictionary) {
+      bytes += sizeof(std::pair<const std::string, uint32_t>) + 2 * sizeof(void*) + value.capacity();
+    }
+  }
+  return bytes;
+}
+
+void
+RegistryColumns::ensureRow(EntryId id)
+{
+  if (id < m_status.size()) {
+    return;
+  }
+  size_t nRows = id + 1;
+  m_serviceLifetime.resize(nRows, 0);
+  m_publishTimestamp.resize(nRows, 0);
+  m_status.resize(nRows, EXPIRED);
+  for (auto& column : m_meta) {
+    column.codes.resize(nRows, 0);
+  }
+}
+
+uint32_t
+RegistryColumns::acquireCode(MetaColumn& column, std::string_view value)
+{
+  auto it = column.dictionary.find(std::string(value));
+  if (it == column.dictionary.end()) {
+    uint32_t code;
+    if (column.freeCodes.empty()) {
+      code = static_cast<uint32_t>(column.nRows.size());
+      column.nRows.push_back(0);
+      column.values.push_back(nullptr);
+    }
+    else {
+      code = column.freeCodes.back();
+      column.freeCodes.pop_back();
+    }
+    it = column.dictionary.emplace(std::string(value), code).first;
+    // keys of an unordered_map keep their address across rehashes
+    column.values[code] = &it->first;
+  }
+  ++column.nRows[it->second];
+  return it->second;
+}
+
+void
+RegistryColumns::releaseCode(MetaColumn& column, uint32_t code)
+{
+  if (code == 0 || --column.nRows[code] > 0) {
+    return;
+  }
+  column.dictionary.erase(column.dictionary.find(*column.values[code]));
+  column.values[code] = nullptr;
+  column.freeCodes.push_back(code);
+}
+
+} // namespace discovery
+} // namespace ndnsd
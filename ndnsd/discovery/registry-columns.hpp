@@ -0,0 +1,186 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_REGISTRY_COLUMNS_HPP
+#define NDNSD_REGISTRY_COLUMNS_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+class ServiceRegistry;
+
+/**
+  @brief One bit per registry row
+**/
+class RowBitmap
+{
+public:
+  RowBitmap() = default;
+
+  explicit
+  RowBitmap(size_t nRows)
+    : m_words((nRows + 63) / 64)
+    , m_nRows(nRows)
+  {
+  }
+
+  size_t
+  size() const
+  {
+    return m_nRows;
+  }
+
+  uint64_t*
+  data()
+  {
+    return m_words.data();
+  }
+
+  const uint64_t*
+  data() const
+  {
+    return m_words.data();
+  }
+
+  bool
+  test(size_t row) const
+  {
+    return (m_words[row / 64] >> (row % 64)) & 1;
+  }
+
+  RowBitmap&
+  operator&=(const RowBitmap& other);
+
+  RowBitmap&
+  operator|=(const RowBitmap& other);
+
+  size_t
+  count() const;
+
+  std::vector<uint32_t>
+  toRows() const;
+
+private:
+  std::vector<uint64_t> m_words;
+  size_t m_nRows = 0;
+};
+
+/**
+  @brief Struct-of-arrays mirror of a ServiceRegistry for ad-hoc predicate scans
+
+  Row i describes registry entry i. Fixed-width columns hold serviceLifetime,
+  publishTimestamp and status (ACTIVE for live rows, EXPIRED for free slots); selected
+  serviceMetaInfo keys are dictionary encoded into uint32 codes, 0 meaning absent.
+
+  select*() scans a column and returns the matching rows as a bitmap, using AVX2 or SSE
+  kernels picked at run time on x86-64 and a scalar loop elsewhere. Bitmaps are combined
+  with & and |; AND the result with selectActive() to drop free slots.
+**/
+class RegistryColumns
+{
+public:
+  using EntryId = uint32_t;
+
+  enum Status : uint8_t {
+    EXPIRED = 0,
+    ACTIVE = 1,
+  };
+
+  explicit
+  RegistryColumns(std::vector<std::string> metaKeys);
+
+  void
+  update(EntryId id, const ServiceRegistry& registry);
+
+  void
+  clear(EntryId id);
+
+  size_t
+  getRowCount() const
+  {
+    return m_status.size();
+  }
+
+  RowBitmap
+  selectActive() const;
+
+  // rows with lower <= publishTimestamp <= upper
+  RowBitmap
+  selectPublishTimestamp(int64_t lower, int64_t upper) const;
+
+  // rows with lower <= serviceLifetime <= upper
+  RowBitmap
+  selectServiceLifetime(int32_t lower, int32_t upper) const;
+
+  // rows whose serviceMetaInfo[key] == value; key must be one of the mirrored keys
+  RowBitmap
+  selectMetaEquals(std::string_view key, std::string_view value) const;
+
+  /**
+    @brief name of the kernel set in use, "avx2", "sse" or "scalar"
+  **/
+  static const char*
+  getKernelName();
+
+  size_t
+  getMemoryUsage() const;
+
+private:
+  struct MetaColumn
+  {
+    std::string key;
+    std::vector<uint32_t> codes;
+    // value -> code, codes start at 1
+    std::unordered_map<std::string, uint32_t> dictionary;
+    // by code, number of rows holding it; a value leaves the dictionary with its last row
+    std::vector<uint32_t> nRows;
+    // by code, its key in dictionary, nullptr for a free code
+    std::vector<const std::string*> values;
+    // codes freed by their last row, reused before new ones
+    std::vector<uint32_t> freeCodes;
+  };
+
+  void
+  ensureRow(EntryId id);
+
+  // code of value with one more row holding it
+  static uint32_t
+  acquireCode(MetaColumn& column, std::string_view value);
+
+  // one row less holds code, 0 being absent
+  static void
+  releaseCode(MetaColumn& column, uint32_t code);
+
+private:
+  std::vector<int32_t> m_serviceLifetime;
+  std::vector<int64_t> m_publishTimestamp;
+  std::vector<uint8_t> m_status;
+  std::vector<MetaColumn> m_meta;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_REGISTRY_COLUMNS_HPP
@@ -0,0 +1,400 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "service-discovery-pool.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+INIT_LOGGER(ServiceDiscoveryPool);
+
+namespace ndnsd {
+namespace discovery {
+
+// a move must shrink the load gap between two shards to this fraction or less
+static constexpr double MIN_REBALANCE_GAIN = 0.8;
+// updates per second below which shards are considered balanced
+static constexpr double MIN_REBALANCE_GAP = 1.0;
+
+ServiceDiscoveryPool::ServiceDiscoveryPool(size_t nShards, const ServiceDiscoveryOptions& options,
+                                           FaceFactory faceFactory)
+  : m_options(options)
+  , m_lastRebalance(ndn::time::steady_clock::now())
+{
+  // the groups of all shards count in the same registry, each shard in its own slots
+  if (!m_options.metrics) {
+    m_options.metrics = std::make_shared<Metrics>();
+  }
+  if (nShards == 0) {
+    nShards = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (!faceFactory) {
+    faceFactory = [] (boost::asio::io_service& io, ndn::KeyChain&) {
+      return std::make_unique<ndn::Face>(io);
+    };
+  }
+
+  for (size_t i = 0; i < nShards; ++i) {
+    auto shard = std::make_unique<Shard>();
+    shard->work = std::make_unique<boost::asio::io_service::work>(shard->io);
+    shard->keyChain = std::make_unique<ndn::KeyChain>();
+    shard->face = faceFactory(shard->io, *shard->keyChain);
+    Shard* raw = shard.get();
+    shard->thread = std::thread([raw] { raw->io.run(); });
+    m_shards.push_back(std::move(shard));
+  }
+  NDNSD_LOG_DEBUG("Started " << nShards << " shards");
+}
+
+ServiceDiscoveryPool::~ServiceDiscoveryPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [name, group] : m_groups) {
+      stop(group);
+    }
+    m_groups.clear();
+  }
+
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    Shard& shard = *m_shards[i];
+    // the face goes away on its own thread, before its io_service stops
+    runOnShard(i, [&shard] { shard.face.reset(); });
+    shard.work.reset();
+    shard.io.stop();
+    shard.thread.join();
+  }
+}
+
+size_t
+ServiceDiscoveryPool::addGroup(const ndn::Name& group, const ndn::Name& nodeName)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_groups.find(group);
+  if (it != m_groups.end()) {
+    return it->second.shard;
+  }
+
+  // least loaded shard, fewest groups among equally loaded ones
+  std::vector<double> loads = getShardLoads();
+  std::vector<size_t> nGroups(m_shards.size(), 0);
+  for (const auto& [name, other] : m_groups) {
+    ++nGroups[other.shard];
+  }
+  size_t shard = 0;
+  for (size_t i = 1; i < m_shards.size(); ++i) {
+    if (std::make_pair(loads[i], nGroups[i]) < std::make_pair(loads[shard], nGroups[shard])) {
+      shard = i;
+    }
+  }
+
+  Group added;
+  added.nodeName = nodeName;
+  added.shard = shard;
+  start(group, added);
+  m_groups.emplace(group, std::move(added));
+  NDNSD_LOG_INFO("Group " << group << " on shard " << shard);
+  return shard;
+}
+
+void
+ServiceDiscoveryPool::removeGroup(const ndn::Name& group)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_groups.find(group);
+  if (it == m_groups.end()) {
+    return;
+  }
+  stop(it->second);
+  m_groups.erase(it);
+}
+
+void
+ServiceDiscoveryPool::publishServiceDetail(const ndn::Name& group, const Details& details)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_groups.find(group);
+  if (it == m_groups.end()) {
+    throw Error("Not a member of group " + group.toUri());
+  }
+  it->second.published[details.serviceName.toUri()] = details;
+  ServiceDiscovery& discovery = *it->second.discovery;
+  runOnShard(it->second.shard, [&] { discovery.publishServiceDetail(details); });
+}
+
+void
+ServiceDiscoveryPool::withdrawServiceDetail(const ndn::Name& group, const ndn::Name& serviceName)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_groups.find(group);
+  if (it == m_groups.end()) {
+    throw Error("Not a member of group " + group.toUri());
+  }
+  it->second.published.erase(serviceName.toUri());
+  ServiceDiscovery& discovery = *it->second.discovery;
+  runOnShard(it->second.shard, [&] { discovery.withdrawServiceDetail(serviceName); });
+}
+
+uint64_t
+ServiceDiscoveryPool::watch(const WatchCallback& callback)
+{
+  std::lock_guard<std::mutex> lock(m_watchMutex);
+  m_watchers.emplace(++m_nextWatchId, callback);
+  return m_nextWatchId;
+}
+
+void
+ServiceDiscoveryPool::unwatch(uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(m_watchMutex);
+  m_watchers.erase(id);
+}
+
+std::vector<std::pair<ndn::Name, Details>>
+ServiceDiscoveryPool::findServices(const Query& query) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  using Result = std::vector<std::pair<ndn::Name, Details>>;
+  auto perShard = runOnShards([&] (size_t shard) {
+    Result result;
+    for (const auto& [name, group] : m_groups) {
+      if (group.shard == shard) {
+        for (auto& details : group.discovery->findServices(query)) {
+          result.emplace_back(name, std::move(details));
+        }
+      }
+    }
+    return result;
+  });
+
+  Result services;
+  for (auto& result : perShard) {
+    std::move(result.begin(), result.end(), std::back_inserter(services));
+  }
+  return services;
+}
+
+std::map<ndn::Name, std::map<std::string, Details>>
+ServiceDiscoveryPool::getReceivedServiceDetails() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  using Result = std::map<ndn::Name, std::map<std::string, Details>>;
+  auto perShard = runOnShards([&] (size_t shard) {
+    Result result;
+    for (const auto& [name, group] : m_groups) {
+      if (group.shard == shard) {
+        result.emplace(name, group.discovery->getReceivedServiceDetails());
+      }
+    }
+    return result;
+  });
+
+  Result services;
+  for (auto& result : perShard) {
+    services.merge(result);
+  }
+  return services;
+}
+
+bool
+ServiceDiscoveryPool::rebalance()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto now = ndn::time::steady_clock::now();
+  double elapsed = ndn::time::duration_cast<ndn::time::milliseconds>(now - m_lastRebalance).count()
+                   / 1000.0;
+  m_lastRebalance = now;
+  if (elapsed > 0) {
+    for (auto& [name, group] : m_groups) {
+      uint64_t nUpdates = group.nUpdates->load(std::memory_order_relaxed);
+      double rate = (nUpdates - group.lastUpdates) / elapsed;
+      group.lastUpdates = nUpdates;
+      group.updateRate = (group.updateRate + rate) / 2;
+    }
+  }
+
+  if (m_shards.size() < 2) {
+    return false;
+  }
+  std::vector<double> loads = getShardLoads();
+  auto [minIt, maxIt] = std::minmax_element(loads.begin(), loads.end());
+  size_t idlest = static_cast<size_t>(minIt - loads.begin());
+  size_t busiest = static_cast<size_t>(maxIt - loads.begin());
+  double gap = *maxIt - *minIt;
+  if (gap < MIN_REBALANCE_GAP) {
+    return false;
+  }
+
+  // moving a group of rate r leaves a gap of |gap - 2r| between the two shards
+  Group* candidate = nullptr;
+  const ndn::Name* candidateName = nullptr;
+  double bestGap = gap * MIN_REBALANCE_GAIN;
+  for (auto& [name, group] : m_groups) {
+    if (group.shard != busiest) {
+      continue;
+    }
+    double newGap = std::abs(gap - 2 * group.updateRate);
+    if (newGap < bestGap) {
+      bestGap = newGap;
+      candidate = &group;
+      candidateName = &name;
+    }
+  }
+  if (candidate == nullptr) {
+    return false;
+  }
+
+  NDNSD_LOG_INFO("Moving group " << *candidateName << " (" << candidate->updateRate
+               << " updates/s) from shard " << busiest << " to " << idlest);
+  stop(*candidate);
+  candidate->shard = idlest;
+  try {
+    start(*candidateName, *candidate);
+  }
+  catch (const std::exception& e) {
+    NDNSD_LOG_WARN("Cannot move group " << *candidateName << ": " << e.what());
+    candidate->shard = busiest;
+    try {
+      start(*candidateName, *candidate);
+    }
+    catch (const std::exception&) {
+      // never leave a group without its discovery instance
+      m_groups.erase(m_groups.find(*candidateName));
+      throw;
+    }
+    return false;
+  }
+  return true;
+}
+
+std::vector<ServiceDiscoveryPool::GroupStats>
+ServiceDiscoveryPool::getGroupStats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<GroupStats> stats;
+  for (const auto& [name, group] : m_groups) {
+    stats.push_back({name, group.shard, group.updateRate});
+  }
+  return stats;
+}
+
+template<typename Fn>
+auto
+ServiceDiscoveryPool::runOnShard(size_t shard, Fn&& fn) const -> decltype(fn())
+{
+  Shard& target = *m_shards[shard];
+  if (std::this_thread::get_id() == target.thread.get_id()) {
+    return fn();
+  }
+  std::packaged_task<decltype(fn())()> task(std::forward<Fn>(fn));
+  auto result = task.get_future();
+  target.io.post([&task] { task(); });
+  return result.get();
+}
+
+template<typename Fn>
+auto
+ServiceDiscoveryPool::runOnShards(Fn&& fn) const -> std::vector<decltype(fn(size_t()))>
+{
+  using Result = decltype(fn(size_t()));
+  std::vector<std::packaged_task<Result()>> tasks;
+  std::vector<std::future<Result>> futures;
+  tasks.reserve(m_shards.size());
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    tasks.emplace_back([&fn, i] { return fn(i); });
+    futures.push_back(tasks.back().get_future());
+  }
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    auto* task = &tasks[i];
+    m_shards[i]->io.post([task] { (*task)(); });
+  }
+
+  std::vector<Result> results;
+  for (auto& future : futures) {
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+std::vector<double>
+ServiceDiscoveryPool::getShardLoads() const
+{
+  std::vector<double> loads(m_shards.size(), 0);
+  for (const auto& [name, group] : m_groups) {
+    loads[group.shard] += group.updateRate;
+  }
+  return loads;
+}
+
+void
+ServiceDiscoveryPool::start(const ndn::Name& name, Group& group)
+{
+  Shard& shard = *m_shards[group.shard];
+  auto nUpdates = group.nUpdates;
+
+  ServiceDiscoveryOptions options = m_options;
+  if (!options.cacheDirectory.empty()) {
+    // one cache per group; URI escaping never produces '+'
+    std::string dirName = name.toUri();
+    std::replace(dirName.begin(), dirName.end(), '/', '+');
+    options.cacheDirectory += "/" + dirName;
+  }
+
+  // group.discovery is set only once the instance is fully up
+  runOnShard(group.shard, [&] {
+    auto discovery = std::make_unique<ServiceDiscovery>(
+      name, group.nodeName, *shard.face, *shard.keyChain,
+      [this, name, nUpdates] (const Details& details) {
+        nUpdates->fetch_add(1, std::memory_order_relaxed);
+        notify(name, details);
+      },
+      options);
+    for (const auto& [serviceName, details] : group.published) {
+      discovery->publishServiceDetail(details);
+    }
+    group.discovery = std::move(discovery);
+  });
+}
+
+void
+ServiceDiscoveryPool::stop(Group& group)
+{
+  runOnShard(group.shard, [&] { group.discovery.reset(); });
+}
+
+void
+ServiceDiscoveryPool::notify(const ndn::Name& group, const Details& details)
+{
+  std::vector<WatchCallback> watchers;
+  {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    for (const auto& [id, callback] : m_watchers) {
+      watchers.push_back(callback);
+    }
+  }
+  for (const auto& callback : watchers) {
+    callback(group, details);
+  }
+}
+
+} // namespace discovery
+} // namespace ndnsd
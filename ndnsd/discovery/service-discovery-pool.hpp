@@ -0,0 +1,212 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SERVICE_DISCOVERY_POOL_HPP
+#define NDNSD_SERVICE_DISCOVERY_POOL_HPP
+
+#include "service-discovery.hpp"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Service groups sharded over worker threads
+
+  Each shard is a thread running its own io_service, Face and KeyChain; every group joined
+  through the pool is a ServiceDiscovery living on one shard, so sync processing, decoding
+  and callbacks of different groups run on different cores.
+
+  New groups go to the shard with the lowest load, the load of a shard being the update
+  rate of its groups. rebalance() refreshes the rates and moves one group off the busiest
+  shard when that evens the load out; the group is rejoined on its new shard and its
+  published services are published again. With ServiceDiscoveryOptions::cacheDirectory set,
+  each group gets a cache subdirectory and a moved group restarts warm.
+
+  Watch callbacks run on the shard thread of the group, possibly concurrently for groups of
+  different shards. All other methods are called from outside the shards.
+**/
+class ServiceDiscoveryPool
+{
+public:
+  using FaceFactory = std::function<std::unique_ptr<ndn::Face>(boost::asio::io_service& io,
+                                                               ndn::KeyChain& keyChain)>;
+  using WatchCallback = std::function<void(const ndn::Name& group, const Details& details)>;
+
+  struct GroupStats
+  {
+    ndn::Name group;
+    size_t shard;
+    // received updates per second, smoothed over rebalance() calls
+    double updateRate;
+  };
+
+  /**
+    @param nShards worker threads, 0 for one per core
+    @param faceFactory creates the Face of each shard, by default an ndn::Face on its
+                       io_service
+  **/
+  explicit
+  ServiceDiscoveryPool(size_t nShards = 0, const ServiceDiscoveryOptions& options = {},
+                       FaceFactory faceFactory = nullptr);
+
+  ~ServiceDiscoveryPool();
+
+  ServiceDiscoveryPool(const ServiceDiscoveryPool&) = delete;
+  ServiceDiscoveryPool& operator=(const ServiceDiscoveryPool&) = delete;
+
+  /**
+    @brief join a service group, no-op if already joined
+    @return shard of the group
+    @throw whatever ServiceDiscovery throws; the group is then not joined
+  **/
+  size_t
+  addGroup(const ndn::Name& group, const ndn::Name& nodeName);
+
+  void
+  removeGroup(const ndn::Name& group);
+
+  /**
+    @throw Error if the group was not added
+  **/
+  void
+  publishServiceDetail(const ndn::Name& group, const Details& details);
+
+  /**
+    @throw Error if the group was not added
+  **/
+  void
+  withdrawServiceDetail(const ndn::Name& group, const ndn::Name& serviceName);
+
+  /**
+    @return id for unwatch()
+  **/
+  uint64_t
+  watch(const WatchCallback& callback);
+
+  void
+  unwatch(uint64_t id);
+
+  /**
+    @brief services matching query in all groups
+  **/
+  std::vector<std::pair<ndn::Name, Details>>
+  findServices(const Query& query) const;
+
+  /**
+    @brief received services of every group, keyed by group
+  **/
+  std::map<ndn::Name, std::map<std::string, Details>>
+  getReceivedServiceDetails() const;
+
+  /**
+    @brief refresh group update rates and move at most one group to even out the load
+    @return whether a group was moved; a group that cannot start on its new shard stays
+            on its old one, and is dropped (rethrowing) if it cannot restart there either
+  **/
+  bool
+  rebalance();
+
+  std::vector<GroupStats>
+  getGroupStats() const;
+
+  /**
+    @brief metrics of all groups, see ServiceDiscoveryOptions::metrics
+  **/
+  Metrics&
+  getMetrics()
+  {
+    return *m_options.metrics;
+  }
+
+  size_t
+  getShardCount() const
+  {
+    return m_shards.size();
+  }
+
+private:
+  struct Shard
+  {
+    boost::asio::io_service io;
+    std::unique_ptr<boost::asio::io_service::work> work;
+    std::unique_ptr<ndn::KeyChain> keyChain;
+    std::unique_ptr<ndn::Face> face;
+    std::thread thread;
+  };
+
+  struct Group
+  {
+    ndn::Name nodeName;
+    size_t shard = 0;
+    // owned by the shard thread
+    std::unique_ptr<ServiceDiscovery> discovery;
+    // services published through the pool, replayed when the group moves
+    std::map<std::string, Details> published;
+    std::shared_ptr<std::atomic<uint64_t>> nUpdates = std::make_shared<std::atomic<uint64_t>>(0);
+    uint64_t lastUpdates = 0;
+    double updateRate = 0;
+  };
+
+  // run fn on the shard thread and wait for it
+  template<typename Fn>
+  auto
+  runOnShard(size_t shard, Fn&& fn) const -> decltype(fn());
+
+  // run fn(shard) on every shard in parallel and wait for all of them
+  template<typename Fn>
+  auto
+  runOnShards(Fn&& fn) const -> std::vector<decltype(fn(size_t()))>;
+
+  std::vector<double>
+  getShardLoads() const;
+
+  void
+  start(const ndn::Name& name, Group& group);
+
+  void
+  stop(Group& group);
+
+  void
+  notify(const ndn::Name& group, const Details& details);
+
+private:
+  ServiceDiscoveryOptions m_options;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+
+  mutable std::mutex m_mutex;
+  std::map<ndn::Name, Group> m_groups;
+  ndn::time::steady_clock::time_point m_lastRebalance;
+
+  std::mutex m_watchMutex;
+  std::map<uint64_t, WatchCallback> m_watchers;
+  uint64_t m_nextWatchId = 0;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SERVICE_DISCOVERY_POOL_HPP
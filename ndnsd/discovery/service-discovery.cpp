@@ -20,27 +20,166 @@
 #include "service-discovery.hpp"
 #include <string>
 #include <iostream>
-#include <ndn-cxx/util/logger.hpp>
+#include "ndnsd/logger.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <boost/asio/post.hpp>
 
 using namespace ndn::time_literals;
 
-NDN_LOG_INIT(ndnsd.ServiceDiscovery);
+INIT_LOGGER(ServiceDiscovery);
 
 namespace ndnsd {
 namespace discovery {
 
 using namespace ndn::svs;
 
+// a complete summary after this many changes heals the tables that missed one
+static const size_t COMPLETE_SUMMARY_PERIOD = 32;
+// content of a lookup reply, providers that do not fit are left out
+static const size_t MAX_LOOKUP_REPLY_SIZE = ndn::MAX_NDN_PACKET_SIZE / 2;
+// between two decisions of the churn controller
+static const ndn::time::seconds TUNING_PERIOD(1);
+// last component but one of the discovery messages of resyncs
+static const char RESYNC_COMPONENT[] = "resync";
+// withdrawals of services whose lease never ends are kept this long
+static const time_t WITHDRAWAL_LIFETIME = 3600;
+// registry cache records of a burst of updates are written together after this delay
+static const ndn::time::milliseconds CACHE_FLUSH_DELAY(100);
+
+// follows the ndn::time custom clocks, so that leases also run on simulated time
+static time_t
+getCurrentTime()
+{
+  return ndn::time::system_clock::to_time_t(ndn::time::system_clock::now());
+}
+
+// the lease of details has not ended, or never ends
+static bool
+hasActiveLease(const Details& details)
+{
+  time_t leaseEnd = details.getLeaseEnd();
+  return leaseEnd == 0 || leaseEnd > getCurrentTime();
+}
+
+static uint64_t
+getCurrentTimeMs()
+{
+  auto now = ndn::time::system_clock::now().time_since_epoch();
+  return ndn::time::duration_cast<ndn::time::milliseconds>(now).count();
+}
+
+ServiceDiscovery::Instruments::Instruments(Metrics& metrics)
+  : nPublished(metrics.getCounter("ndnsd_publishes_total",
+                                  "Service details published by this node"))
+  , nUpdates(metrics.getCounter("ndnsd_updates_received_total",
+                                "Service details received, duplicates included"))
+  , nDecodeFailures(metrics.getCounter("ndnsd_decode_failures_total",
+                                       "Received publications that did not decode"))
+  , nSuppressedResponses(metrics.getCounter("ndnsd_discovery_responses_suppressed_total",
+                                            "Discovery messages within the republish window "
+                                            "of the last answered"))
+  , nBytesIn(metrics.getCounter("ndnsd_received_bytes_total",
+                                "Payload bytes of the received publications"))
+  , nBytesOut(metrics.getCounter("ndnsd_sent_bytes_total",
+                                 "Payload bytes of the publications of this node"))
+  , nEvictions(metrics.getCounter("ndnsd_registry_evictions_total",
+                                  "Services evicted from the registry over its memory budget"))
+  , nRecoveries(metrics.getCounter("ndnsd_registry_recoveries_total",
+                                   "Evicted services brought back from the registry cache"))
+  , nSummaries(metrics.getCounter("ndnsd_summaries_published_total",
+                                  "Service summaries published to the parent group"))
+  , nLookups(metrics.getCounter("ndnsd_lookups_total",
+                                "Lookups sent to the aggregators of summarized services"))
+  , nLookupsServed(metrics.getCounter("ndnsd_lookups_served_total",
+                                      "Lookups answered as an aggregator"))
+  , nTuningChanges(metrics.getCounter("ndnsd_tuning_changes_total",
+                                      "Interval changes decided by the churn controller"))
+  , nResyncs(metrics.getCounter("ndnsd_resyncs_total",
+                                "Discovery messages published again after late fetches"))
+  , registryBytes(metrics.getGauge("ndnsd_registry_bytes",
+                                   "Bytes accounted to the services in the registry"))
+  , republishWindow(metrics.getGauge("ndnsd_republish_window_milliseconds",
+                                     "Window within which discovery messages are answered once"))
+  , summaryInterval(metrics.getGauge("ndnsd_summary_interval_milliseconds",
+                                     "Delay over which changes are batched into a summary"))
+  , syncInterval(metrics.getGauge("ndnsd_sync_interval_milliseconds",
+                                  "Least time between two resyncs of a group, 0 without resyncs"))
+  , syncTime(metrics.getHistogram("ndnsd_sync_seconds",
+                                  "Time from publication to the sync notification"))
+  , fetchTime(metrics.getHistogram("ndnsd_fetch_seconds",
+                                   "Time from the sync notification to the fetched data"))
+  , decodeTime(metrics.getHistogram("ndnsd_decode_seconds",
+                                    "Time to decode received service details"))
+  , callbackTime(metrics.getHistogram("ndnsd_callback_seconds",
+                                      "Time spent in discovery and resolve callbacks per update"))
+  , updateLatency(metrics.getHistogram("ndnsd_update_latency_seconds",
+                                       "Time from publishTimestampMs to reception"))
+{
+}
+
 ServiceDiscovery::ServiceDiscovery(const ndn::Name& servicegroupName, const ndn::Name& nodeName, 
                     ndn::Face& face,
                     ndn::KeyChain& keyChain,
-                    const DiscoveryCallback& discoveryCallback) 
+                    const DiscoveryCallback& discoveryCallback,
+                    const ServiceDiscoveryOptions& options)
   : m_servicegroupName(servicegroupName)
   , m_face(face)
   , m_keyChain(keyChain)
+  , m_scheduler(m_face.getIoService())
   , m_nodeName(nodeName)
+  , m_journal(options.journalCapacity)
+  , m_selector(m_registry, options.weightKey, options.loadKey)
   , m_discoveryCallback(discoveryCallback)
+  , m_metrics(options.metrics ? options.metrics : std::make_shared<Metrics>())
+  , m_instruments(*m_metrics)
+  , m_traceHops(options.traceHops)
+  , m_subscriptionFilter(options.subscriptionFilter)
+  , m_summaryInterval(0)
+  , m_republishWindow(0)
+  , m_syncInterval(0)
+{
+    if (options.adaptiveTuning) {
+      m_churnController = std::make_unique<ChurnController>(options.tuningBounds);
+      setIntervals(m_churnController->getRepublishWindow(),
+                   m_churnController->getBatchInterval(), m_churnController->getSyncInterval());
+      m_tuningEvent = m_scheduler.schedule(TUNING_PERIOD, [this] { tune(); });
+    }
+    else {
+      setIntervals(options.republishWindow, options.summaryInterval, 0_ms);
+    }
+    m_registry.setMemoryBudget(options.memoryBudget, options.evictionPolicy, options.priorityKey);
+    size_t nRestored = restoreServices(options.cacheDirectory);
+
+    Group& group = addGroup(servicegroupName, nodeName, ndn::Name(), m_discoveryCallback);
+    if (nRestored == 0) {
+      publishDiscovery(group);
+    }
+    else {
+      NDNSD_LOG_DEBUG("Restored " << nRestored << " services from cache, skip discovery");
+    }
+
+    expireServices();
+}
+ServiceDiscovery::~ServiceDiscovery()
+{
+  stop();
+  // the metrics may be shared with instances that go on
+  m_instruments.registryBytes.add(-static_cast<int64_t>(m_reportedBytes));
+  setIntervals(0_ms, 0_ms, 0_ms);
+}
+
+ServiceDiscovery::Group&
+ServiceDiscovery::addGroup(const ndn::Name& servicegroupName, const ndn::Name& nodeName,
+                           const ndn::Name& scope, const DiscoveryCallback& discoveryCallback)
 {
+    Group& group = m_groups[servicegroupName];
+    group.name = servicegroupName;
+    group.nodeName = nodeName;
+    group.scope = scope;
+    group.discoveryCallback = discoveryCallback;
+
     // Use HMAC signing for Sync Interests
     // Note: this is not generally recommended, but is used here for simplicity
     ndn::svs::SecurityOptions secOpts(m_keyChain);
@@ -54,39 +193,402 @@ ServiceDiscovery::ServiceDiscovery(const ndn::Name& servicegroupName, const ndn:
     opts.useTimestamp = false;
     // opts.maxPubAge = ndn::time::seconds(10);
 
-    m_svsps = std::make_shared<ndn::svs::SVSPubSub>(
+    group.svsps = std::make_shared<ndn::svs::SVSPubSub>(
       ndn::Name(servicegroupName).append("NDNSD"),
       ndn::Name(nodeName),
       m_face,
-      [](const std::vector<ndn::svs::MissingDataInfo>& data) {},
+      [this] (const std::vector<ndn::svs::MissingDataInfo>& missingData) {
+        OnSyncUpdate(missingData);
+      },
       opts,
       secOpts);
 
-    std::string ndnsdUpdateRegex = "^(<>*)<NDNSD><service-info>";
-
-    m_svsps->subscribeWithRegex(ndn::Regex(ndnsdUpdateRegex),
-                                std::bind(&ServiceDiscovery::OnServiceUpdate, this, std::placeholders::_1),
-                                true, false);
+    // map nodes are stable, the subscriptions die with group.svsps
+    subscribe(group);
 
     std::string ndnsdDiscoveryRegex = "^(<>*)<NDNSD><discovery>";
 
-    m_svsps->subscribeWithRegex(ndn::Regex(ndnsdDiscoveryRegex),
-                                std::bind(&ServiceDiscovery::OnServiceDiscovery, this, std::placeholders::_1),
-                                true, false);
+    group.svsps->subscribeWithRegex(ndn::Regex(ndnsdDiscoveryRegex),
+                                    [this, &group] (const SVSPubSub::SubscriptionData& subscription) {
+                                      OnServiceDiscovery(group, subscription);
+                                    },
+                                    true, false);
+
+    std::string ndnsdSummaryRegex = "^(<>*)<NDNSD><summary>";
 
-    m_svsps->publish(ndn::Name().append(m_nodeName.toUri()).append("NDNSD").append("discovery").appendVersion(), ndn::span<const uint8_t>());
+    group.svsps->subscribeWithRegex(ndn::Regex(ndnsdSummaryRegex),
+                                    [this, &group] (const SVSPubSub::SubscriptionData& subscription) {
+                                      OnSummary(group, subscription);
+                                    },
+                                    true, false);
+
+    return group;
 }
-ServiceDiscovery::~ServiceDiscovery()
+
+void ServiceDiscovery::subscribe(Group& group)
 {
-  stop();
+  for (auto handle : group.subscriptions) {
+    group.svsps->unsubscribe(handle);
+  }
+  group.subscriptions.clear();
+
+  // only the publications that pass the filter are fetched
+  for (const auto& regex : m_subscriptionFilter.makeRegexes("service-info", true)) {
+    group.subscriptions.push_back(group.svsps->subscribeWithRegex(ndn::Regex(regex),
+      [this, &group] (const SVSPubSub::SubscriptionData& subscription) {
+        OnServiceUpdate(group, subscription);
+      },
+      true, false));
+  }
+  for (const auto& regex : m_subscriptionFilter.makeRegexes("heartbeat", false)) {
+    group.subscriptions.push_back(group.svsps->subscribeWithRegex(ndn::Regex(regex),
+      [this, &group] (const SVSPubSub::SubscriptionData& subscription) {
+        OnHeartbeat(group, subscription);
+      },
+      true, false));
+  }
 }
 
-void ServiceDiscovery::publishServiceDetail(Details details)
+void ServiceDiscovery::setSubscriptionFilter(const SubscriptionFilter& filter)
+{
+  m_subscriptionFilter = filter;
+  for (auto& item : m_groups) {
+    subscribe(item.second);
+  }
+}
+
+bool ServiceDiscovery::aggregateInto(const ndn::Name& parentGroupName, const ndn::Name& nodeName)
+{
+  if (m_aggregation || parentGroupName == m_servicegroupName) {
+    return false;
+  }
+  if (m_groups.count(parentGroupName) == 0) {
+    joinGroup(parentGroupName, nodeName);
+  }
+  const Group& parent = m_groups.at(parentGroupName);
+  NDNSD_LOG_DEBUG("Aggregating " << m_servicegroupName << " into " << parentGroupName << " as "
+                  << parent.nodeName);
+
+  m_aggregation = std::make_unique<Aggregation>();
+  m_aggregation->parentGroup = parentGroupName;
+  m_aggregation->lookupPrefix = ndn::Name(parent.nodeName).append("NDNSD").append("lookup");
+  // a restarted aggregator supersedes the summaries of its previous run
+  m_aggregation->generation = getCurrentTimeMs();
+  m_aggregation->lookupFilter = m_face.setInterestFilter(
+    ndn::InterestFilter(m_aggregation->lookupPrefix),
+    [this] (const ndn::InterestFilter&, const ndn::Interest& interest) {
+      onLookup(interest);
+    },
+    [] (const ndn::Name& prefix, const std::string& reason) {
+      NDNSD_LOG_ERROR("Cannot register " << prefix << ": " << reason);
+    });
+  publishSummary(true);
+  return true;
+}
+
+bool ServiceDiscovery::joinGroup(const ndn::Name& servicegroupName, const ndn::Name& nodeName,
+                                 const DiscoveryCallback& discoveryCallback)
+{
+  if (m_groups.count(servicegroupName) > 0) {
+    return false;
+  }
+  NDNSD_LOG_DEBUG("Joining group " << servicegroupName << " as " << nodeName);
+  Group& group = addGroup(servicegroupName, nodeName, servicegroupName, discoveryCallback);
+
+  // services of the group restored from the cache make the discovery message unnecessary
+  bool isRestored = false;
+  m_registry.forEach([&] (ServiceRegistry::EntryId id) {
+    isRestored = isRestored || m_registry.getScope(id) == group.scope;
+  });
+  if (!isRestored) {
+    publishDiscovery(group);
+  }
+  return true;
+}
+
+bool ServiceDiscovery::leaveGroup(const ndn::Name& servicegroupName)
+{
+  auto it = m_groups.find(servicegroupName);
+  if (it == m_groups.end() || it->second.scope.empty()) {
+    return false;
+  }
+  NDNSD_LOG_DEBUG("Leaving group " << servicegroupName);
+
+  std::vector<ServiceRegistry::EntryId> ids;
+  m_registry.forEach([&] (ServiceRegistry::EntryId id) {
+    if (m_registry.getScope(id) == servicegroupName) {
+      ids.push_back(id);
+    }
+  });
+  for (auto id : ids) {
+    Details details = m_registry.get(id);
+    if (m_cache) {
+      m_cache->recordErase(details, servicegroupName);
+      scheduleCacheFlush();
+    }
+    m_journal.append(Change::EXPIRED, details, servicegroupName);
+    m_registry.erase(id);
+  }
+  if (m_aggregation && m_aggregation->parentGroup == servicegroupName) {
+    NDNSD_LOG_DEBUG("Stop aggregating into " << servicegroupName);
+    m_aggregation.reset();
+  }
+  m_groups.erase(it);
+  evictServices();
+  return true;
+}
+
+std::vector<ndn::Name> ServiceDiscovery::getGroups() const
+{
+  std::vector<ndn::Name> groups;
+  for (const auto& item : m_groups) {
+    groups.push_back(item.first);
+  }
+  return groups;
+}
+
+const ServiceDiscovery::Group* ServiceDiscovery::findGroup(const ndn::Name& servicegroupName) const
+{
+  auto it = m_groups.find(servicegroupName);
+  return it == m_groups.end() ? nullptr : &it->second;
+}
+
+const ServiceDiscovery::Group* ServiceDiscovery::findGroupByScope(const ndn::Name& scope) const
+{
+  // the scope of a joined group is its name, the primary group has the default scope
+  if (!scope.empty()) {
+    return findGroup(scope);
+  }
+  for (const auto& item : m_groups) {
+    if (item.second.scope.empty()) {
+      return &item.second;
+    }
+  }
+  return nullptr;
+}
+
+void ServiceDiscovery::publishDiscovery(Group& group, bool isResync)
+{
+  ndn::Name name = ndn::Name().append(group.nodeName.toUri()).append("NDNSD").append("discovery");
+  if (isResync) {
+    name.append(RESYNC_COMPONENT);
+  }
+  group.svsps->publish(name.appendVersion(), ndn::span<const uint8_t>());
+}
+
+void ServiceDiscovery::publish(Group& group, const Details& published)
 {
-  NDN_LOG_DEBUG("Publishing service detail");
-  m_serviceDetails[details.serviceName.toUri()] = details;
+  Details details = published;
+  details.publishTimestampMs = getCurrentTimeMs();
+  if (m_traceHops) {
+    details.hopTrace.push_back({group.nodeName, details.publishTimestampMs});
+  }
   ndn::Block block = details.encode();
-  m_svsps->publish(ndn::Name().append(m_nodeName.toUri()).append(details.serviceName).append("NDNSD").append("service-info").appendVersion(), ndn::span<const uint8_t>(block.data(), block.size()));
+  m_instruments.nPublished.add();
+  m_instruments.nBytesOut.add(block.size());
+  auto seqNo = group.svsps->publish(ndn::Name().append(group.nodeName.toUri()).append(details.serviceName).append("NDNSD").append("service-info").appendVersion(), ndn::span<const uint8_t>(block.data(), block.size()));
+  NDNSD_LOG_EVENT(PUBLISH, details.serviceName, seqNo, block.size(),
+                  "Published " << details.serviceName << " in " << group.name);
+}
+
+void ServiceDiscovery::publishServiceDetail(Details details)
+{
+  publishServiceDetail(m_servicegroupName, details);
+}
+
+bool ServiceDiscovery::publishServiceDetail(const ndn::Name& servicegroupName, const Details& details)
+{
+  auto it = m_groups.find(servicegroupName);
+  if (it == m_groups.end()) {
+    return false;
+  }
+  NDNSD_LOG_DEBUG("Publishing service detail in " << servicegroupName);
+  std::string key = details.serviceName.toUri();
+  Details& published = it->second.serviceDetails[key] = details;
+  // receivers drop the versions up to the withdrawn one, even if published in the same second
+  auto withdrawn = it->second.withdrawnVersions.find(key);
+  if (withdrawn != it->second.withdrawnVersions.end()) {
+    published.publishTimestamp = std::max(published.publishTimestamp, withdrawn->second + 1);
+    it->second.withdrawnVersions.erase(withdrawn);
+  }
+  publish(it->second, published);
+  return true;
+}
+
+bool ServiceDiscovery::withdrawServiceDetail(const ndn::Name& serviceName)
+{
+  return withdrawServiceDetail(m_servicegroupName, serviceName);
+}
+
+bool ServiceDiscovery::withdrawServiceDetail(const ndn::Name& servicegroupName,
+                                             const ndn::Name& serviceName)
+{
+  auto group = m_groups.find(servicegroupName);
+  if (group == m_groups.end()) {
+    return false;
+  }
+  auto published = group->second.serviceDetails.find(serviceName.toUri());
+  if (published == group->second.serviceDetails.end()) {
+    return false;
+  }
+  NDNSD_LOG_DEBUG("Withdrawing " << serviceName << " from " << servicegroupName);
+  Details withdrawal = std::move(published->second);
+  group->second.serviceDetails.erase(published);
+  group->second.withdrawnVersions[serviceName.toUri()] = withdrawal.publishTimestamp;
+  withdrawal.withdrawnTimestampMs = getCurrentTimeMs();
+  publish(group->second, withdrawal);
+  return true;
+}
+
+bool ServiceDiscovery::publishHeartbeat(const ndn::Name& serviceName, const Heartbeat& heartbeat)
+{
+  return publishHeartbeat(m_servicegroupName, serviceName, heartbeat);
+}
+
+bool ServiceDiscovery::publishHeartbeat(const ndn::Name& servicegroupName,
+                                        const ndn::Name& serviceName, const Heartbeat& heartbeat)
+{
+  auto group = m_groups.find(servicegroupName);
+  if (group == m_groups.end()) {
+    return false;
+  }
+  auto published = group->second.serviceDetails.find(serviceName.toUri());
+  if (published == group->second.serviceDetails.end()) {
+    return false;
+  }
+
+  Details& details = published->second;
+  if (heartbeat.lease > 0) {
+    // answer later discovery messages with the renewed lease, publishTimestamp stays the
+    // version so that receivers take them as duplicates
+    details.leaseEnd = static_cast<uint64_t>(getCurrentTime()) + heartbeat.lease;
+  }
+  auto wire = heartbeat.encode();
+  m_instruments.nBytesOut.add(wire.size());
+  group->second.svsps->publish(ndn::Name().append(details.applicationPrefix.toUri()).append(serviceName).append("NDNSD").append("heartbeat").appendVersion(), ndn::span<const uint8_t>(wire.data(), wire.size()));
+  return true;
+}
+
+std::map<std::string, Details>
+ServiceDiscovery::getReceivedServiceDetails(const ndn::Name& servicegroupName) const
+{
+  const Group* group = findGroup(servicegroupName);
+  if (group == nullptr) {
+    return {};
+  }
+  return m_registry.toMap(group->scope);
+}
+
+std::vector<Details> ServiceDiscovery::findServices(const Query& query) const
+{
+  std::vector<Details> services;
+  for (auto id : m_registry.query(query)) {
+    m_registry.touch(id);
+    services.push_back(m_registry.get(id));
+  }
+  return services;
+}
+
+std::vector<Details> ServiceDiscovery::findServices(const Query& query,
+                                                    const ndn::Name& servicegroupName) const
+{
+  std::vector<Details> services;
+  const Group* group = findGroup(servicegroupName);
+  if (group == nullptr) {
+    return services;
+  }
+  for (auto id : m_registry.query(query)) {
+    if (m_registry.getScope(id) == group->scope) {
+      m_registry.touch(id);
+      services.push_back(m_registry.get(id));
+    }
+  }
+  return services;
+}
+
+void ServiceDiscovery::resolve(const ndn::Name& serviceName, ndn::time::milliseconds timeout,
+                               const ResolveCallback& callback)
+{
+  auto details = findProvider(serviceName);
+  if (details) {
+    callback(details);
+    return;
+  }
+  addWaiter(serviceName, timeout, callback);
+  lookUp(serviceName);
+}
+
+std::future<std::optional<Details>>
+ServiceDiscovery::resolveFuture(const ndn::Name& serviceName, ndn::time::milliseconds timeout)
+{
+  auto promise = std::make_shared<std::promise<std::optional<Details>>>();
+  auto future = promise->get_future();
+  boost::asio::post(m_face.getIoService(), [=] {
+    resolve(serviceName, timeout, [promise] (const std::optional<Details>& details) {
+      promise->set_value(details);
+    });
+  });
+  return future;
+}
+
+#ifdef NDNSD_HAVE_COROUTINES
+ServiceDiscovery::ResolveAwaitable
+ServiceDiscovery::resolve(const ndn::Name& serviceName, ndn::time::milliseconds timeout)
+{
+  return ResolveAwaitable(*this, serviceName, timeout);
+}
+#endif // NDNSD_HAVE_COROUTINES
+
+std::optional<Details> ServiceDiscovery::selectProvider(const ndn::Name& serviceName,
+                                                        SelectionPolicy policy)
+{
+  bool isRecovered = m_registry.getProviders(serviceName).empty() &&
+                     recoverServices(serviceName);
+  auto id = m_selector.select(serviceName, policy);
+  if (id == ServiceRegistry::INVALID_ENTRY) {
+    return std::nullopt;
+  }
+  m_registry.touch(id);
+  Details details = m_registry.get(id);
+  if (isRecovered) {
+    evictServices();
+  }
+  return details;
+}
+
+std::optional<Details> ServiceDiscovery::findProvider(const ndn::Name& serviceName)
+{
+  bool isRecovered = m_registry.getProviders(serviceName).empty() &&
+                     recoverServices(serviceName);
+  const auto& providers = m_registry.getProviders(serviceName);
+  if (providers.empty()) {
+    return std::nullopt;
+  }
+  m_registry.touch(providers.front());
+  Details details = m_registry.get(providers.front());
+  if (isRecovered) {
+    evictServices();
+  }
+  return details;
+}
+
+void ServiceDiscovery::addWaiter(const ndn::Name& serviceName, ndn::time::milliseconds timeout,
+                                 const ResolveCallback& callback)
+{
+  uint64_t id = ++m_lastWaiterId;
+  Waiter& waiter = m_waiters[serviceName][id];
+  waiter.callback = callback;
+  waiter.timeoutEvent = m_scheduler.schedule(timeout, [this, serviceName, id] {
+    auto it = m_waiters.find(serviceName);
+    auto waiter = it->second.find(id);
+    ResolveCallback callback = std::move(waiter->second.callback);
+    it->second.erase(waiter);
+    if (it->second.empty()) {
+      m_waiters.erase(it);
+    }
+    NDNSD_LOG_DEBUG("Resolving " << serviceName << " timed out");
+    callback(std::nullopt);
+  });
 }
 
 void ServiceDiscovery::run()
@@ -99,40 +601,757 @@ void ServiceDiscovery::stop()
   
 }
 
-void ServiceDiscovery::OnServiceUpdate(const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+void ServiceDiscovery::OnSyncUpdate(const std::vector<ndn::svs::MissingDataInfo>& missingData)
 {
-  NDN_LOG_DEBUG("Service update received : " << subscription.name);
-  try
-  {
-    Details details = Details::decode(ndn::Block(subscription.data));
-    m_receivedDetails[ndn::Name().append(details.applicationPrefix).append(details.serviceName).toUri()] = details;
+  auto now = ndn::time::system_clock::now();
+  for (const auto& info : missingData) {
+    // the earliest notification of a sequence number is the one that counts
+    m_notified[info.nodeId].emplace(info.high, now);
+    if (m_churnController) {
+      m_churnController->recordUpdates(info.high - info.low + 1);
+    }
+  }
+}
 
-    m_discoveryCallback(details);
+void ServiceDiscovery::OnServiceUpdate(Group& group,
+                                       const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+{
+  // <nodeName>/<serviceName>/NDNSD/service-info/<version>, the publications of a filter
+  // replaced by setSubscriptionFilter() may still be in flight
+  const ndn::Name& name = subscription.name;
+  if (!m_subscriptionFilter.matchesAll() && name.size() >= 4 &&
+      !m_subscriptionFilter.matches(ndn::Name(ndn::encoding::readString(name[0])),
+                                    name.getSubName(1, name.size() - 4))) {
+    return;
   }
-  catch (const std::exception& e)
-  {
-    NDN_LOG_DEBUG("Error decoding service detail: " << e.what());
+  NDNSD_LOG_EVENT(SERVICE_UPDATE, subscription.name, subscription.seqNo, subscription.data.size(),
+                  "Service update received in " << group.name << " : " << subscription.name);
+  auto receivedAt = ndn::time::system_clock::now();
+  m_instruments.nUpdates.add();
+  m_instruments.nBytesIn.add(subscription.data.size());
+
+  std::optional<ndn::time::system_clock::time_point> notifiedAt;
+  auto producer = m_notified.find(subscription.producerPrefix);
+  if (producer != m_notified.end()) {
+    auto notification = producer->second.lower_bound(subscription.seqNo);
+    if (notification != producer->second.end()) {
+      notifiedAt = notification->second;
+      m_instruments.fetchTime.record(receivedAt - *notifiedAt);
+      if (m_churnController && m_churnController->recordFetch(receivedAt - *notifiedAt)) {
+        ++group.nLateFetches;
+      }
+    }
+  }
+
+  auto decodeStart = ndn::time::steady_clock::now();
+  auto result = Details::tryDecode(subscription.data.data(),
+                                   subscription.data.data() + subscription.data.size());
+  m_instruments.decodeTime.record(ndn::time::steady_clock::now() - decodeStart);
+  if (!result) {
+    NDNSD_LOG_EVENT(DECODE_FAILURE, subscription.name, subscription.seqNo,
+                    static_cast<uint64_t>(result.status()),
+                    "Error decoding service detail: " << result.errorMessage());
+    m_instruments.nDecodeFailures.add();
+    return;
+  }
+
+  Details& details = *result;
+  // older publishers only give publishTimestamp, the start of a lease that may be hours old,
+  // no latency is measured for them
+  if (details.publishTimestampMs != 0) {
+    // publisher and receiver clocks are assumed in sync, a negative latency counts as 0
+    auto publishedAt = ndn::time::fromUnixTimestamp(
+      ndn::time::milliseconds(details.publishTimestampMs));
+    m_instruments.updateLatency.record(receivedAt - publishedAt);
+    if (notifiedAt) {
+      m_instruments.syncTime.record(*notifiedAt - publishedAt);
+    }
+  }
+  if (details.withdrawnTimestampMs != 0) {
+    unregisterService(group, details);
     return;
   }
+  registerService(group, details);
 }
 
-void ServiceDiscovery::OnServiceDiscovery(const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+void ServiceDiscovery::unregisterService(Group& group, const Details& details)
 {
-  NDN_LOG_DEBUG("Discovery callback received : " << subscription.name);
-  if (m_lastDiscoveryTime + ndn::time::seconds(5) > ndn::time::steady_clock::now()) {
-    NDN_LOG_DEBUG("Skip discovery callback within 5 seconds");
-    // Record the time, and won't do it in next 5 seconds
-    m_lastDiscoveryTime = ndn::time::steady_clock::now();
+  // also when the withdrawn details were not fetched yet
+  time_t leaseEnd = details.getLeaseEnd();
+  auto& withdrawal = m_withdrawals[{group.scope, ServiceRegistry::makeKey(details.applicationPrefix,
+                                                                          details.serviceName)}];
+  withdrawal.version = std::max(withdrawal.version, details.publishTimestamp);
+  withdrawal.expiry = std::max(withdrawal.expiry, leaseEnd != 0 ? leaseEnd :
+                                                  getCurrentTime() + WITHDRAWAL_LIFETIME);
+
+  auto id = m_registry.find(details.applicationPrefix, details.serviceName, group.scope);
+  // a withdrawal fetched late must not drop the service published again since
+  if (id == ServiceRegistry::INVALID_ENTRY ||
+      m_registry.getPublishTimestamp(id) > details.publishTimestamp) {
     return;
   }
-  // Record the time, and won't do it in next 5 seconds
-  m_lastDiscoveryTime = ndn::time::steady_clock::now();
+  NDNSD_LOG_DEBUG("Service " << details.serviceName << " of " << details.applicationPrefix
+                  << " withdrawn from " << group.name);
+  Details registered = m_registry.get(id);
+  if (m_cache) {
+    m_cache->recordErase(registered, group.scope);
+    scheduleCacheFlush();
+  }
+  m_journal.append(Change::EXPIRED, std::move(registered), group.name);
+  m_registry.erase(id);
+  if (group.scope.empty()) {
+    scheduleSummary();
+  }
+  evictServices();
+}
+
+void ServiceDiscovery::registerService(Group& group, const Details& details)
+{
+  auto withdrawal = m_withdrawals.find({group.scope,
+                                        ServiceRegistry::makeKey(details.applicationPrefix,
+                                                                 details.serviceName)});
+  if (withdrawal != m_withdrawals.end()) {
+    if (details.publishTimestamp <= withdrawal->second.version) {
+      NDNSD_LOG_DEBUG("Withdrawn version of " << details.serviceName << ", skip callback");
+      return;
+    }
+    m_withdrawals.erase(withdrawal);
+  }
+  auto inserted = m_registry.insert(details, group.scope);
+  if (inserted.isDuplicate) {
+    NDNSD_LOG_DEBUG("Duplicate of the registered service, skip callback");
+    if (inserted.isRenewed) {
+      ++m_nUnjournaledChanges;
+    }
+    return;
+  }
+  m_journal.append(inserted.isNew ? Change::ADDED : Change::UPDATED, details, group.name);
+  if (m_traceHops && group.scope.empty()) {
+    m_receivedTraces[{details.applicationPrefix, details.serviceName}] =
+      {details.publishTimestamp, details.hopTrace};
+  }
+  if (m_cache) {
+    m_cache->recordInsert(details, group.scope);
+    if (m_cache->shouldCompact(m_registry.size())) {
+      compactCache();
+    }
+    else {
+      scheduleCacheFlush();
+    }
+  }
+  if (group.scope.empty()) {
+    scheduleSummary();
+  }
+
+  auto callbackStart = ndn::time::steady_clock::now();
+  reportService(details, group.scope);
+  m_instruments.callbackTime.record(ndn::time::steady_clock::now() - callbackStart);
+  evictServices();
+}
+
+void ServiceDiscovery::OnServiceDiscovery(Group& group,
+                                          const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+{
+  // <nodeName>/NDNSD/discovery[/resync]/<version>; a resync follows lost publications, that
+  // the answers suppressed meanwhile may not cover
+  const ndn::Name& name = subscription.name;
+  bool isResync = name.size() >= 2 && name.get(-2) == ndn::name::Component(RESYNC_COMPONENT);
+  if (m_churnController && !isResync) {
+    m_churnController->recordJoin();
+  }
+  // the window runs from the last answered message, suppressed ones do not extend it
+  if (!isResync && group.lastDiscoveryTime + m_republishWindow > ndn::time::steady_clock::now()) {
+    NDNSD_LOG_EVENT(DISCOVERY_SUPPRESSED, subscription.name, subscription.seqNo,
+                    group.serviceDetails.size(),
+                    "Skip discovery callback within " << m_republishWindow);
+    m_instruments.nSuppressedResponses.add();
+    return;
+  }
+  NDNSD_LOG_EVENT(SERVICE_DISCOVERY, subscription.name, subscription.seqNo,
+                  group.serviceDetails.size(),
+                  "Discovery callback received in " << group.name << " : " << subscription.name);
+  // Record the time, and won't do it within the republish window
+  group.lastDiscoveryTime = ndn::time::steady_clock::now();
   // publish cached details
-  for (auto& item : m_serviceDetails)
+  for (auto& item : group.serviceDetails)
   {
-    auto block = item.second.encode();
-    m_svsps->publish(ndn::Name().append(m_nodeName.toUri()).append(item.first).append("NDNSD").append("service-info").appendVersion(), ndn::span<const uint8_t>(block.data(), block.size()));
+    publish(group, item.second);
+  }
+  if (m_aggregation && m_aggregation->parentGroup == group.name) {
+    publishSummary(true);
+  }
+}
+
+void ServiceDiscovery::OnHeartbeat(Group& group,
+                                   const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+{
+  // <applicationPrefix>/<serviceName>/NDNSD/heartbeat/<version>
+  const ndn::Name& name = subscription.name;
+  m_instruments.nBytesIn.add(subscription.data.size());
+  auto heartbeat = Heartbeat::decode(subscription.data.data(), subscription.data.size());
+  if (!heartbeat || name.size() < 5) {
+    NDNSD_LOG_EVENT(DECODE_FAILURE, name, subscription.seqNo, 0, "Invalid heartbeat " << name);
+    m_instruments.nDecodeFailures.add();
+    return;
+  }
+  ndn::Name applicationPrefix(ndn::encoding::readString(name[0]));
+  auto id = m_registry.find(applicationPrefix, name.getSubName(1, name.size() - 4), group.scope);
+  if (id == ServiceRegistry::INVALID_ENTRY) {
+    NDNSD_LOG_TRACE("Heartbeat of an unknown service " << name);
+    return;
+  }
+  NDNSD_LOG_EVENT(HEARTBEAT, name, subscription.seqNo, heartbeat->load,
+                  "Heartbeat " << name << " load " << heartbeat->load);
+  m_registry.applyHeartbeat(id, *heartbeat, getCurrentTime());
+  ++m_nUnjournaledChanges;
+  if (heartbeat->lease > 0 && group.scope.empty()) {
+    // the lease end of the summary may have to follow
+    summaryChanged({m_registry.getServiceName(id)});
+  }
+}
+
+void ServiceDiscovery::OnSummary(Group& group,
+                                 const ndn::svs::SVSPubSub::SubscriptionData &subscription)
+{
+  // <nodeName>/NDNSD/summary/<version>
+  const ndn::Name& name = subscription.name;
+  m_instruments.nBytesIn.add(subscription.data.size());
+  auto result = ServiceSummary::tryDecode(subscription.data.data(),
+                                          subscription.data.data() + subscription.data.size());
+  if (!result || name.size() < 4) {
+    NDNSD_LOG_EVENT(DECODE_FAILURE, name, subscription.seqNo,
+                    static_cast<uint64_t>(result.status()), "Invalid summary " << name);
+    m_instruments.nDecodeFailures.add();
+    return;
+  }
+  ndn::Name aggregator(ndn::encoding::readString(name[0]));
+  if (aggregator == group.nodeName) {
+    return;
+  }
+  uint64_t generation = result->generation;
+  auto changed = group.summaries.apply(aggregator, std::move(*result));
+  NDNSD_LOG_DEBUG("Summary " << generation << " of " << aggregator << " in " << group.name
+                  << " changed " << changed.size() << " services");
+  if (group.scope.empty()) {
+    summaryChanged(changed);
+  }
+  // resolutions that were waiting for a provider can look it up now
+  for (const auto& serviceName : changed) {
+    if (m_waiters.count(serviceName) > 0) {
+      lookUp(serviceName);
+    }
+  }
+}
+
+void ServiceDiscovery::summaryChanged(const std::vector<ndn::Name>& serviceNames)
+{
+  if (!m_aggregation || serviceNames.empty()) {
+    return;
+  }
+  m_aggregation->changed.insert(serviceNames.begin(), serviceNames.end());
+  scheduleSummary();
+}
+
+void ServiceDiscovery::scheduleSummary()
+{
+  if (!m_aggregation || m_aggregation->isScheduled) {
+    return;
+  }
+  m_aggregation->isScheduled = true;
+  m_aggregation->summaryEvent = m_scheduler.schedule(m_summaryInterval, [this] {
+    publishSummary(false);
+  });
+}
+
+// whether the parent group must be sent current instead of published; a lease end that only
+// moved later is sent once half of the published remaining lease is gone, like a DHCP
+// renewal, so that the heartbeats of a service do not put it in every summary
+static bool
+isOutdated(const SummaryEntry& published, const SummaryEntry& current, time_t now)
+{
+  if (published.nProviders != current.nProviders ||
+      (published.expiry == 0) != (current.expiry == 0) || current.expiry < published.expiry) {
+    return true;
+  }
+  return published.expiry - now < (current.expiry - now) / 2;
+}
+
+void ServiceDiscovery::publishSummary(bool isComplete)
+{
+  Aggregation& aggregation = *m_aggregation;
+  aggregation.isScheduled = false;
+  aggregation.summaryEvent.cancel();
+  const Group& primary = m_groups.at(m_servicegroupName);
+
+  auto batch = m_journal.changesSince(aggregation.journalCursor);
+  aggregation.journalCursor = batch.cursor;
+  auto& changed = aggregation.changed;
+  if (isComplete || batch.isBehind) {
+    m_registry.forEach([&] (ServiceRegistry::EntryId id) {
+      if (m_registry.getScope(id).empty()) {
+        changed.insert(m_registry.getServiceName(id));
+      }
+    });
+    for (auto& serviceName : primary.summaries.getServices()) {
+      changed.insert(std::move(serviceName));
+    }
+    for (const auto& item : aggregation.published) {
+      changed.insert(item.first);
+    }
+  }
+  for (const auto& change : batch.changes) {
+    if (change.group == m_servicegroupName) {
+      changed.insert(change.details.serviceName);
+    }
+  }
+
+  ServiceSummary summary;
+  time_t now = getCurrentTime();
+  for (const auto& serviceName : changed) {
+    SummaryEntry entry = summarizeService(serviceName);
+    auto published = aggregation.published.find(serviceName);
+    if (published == aggregation.published.end()) {
+      if (entry.nProviders == 0) {
+        continue;
+      }
+      aggregation.published.emplace(serviceName, entry);
+    }
+    else if (!isOutdated(published->second, entry, now)) {
+      continue;
+    }
+    else if (entry.nProviders == 0) {
+      aggregation.published.erase(published);
+    }
+    else {
+      published->second = entry;
+    }
+    summary.entries.push_back(std::move(entry));
+  }
+  changed.clear();
+
+  if (!isComplete && summary.entries.empty()) {
+    return;
+  }
+  if (isComplete || ++aggregation.nChanges >= COMPLETE_SUMMARY_PERIOD) {
+    summary.entries.clear();
+    for (const auto& item : aggregation.published) {
+      summary.entries.push_back(item.second);
+    }
+    aggregation.nChanges = 0;
+  }
+  else {
+    summary.base = aggregation.generation;
+  }
+  summary.generation = ++aggregation.generation;
+
+  Group& parent = m_groups.at(aggregation.parentGroup);
+  ndn::Block block = summary.encode();
+  m_instruments.nSummaries.add();
+  m_instruments.nBytesOut.add(block.size());
+  parent.svsps->publish(ndn::Name().append(parent.nodeName.toUri()).append("NDNSD").append("summary").appendVersion(), ndn::span<const uint8_t>(block.data(), block.size()));
+  NDNSD_LOG_DEBUG("Published " << (summary.isComplete() ? "complete" : "partial") << " summary "
+                  << summary.generation << " of " << summary.entries.size() << " services in "
+                  << parent.name);
+}
+
+SummaryEntry ServiceDiscovery::summarizeService(const ndn::Name& serviceName) const
+{
+  // providers in the primary group, then the ones below its aggregators
+  SummaryEntry entry = m_groups.at(m_servicegroupName).summaries.summarize(serviceName);
+  bool isEndless = entry.nProviders > 0 && entry.expiry == 0;
+  for (auto id : m_registry.getProviders(serviceName)) {
+    if (!m_registry.getScope(id).empty()) {
+      continue;
+    }
+    ++entry.nProviders;
+    time_t leaseEnd = m_registry.getLeaseEnd(id);
+    if (leaseEnd == 0) {
+      isEndless = true;
+    }
+    else {
+      entry.expiry = std::max(entry.expiry, leaseEnd);
+    }
+  }
+  if (isEndless) {
+    entry.expiry = 0;
+  }
+  return entry;
+}
+
+bool ServiceDiscovery::lookUp(const ndn::Name& serviceName)
+{
+  if (m_lookups.count(serviceName) > 0) {
+    return true;
+  }
+  for (const auto& [groupName, group] : m_groups) {
+    auto aggregators = group.summaries.findAggregators(serviceName);
+    if (aggregators.empty()) {
+      continue;
+    }
+    // the aggregator that reaches the most providers
+    ndn::Interest interest(ndn::Name(aggregators.front()).append("NDNSD").append("lookup")
+                           .append(serviceName));
+    interest.setMustBeFresh(true);
+    NDNSD_LOG_DEBUG("Looking up " << serviceName << " from " << aggregators.front());
+    m_instruments.nLookups.add();
+    m_lookups[serviceName] = m_face.expressInterest(interest,
+      [this, groupName = groupName, serviceName] (const ndn::Interest&, const ndn::Data& data) {
+        m_lookups.erase(serviceName);
+        auto group = m_groups.find(groupName);
+        if (group == m_groups.end()) {
+          return;
+        }
+        const ndn::Block& content = data.getContent();
+        schema::ElementReader elements(content.value(), content.value() + content.value_size());
+        uint32_t type = 0;
+        const uint8_t* valueBegin = nullptr;
+        const uint8_t* valueEnd = nullptr;
+        size_t nProviders = 0;
+        while (elements.next(type, valueBegin, valueEnd)) {
+          auto result = type == tlv::ServiceInfo ? DetailsSchema::decodeValue(valueBegin, valueEnd)
+                                                 : schema::DecodeResult<Details>::failure(
+                                                     schema::DecodeStatus::WRONG_TYPE, type);
+          if (!result) {
+            NDNSD_LOG_EVENT(DECODE_FAILURE, data.getName(), 0,
+                            static_cast<uint64_t>(result.status()),
+                            "Error decoding looked up service: " << result.errorMessage());
+            m_instruments.nDecodeFailures.add();
+            continue;
+          }
+          if (hasActiveLease(*result)) {
+            registerService(group->second, *result);
+            ++nProviders;
+          }
+        }
+        NDNSD_LOG_DEBUG("Looked up " << nProviders << " providers of " << serviceName);
+      },
+      [this, serviceName] (const ndn::Interest&, const ndn::lp::Nack&) {
+        NDNSD_LOG_DEBUG("Lookup of " << serviceName << " nacked");
+        m_lookups.erase(serviceName);
+      },
+      [this, serviceName] (const ndn::Interest&) {
+        NDNSD_LOG_DEBUG("Lookup of " << serviceName << " timed out");
+        m_lookups.erase(serviceName);
+      });
+    return true;
+  }
+  return false;
+}
+
+void ServiceDiscovery::onLookup(const ndn::Interest& interest)
+{
+  // <lookupPrefix>/<serviceName>
+  const ndn::Name& name = interest.getName();
+  ndn::Name serviceName = name.getSubName(m_aggregation->lookupPrefix.size());
+  m_instruments.nLookupsServed.add();
+
+  bool isRecovered = m_registry.getProviders(serviceName).empty() &&
+                     recoverServices(serviceName);
+  ndn::Block content(ndn::tlv::Content);
+  size_t size = 0;
+  for (auto id : m_registry.getProviders(serviceName)) {
+    if (!m_registry.getScope(id).empty()) {
+      continue;
+    }
+    Details details = m_registry.get(id);
+    if (!hasActiveLease(details)) {
+      continue;
+    }
+    if (m_traceHops) {
+      auto trace = m_receivedTraces.find({details.applicationPrefix, details.serviceName});
+      if (trace != m_receivedTraces.end() &&
+          trace->second.publishTimestamp == details.publishTimestamp) {
+        details.hopTrace = trace->second.hops;
+      }
+      details.hopTrace.push_back({m_groups.at(m_aggregation->parentGroup).nodeName,
+                                  getCurrentTimeMs()});
+    }
+    ndn::Block block = details.encode();
+    size += block.size();
+    if (size > MAX_LOOKUP_REPLY_SIZE) {
+      break;
+    }
+    content.push_back(block);
+  }
+  if (isRecovered) {
+    evictServices();
+  }
+
+  const Group& primary = m_groups.at(m_servicegroupName);
+  auto aggregators = primary.summaries.findAggregators(serviceName);
+  if (content.elements().empty() && !aggregators.empty()) {
+    // the providers are further down, answer with those of the aggregator below
+    if (m_aggregation->forwarded.count(name) > 0) {
+      return;
+    }
+    ndn::Interest lookup(ndn::Name(aggregators.front()).append("NDNSD").append("lookup")
+                         .append(serviceName));
+    lookup.setMustBeFresh(true);
+    lookup.setInterestLifetime(interest.getInterestLifetime());
+    NDNSD_LOG_DEBUG("Forwarding the lookup of " << serviceName << " to " << aggregators.front());
+    auto done = [this, name] (const ndn::Interest&) {
+      m_aggregation->forwarded.erase(name);
+    };
+    m_aggregation->forwarded[name] = m_face.expressInterest(lookup,
+      [this, name] (const ndn::Interest&, const ndn::Data& data) {
+        m_aggregation->forwarded.erase(name);
+        replyLookup(name, m_traceHops ? appendHop(data.getContent()) : data.getContent());
+      },
+      [done] (const ndn::Interest& lookup, const ndn::lp::Nack&) { done(lookup); },
+      done);
+    return;
+  }
+  content.encode();
+  replyLookup(name, content);
+}
+
+void ServiceDiscovery::replyLookup(const ndn::Name& name, const ndn::Block& content)
+{
+  ndn::Data data(name);
+  data.setContent(content);
+  data.setFreshnessPeriod(1_s);
+  m_keyChain.sign(data, ndn::security::signingWithSha256());
+  m_face.put(data);
+}
+
+ndn::Block ServiceDiscovery::appendHop(const ndn::Block& content) const
+{
+  Hop hop{m_groups.at(m_aggregation->parentGroup).nodeName, getCurrentTimeMs()};
+  ndn::Block relayed(ndn::tlv::Content);
+  schema::ElementReader elements(content.value(), content.value() + content.value_size());
+  uint32_t type = 0;
+  const uint8_t* valueBegin = nullptr;
+  const uint8_t* valueEnd = nullptr;
+  while (elements.next(type, valueBegin, valueEnd)) {
+    if (type != tlv::ServiceInfo) {
+      continue;
+    }
+    auto result = DetailsSchema::decodeValue(valueBegin, valueEnd);
+    if (!result) {
+      continue;
+    }
+    result->hopTrace.push_back(hop);
+    relayed.push_back(result->encode());
+  }
+  relayed.encode();
+  return relayed;
+}
+
+void ServiceDiscovery::reportService(const Details& details, const ndn::Name& scope)
+{
+  auto waiters = m_waiters.find(details.serviceName);
+  if (waiters != m_waiters.end()) {
+    // callbacks may resolve again, take the waiters out first
+    auto resolved = std::move(waiters->second);
+    m_waiters.erase(waiters);
+    for (auto& [id, waiter] : resolved) {
+      waiter.timeoutEvent.cancel();
+      waiter.callback(details);
+    }
+  }
+
+  const Group* group = findGroupByScope(scope);
+  if (group != nullptr && group->discoveryCallback) {
+    group->discoveryCallback(details);
+  }
+  else {
+    m_discoveryCallback(details);
+  }
+}
+
+void ServiceDiscovery::expireServices()
+{
+  size_t nExpired = m_registry.expire(getCurrentTime(), [this] (ServiceRegistry::EntryId id) {
+    Details details = m_registry.get(id);
+    const ndn::Name& scope = m_registry.getScope(id);
+    if (m_cache) {
+      m_cache->recordErase(details, scope);
+      scheduleCacheFlush();
+    }
+    m_journal.append(Change::EXPIRED, std::move(details),
+                     scope.empty() ? m_servicegroupName : scope);
+  });
+  if (nExpired > 0) {
+    NDNSD_LOG_DEBUG("Expired " << nExpired << " services, " << m_registry.size() << " remaining");
+    evictServices();
+  }
+  // traces of the services that are gone or were replaced
+  for (auto it = m_receivedTraces.begin(); it != m_receivedTraces.end();) {
+    auto id = m_registry.find(it->first.first, it->first.second);
+    bool isCurrent = id != ServiceRegistry::INVALID_ENTRY &&
+                     m_registry.getPublishTimestamp(id) == it->second.publishTimestamp;
+    it = isCurrent ? std::next(it) : m_receivedTraces.erase(it);
+  }
+  for (auto it = m_withdrawals.begin(); it != m_withdrawals.end();) {
+    it = it->second.expiry <= getCurrentTime() ? m_withdrawals.erase(it) : std::next(it);
+  }
+  // evicted providers whose leases have all ended cannot be recovered
+  for (auto it = m_evictedServices.begin(); it != m_evictedServices.end();) {
+    bool isEnded = it->second != 0 && it->second <= getCurrentTime();
+    it = isEnded ? m_evictedServices.erase(it) : std::next(it);
+  }
+  for (auto& [groupName, group] : m_groups) {
+    auto ended = group.summaries.expire(getCurrentTime());
+    if (!ended.empty() && group.scope.empty()) {
+      summaryChanged(ended);
+    }
+  }
+  if (m_aggregation && m_aggregation->journalCursor != m_journal.getLastSeqNo()) {
+    scheduleSummary();
+  }
+
+  // notifications of publications that were never fetched, or not service-info ones
+  auto notifiedBefore = ndn::time::system_clock::now() - ndn::time::minutes(1);
+  for (auto producer = m_notified.begin(); producer != m_notified.end();) {
+    auto& notifications = producer->second;
+    for (auto it = notifications.begin(); it != notifications.end();) {
+      it = it->second < notifiedBefore ? notifications.erase(it) : std::next(it);
+    }
+    producer = notifications.empty() ? m_notified.erase(producer) : std::next(producer);
+  }
+  m_expiryEvent = m_scheduler.schedule(ndn::time::seconds(1), [this] { expireServices(); });
+}
+
+void ServiceDiscovery::tune()
+{
+  if (m_churnController->tick(TUNING_PERIOD)) {
+    m_instruments.nTuningChanges.add();
+    setIntervals(m_churnController->getRepublishWindow(), m_churnController->getBatchInterval(),
+                 m_churnController->getSyncInterval());
+    NDNSD_LOG_DEBUG("Updates " << m_churnController->getUpdateRate() << "/s, joins "
+                    << m_churnController->getJoinRate() << "/s, late fetches "
+                    << m_churnController->getLossRate() << ": republish window "
+                    << m_republishWindow << ", summary interval " << m_summaryInterval
+                    << ", sync interval " << m_syncInterval);
+  }
+
+  // publications that were late hint at others that never arrived, have the group
+  // republish them
+  auto now = ndn::time::steady_clock::now();
+  for (auto& [groupName, group] : m_groups) {
+    if (group.nLateFetches == 0 || group.lastResyncTime + m_syncInterval > now) {
+      continue;
+    }
+    NDNSD_LOG_DEBUG("Resync " << groupName << " after " << group.nLateFetches << " late fetches");
+    group.nLateFetches = 0;
+    group.lastResyncTime = now;
+    m_instruments.nResyncs.add();
+    publishDiscovery(group, true);
+  }
+  m_tuningEvent = m_scheduler.schedule(TUNING_PERIOD, [this] { tune(); });
+}
+
+void ServiceDiscovery::setIntervals(ndn::time::milliseconds republishWindow,
+                                    ndn::time::milliseconds summaryInterval,
+                                    ndn::time::milliseconds syncInterval)
+{
+  // gauges shared with other instances hold the sum of the contributions
+  m_instruments.republishWindow.add((republishWindow - m_republishWindow).count());
+  m_instruments.summaryInterval.add((summaryInterval - m_summaryInterval).count());
+  m_instruments.syncInterval.add((syncInterval - m_syncInterval).count());
+  m_republishWindow = republishWindow;
+  m_summaryInterval = summaryInterval;
+  m_syncInterval = syncInterval;
+}
+
+size_t ServiceDiscovery::restoreServices(const std::string& cacheDirectory)
+{
+  if (cacheDirectory.empty()) {
+    return 0;
+  }
+  m_cache = std::make_unique<RegistryCache>(cacheDirectory);
+  m_cache->load(m_registry);
+  m_registry.expire(getCurrentTime());
+  evictServices();
+  // start from a snapshot of exactly what was restored
+  compactCache();
+
+  // report restored services from the event loop, like received ones, so that the groups
+  // joined right after construction get theirs
+  m_scheduler.schedule(0_ms, [this] {
+    m_registry.forEach([this] (ServiceRegistry::EntryId id) {
+      Details details = m_registry.get(id);
+      const ndn::Name& scope = m_registry.getScope(id);
+      m_journal.append(Change::ADDED, details, scope.empty() ? m_servicegroupName : scope);
+      reportService(details, scope);
+    });
+  });
+  return m_registry.size();
+}
+
+void ServiceDiscovery::evictServices()
+{
+  size_t nEvicted = m_registry.evict([this] (ServiceRegistry::EntryId id) {
+    Details details = m_registry.get(id);
+    // without a cache there is nothing to recover them from
+    if (m_cache) {
+      // remembered until the last lease ends, 0 being endless
+      time_t leaseEnd = m_registry.getLeaseEnd(id);
+      auto inserted = m_evictedServices.emplace(details.serviceName, leaseEnd);
+      time_t& known = inserted.first->second;
+      if (!inserted.second && known != 0) {
+        known = leaseEnd == 0 ? 0 : std::max(known, leaseEnd);
+      }
+    }
+    const ndn::Name& scope = m_registry.getScope(id);
+    m_journal.append(Change::EVICTED, std::move(details),
+                     scope.empty() ? m_servicegroupName : scope);
+  });
+  if (nEvicted > 0) {
+    m_instruments.nEvictions.add(nEvicted);
+    NDNSD_LOG_DEBUG("Evicted " << nEvicted << " services, " << m_registry.size() << " remaining in "
+                    << m_registry.getAccountedBytes() << " bytes");
+  }
+
+  size_t bytes = m_registry.getAccountedBytes();
+  m_instruments.registryBytes.add(static_cast<int64_t>(bytes) -
+                                  static_cast<int64_t>(m_reportedBytes));
+  m_reportedBytes = bytes;
+}
+
+bool ServiceDiscovery::recoverServices(const ndn::Name& serviceName)
+{
+  auto evicted = m_evictedServices.find(serviceName);
+  if (evicted == m_evictedServices.end()) {
+    return false;
+  }
+  m_evictedServices.erase(evicted);
+  size_t nRecovered = m_cache->recover(serviceName, m_registry,
+                                       [this] (const Details& details, const ndn::Name& scope) {
+    // not the services of a group left since
+    if (!hasActiveLease(details) || findGroupByScope(scope) == nullptr) {
+      return false;
+    }
+    // accepted providers are inserted right after
+    m_journal.append(Change::ADDED, details, scope.empty() ? m_servicegroupName : scope);
+    return true;
+  });
+  m_instruments.nRecoveries.add(nRecovered);
+  return nRecovered > 0;
+}
+
+void ServiceDiscovery::scheduleCacheFlush()
+{
+  if (m_isCacheFlushScheduled) {
+    return;
+  }
+  m_isCacheFlushScheduled = true;
+  m_cacheFlushEvent = m_scheduler.schedule(CACHE_FLUSH_DELAY, [this] {
+    m_isCacheFlushScheduled = false;
+    m_cache->flush();
+  });
+}
+
+void ServiceDiscovery::compactCache()
+{
+  if (m_registry.getMemoryBudget() == 0) {
+    m_cache->compact(m_registry);
+    return;
   }
+  // the cache is the only copy of the evicted services
+  m_cache->compact(m_registry, [] (const Details& details, const ndn::Name&) {
+    return hasActiveLease(details);
+  });
 }
 
 } // namespace discovery
@@ -20,7 +20,17 @@
 #ifndef NDNSD_SERVICE_DISCOVERY_HPP
 #define NDNSD_SERVICE_DISCOVERY_HPP
 
+#include "change-journal.hpp"
+#include "churn-controller.hpp"
+#include "details.hpp"
 #include "file-processor.hpp"
+#include "heartbeat.hpp"
+#include "metrics.hpp"
+#include "provider-selector.hpp"
+#include "registry-cache.hpp"
+#include "service-registry.hpp"
+#include "service-summary.hpp"
+#include "subscription-filter.hpp"
 
 #include <ndn-cxx/face.hpp>
 #include <ndn-cxx/util/random.hpp>
@@ -28,35 +38,24 @@
 #include <ndn-cxx/util/time.hpp>
 #include <ndn-cxx/util/dummy-client-face.hpp>
 
-#include <ndn-cxx/encoding/block-helpers.hpp>
-
 #include <ndn-svs/svspubsub.hpp>
 
 #include <iostream>
+#include <future>
+#include <optional>
+#include <set>
 
 #include <thread>
 
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define NDNSD_HAVE_COROUTINES 1
+#endif
+
 using namespace ndn::time_literals;
 
 namespace ndnsd {
 namespace discovery {
-namespace tlv {
-
-  enum {
-    DiscoveryData = 128,
-    ServiceInfo = 129,
-    ServiceStatus = 130,
-    Name = 131,               // New TLV type for serviceName
-    ApplicationPrefix = 132,  // New TLV type for applicationPrefix
-    ServiceLifetime = 133,    // New TLV type for serviceLifetime
-    PublishTimestamp = 134,   // New TLV type for publishTimestamp
-    ServiceMetaInfo = 135,    // New TLV type for serviceMetaInfo
-    Key = 136,                // New TLV type for keys in serviceMetaInfo
-    Value = 137,               // New TLV type for values in serviceMetaInfo
-    KeyValuePair = 138         // New TLV type for key-value pairs in serviceMetaInfo
-  };
-
-} // namespace tlv
 
 enum {
   OPTIONAL = 0,
@@ -77,104 +76,63 @@ enum {
 extern uint32_t RETRANSMISSION_COUNT;
 
 
-class Error : public std::runtime_error
-{
-public:
-  using std::runtime_error::runtime_error;
-};
-struct Details
-{
-  ndn::Name serviceName;
-  ndn::Name applicationPrefix;
-  int serviceLifetime;
-  time_t publishTimestamp;
-  std::map<std::string, std::string> serviceMetaInfo;
-
-  // Function to decode an NDN Block into a Details object
-  static Details decode(const ndn::Block& block)
-  {
-    Details details;
-    if (block.type() != tlv::ServiceInfo) {
-      throw Error("Invalid TLV type");
-    }
-    block.parse();
-
-    for (const auto& element : block.elements()) {
-      switch (element.type()) {
-        case tlv::Name:
-          details.serviceName = ndn::Name(ndn::readString(element));
-          break;
-        case tlv::ApplicationPrefix:
-          details.applicationPrefix = ndn::Name(ndn::readString(element));
-          break;
-        case tlv::ServiceLifetime:
-          details.serviceLifetime = ndn::readNonNegativeInteger(element);
-          break;
-        case tlv::PublishTimestamp:
-          details.publishTimestamp = ndn::readNonNegativeInteger(element);
-          break;
-        case tlv::ServiceMetaInfo:
-          element.parse();
-          for (const auto& keyValueElement : element.elements()) {
-            keyValueElement.parse();
-            std::string key = ndn::readString(keyValueElement.get(tlv::Key));
-            std::string value = ndn::readString(keyValueElement.get(tlv::Value));
-            details.serviceMetaInfo[key] = value;
-          }
-          break;
-        default:
-          throw Error("Unknown TLV type");
-      }
-    }
-
-    return details;
-  }
-
-  // Function to encode a Details object into an NDN Block
-  ndn::Block encode() const
-  {
-    ndn::Block buffer(tlv::ServiceInfo);
+typedef std::function<void(const Details& serviceUpdates)> DiscoveryCallback;
 
-    if (!serviceName.empty()) {
-      buffer.push_back(ndn::makeStringBlock(tlv::Name, serviceName.toUri()));
-    }
-    if (!applicationPrefix.empty()) {
-      buffer.push_back(ndn::makeStringBlock(tlv::ApplicationPrefix, applicationPrefix.toUri()));
-    }
-    buffer.push_back(ndn::makeNonNegativeIntegerBlock(tlv::ServiceLifetime, serviceLifetime));
-    buffer.push_back(ndn::makeNonNegativeIntegerBlock(tlv::PublishTimestamp, publishTimestamp));
-    ndn::Block metaInfoBuffer(tlv::ServiceMetaInfo);
-    for (const auto& [key, value] : serviceMetaInfo) {
-      ndn::Block keyValuePair(tlv::KeyValuePair);
-      keyValuePair.push_back(ndn::makeStringBlock(tlv::Key, key));
-      keyValuePair.push_back(ndn::makeStringBlock(tlv::Value, value));
-      metaInfoBuffer.push_back(keyValuePair);
-    }
-    buffer.push_back(metaInfoBuffer);
-    buffer.encode();
-    return buffer;
-  }
+// details of the resolved service, nullopt on timeout
+typedef std::function<void(const std::optional<Details>& details)> ResolveCallback;
 
-  std::string toString() const
-  {
-    std::stringstream ss;
-    ss << "ServiceName: " << serviceName << "\n";
-    ss << "ApplicationPrefix: " << applicationPrefix << "\n";
-    ss << "ServiceLifetime: " << serviceLifetime << "\n";
-    ss << "PublishTimestamp: " << publishTimestamp << "\n";
-    ss << "ServiceMetaInfo: \n";
-    for (const auto& [key, value] : serviceMetaInfo) {
-      ss << key << ": " << value << "\n";
-    }
-    return ss.str();
-  }
+struct ServiceDiscoveryOptions
+{
+  // number of registry changes retained for changesSince()
+  size_t journalCapacity = ChangeJournal::DEFAULT_CAPACITY;
+  /**
+    directory of the persistent registry cache, empty to disable. With a warm cache the
+    received services are restored at startup and no discovery message is published. The
+    sync state is not cached, so the publications of the peers are still fetched again.
+    Updates are written to the cache in batches, at most 100 ms after they are received.
+  **/
+  std::string cacheDirectory;
+  // serviceMetaInfo keys read by selectProvider()
+  std::string weightKey = "weight";
+  std::string loadKey = "load";
+  /**
+    registry of the ndnsd_* metrics. ServiceDiscovery instances given the same one, like the
+    shards of a ServiceDiscoveryPool, add up in it; each creates its own if null.
+  **/
+  std::shared_ptr<Metrics> metrics;
+  /**
+    add this node to Details::hopTrace of every publication and lookup reply, and keep the
+    traces of the received services so that the lookups this node answers relay them
+  **/
+  bool traceHops = false;
+  /**
+    bytes the received services may take in the registry, 0 for no limit, see
+    ServiceRegistry::evict(); each shard of a ServiceDiscoveryPool has its own budget. With
+    cacheDirectory set, evicted services stay in the cache and resolve() or selectProvider()
+    bring them back when none of the providers asked for is in memory; without it they are
+    gone until published again.
+  **/
+  size_t memoryBudget = 0;
+  EvictionPolicy evictionPolicy = EvictionPolicy::LEAST_RECENTLY_USED;
+  // serviceMetaInfo key read by EvictionPolicy::LOWEST_PRIORITY
+  std::string priorityKey = "priority";
+  // services fetched in every group, all by default
+  SubscriptionFilter subscriptionFilter;
+  // delay before the changed services are summarized to the parent group, see aggregateInto()
+  ndn::time::milliseconds summaryInterval = 1_s;
+  // discovery messages received within this window of the previous one are not answered
+  ndn::time::milliseconds republishWindow = 5_s;
+  /**
+    replace republishWindow and summaryInterval at run time by the ones a ChurnController
+    picks within tuningBounds from the observed update, join and loss rates, and resync the
+    groups where fetches were late at most once per its sync interval. The decisions are
+    the ndnsd_*_interval_milliseconds and ndnsd_republish_window_milliseconds gauges.
+  **/
+  bool adaptiveTuning = false;
+  TuningBounds tuningBounds;
 };
 
 
-
-typedef std::function<void(const Details& serviceUpdates)> DiscoveryCallback;
-
-
 class ServiceDiscovery
 {
 
@@ -197,28 +155,343 @@ public:
     ; all the keys in required field needs to have value
     ; the details can have as many key-values are needed
 
-    @param servicegroupName The sync group that publishes the service info
+    @param servicegroupName The sync group that publishes the service info, more groups can
+           be joined with joinGroup()
     @param discoveryCallback
+    @param options tuning knobs, see ServiceDiscoveryOptions
   **/
   ServiceDiscovery(const ndn::Name& servicegroupName,
                     const ndn::Name& nodeName,
                     ndn::Face& face,
                     ndn::KeyChain& keyChain,
-                    const DiscoveryCallback& discoveryCallback);
+                    const DiscoveryCallback& discoveryCallback,
+                    const ServiceDiscoveryOptions& options = {});
   
 
   // destructor
   ~ServiceDiscovery();
 
+  /**
+    @brief join another service group on the same face
+
+    Services received in the group share the registry, indexes and change journal of the
+    primary group, scoped by the group name.
+
+    @param nodeName name of this node in the group
+    @param discoveryCallback called for services received in the group instead of the
+           constructor's callback, if set
+    @return false if the group is already joined
+  **/
+  bool
+  joinGroup(const ndn::Name& servicegroupName, const ndn::Name& nodeName,
+            const DiscoveryCallback& discoveryCallback = nullptr);
+
+  /**
+    @brief leave a group joined with joinGroup() and drop the services received in it
+    @return false if the group is not joined or is the primary group
+  **/
+  bool
+  leaveGroup(const ndn::Name& servicegroupName);
+
+  std::vector<ndn::Name>
+  getGroups() const;
+
+  /**
+    @brief summarize the services of the primary group in parentGroupName, joined if needed
+
+    This node becomes the aggregator of the primary group: instead of their details, it
+    publishes ServiceSummary digests of its services in the parent group, a complete one
+    first and then the changes, batched over summaryInterval, and answers the lookups that
+    resolve() sends for them. The summaries it receives in the primary group, from
+    aggregators below, are summarized too, so aggregators form a hierarchy in which each
+    group only holds its own members and one summary per subgroup.
+
+    @param nodeName name of this node in the parent group, to which lookups are routed
+    @return false if this node already aggregates or parentGroupName is the primary group
+  **/
+  bool
+  aggregateInto(const ndn::Name& parentGroupName, const ndn::Name& nodeName);
+
+  /**
+    @brief fetch only the publications that pass filter from now on, in every group
+
+    Services already received stay registered until their lease ends.
+  **/
+  void
+  setSubscriptionFilter(const SubscriptionFilter& filter);
+
+  const SubscriptionFilter&
+  getSubscriptionFilter() const
+  {
+    return m_subscriptionFilter;
+  }
+
+  /**
+    @brief publish details in the primary group
+  **/
   void
   publishServiceDetail(Details details);
 
+  /**
+    @brief publish details in a joined group
+    @return false if the group is not joined
+  **/
+  bool
+  publishServiceDetail(const ndn::Name& servicegroupName, const Details& details);
+
+  /**
+    @brief withdraw a service this node published in the primary group
+
+    The service is no longer republished and receivers drop it at once instead of when its
+    lease ends. Receivers keep the withdrawn version until that lease ends, so that copies of
+    it fetched late do not bring the service back; a later publication of the service gets
+    a newer publishTimestamp, even within the same second.
+
+    @return false if the service was not published by this node
+  **/
+  bool
+  withdrawServiceDetail(const ndn::Name& serviceName);
+
+  bool
+  withdrawServiceDetail(const ndn::Name& servicegroupName, const ndn::Name& serviceName);
+
+  /**
+    @brief report the load of a service this node published in the primary group
+
+    Much cheaper than publishing the details again: receivers update the registry entry in
+    place and, if heartbeat.lease is set, renew its lease. The renewed lease is kept in
+    Details::leaseEnd, publishTimestamp stays the version of the details, so that the later
+    answers to discovery messages are duplicates for the receivers. Heartbeats are not
+    recorded in the change journal nor in the registry cache.
+
+    @return false if the service was not published by this node
+  **/
+  bool
+  publishHeartbeat(const ndn::Name& serviceName, const Heartbeat& heartbeat);
+
+  bool
+  publishHeartbeat(const ndn::Name& servicegroupName, const ndn::Name& serviceName,
+                   const Heartbeat& heartbeat);
+
+  /**
+    @brief services received in the primary group
+    @note evicted services are not included, see ServiceDiscoveryOptions::memoryBudget
+  **/
   std::map<std::string, Details>
   getReceivedServiceDetails(){
-    return m_receivedDetails;
+    return m_registry.toMap();
   }
 
+  /**
+    @brief services received in a joined group
+  **/
+  std::map<std::string, Details>
+  getReceivedServiceDetails(const ndn::Name& servicegroupName) const;
+
+  const ServiceRegistry&
+  getRegistry() const
+  {
+    return m_registry;
+  }
+
+  /**
+    @brief counters and histograms of this instance, see ServiceDiscoveryOptions::metrics
+  **/
+  Metrics&
+  getMetrics()
+  {
+    return *m_metrics;
+  }
+
+  ServiceRegistry::MemoryUsage
+  getMemoryUsage() const
+  {
+    return m_registry.getMemoryUsage();
+  }
+
+  /**
+    @brief registry changes after cursor, see ChangeJournal
+
+    A consumer starts from getChangeCursor() taken together with getReceivedServiceDetails(),
+    and resyncs the same way whenever the returned batch isBehind.
+  **/
+  ChangeBatch
+  changesSince(uint64_t cursor, size_t limit = std::numeric_limits<size_t>::max()) const
+  {
+    return m_journal.changesSince(cursor, limit);
+  }
+
+  uint64_t
+  getChangeCursor() const
+  {
+    return m_journal.getLastSeqNo();
+  }
+
+  /**
+    @brief changes whenever the registry does, also for the heartbeats and lease renewals
+           that the change journal leaves out; for consumers that copy the whole registry,
+           such as the shared registry of the daemon
+  **/
+  uint64_t
+  getRegistryVersion() const
+  {
+    return m_journal.getLastSeqNo() + m_nUnjournaledChanges;
+  }
+
+  /**
+    @brief index a serviceMetaInfo key so that findServices() does not scan for it
+  **/
+  void
+  addAttributeIndex(const std::string& key, IndexType type)
+  {
+    m_registry.addIndex(key, type);
+  }
+
+  /**
+    @brief wait for a provider of serviceName in any group
+
+    The callback runs at once if a provider is already registered, otherwise as soon as
+    one is received or restored, or with nullopt after timeout. Pending resolutions are
+    indexed by serviceName and cost nothing to updates of other services.
+
+    Services that only a summary lists, see aggregateInto(), are looked up from the
+    aggregator, which forwards the lookup down the hierarchy if needed; the providers it
+    returns are registered as if received in the group of the summary.
+  **/
+  void
+  resolve(const ndn::Name& serviceName, ndn::time::milliseconds timeout,
+          const ResolveCallback& callback);
+
+  /**
+    @brief resolve() for threads other than the face's one
+    @note do not wait on the future from the face's thread, it would never be satisfied
+  **/
+  std::future<std::optional<Details>>
+  resolveFuture(const ndn::Name& serviceName, ndn::time::milliseconds timeout);
+
+#ifdef NDNSD_HAVE_COROUTINES
+  class ResolveAwaitable;
+
+  /**
+    @brief resolve() for coroutines running on the face's thread
+
+    @code
+      std::optional<Details> printer = co_await discovery.resolve("/printer", 5_s);
+    @endcode
+
+    A coroutine still waiting when the ServiceDiscovery is destroyed is never resumed.
+  **/
+  ResolveAwaitable
+  resolve(const ndn::Name& serviceName, ndn::time::milliseconds timeout);
+#endif // NDNSD_HAVE_COROUTINES
+
+  /**
+    @brief pick one of the providers of serviceName in any group, see SelectionPolicy
+    @return nullopt if no provider is registered
+  **/
+  std::optional<Details>
+  selectProvider(const ndn::Name& serviceName,
+                 SelectionPolicy policy = SelectionPolicy::ROUND_ROBIN);
+
+  /**
+    @brief received services matching every predicate of query, in all groups
+  **/
+  std::vector<Details>
+  findServices(const Query& query) const;
+
+  /**
+    @brief received services matching every predicate of query, in one group
+  **/
+  std::vector<Details>
+  findServices(const Query& query, const ndn::Name& servicegroupName) const;
+
 private:
+  struct Group
+  {
+    ndn::Name name;
+    ndn::Name nodeName;
+    // registry scope of the services received in the group, empty for the primary group
+    ndn::Name scope;
+    std::shared_ptr<ndn::svs::SVSPubSub> svsps;
+    // details published by this node, keyed by serviceName
+    std::map<std::string, Details> serviceDetails;
+    // version of the details withdrawn by this node, keyed by serviceName; a later
+    // publication of the service gets a newer one
+    std::map<std::string, time_t> withdrawnVersions;
+    ndn::time::steady_clock::time_point lastDiscoveryTime;
+    DiscoveryCallback discoveryCallback;
+    // service-info and heartbeat subscriptions of svsps
+    std::vector<uint32_t> subscriptions;
+    // summaries of the aggregators in the group
+    SummaryTable summaries;
+    // publications fetched late since the last resync, see adaptiveTuning
+    size_t nLateFetches = 0;
+    ndn::time::steady_clock::time_point lastResyncTime;
+  };
+
+  struct Aggregation
+  {
+    // group the summaries are published in
+    ndn::Name parentGroup;
+    // prefix of the lookups, under the name of this node in the parent group
+    ndn::Name lookupPrefix;
+    // of the last published summary
+    uint64_t generation = 0;
+    // summaries published since the last complete one
+    size_t nChanges = 0;
+    // entries as the parent group last received them
+    std::map<ndn::Name, SummaryEntry> published;
+    // services to summarize again, besides the ones in the journal after journalCursor
+    std::set<ndn::Name> changed;
+    uint64_t journalCursor = 0;
+    bool isScheduled = false;
+    ndn::scheduler::ScopedEventId summaryEvent;
+    ndn::ScopedRegisteredPrefixHandle lookupFilter;
+    // lookups forwarded to the aggregators below, by name of the received lookup
+    std::map<ndn::Name, ndn::ScopedPendingInterestHandle> forwarded;
+  };
+
+  Group&
+  addGroup(const ndn::Name& servicegroupName, const ndn::Name& nodeName, const ndn::Name& scope,
+           const DiscoveryCallback& discoveryCallback);
+
+  // subscribe group to the publications that pass m_subscriptionFilter
+  void
+  subscribe(Group& group);
+
+  const Group*
+  findGroup(const ndn::Name& servicegroupName) const;
+
+  const Group*
+  findGroupByScope(const ndn::Name& scope) const;
+
+  // a resync is answered even within the republish window
+  void
+  publishDiscovery(Group& group, bool isResync = false);
+
+  void
+  publish(Group& group, const Details& details);
+
+  // register details received in group and report them, unless their version was withdrawn
+  void
+  registerService(Group& group, const Details& details);
+
+  // drop the service withdrawn by details from group, unless a newer one is registered, and
+  // keep its version so that the withdrawn details fetched late are not registered again
+  void
+  unregisterService(Group& group, const Details& details);
+
+  void
+  reportService(const Details& details, const ndn::Name& scope);
+
+  // a registered provider of serviceName, recovered from the cache if evicted, nullopt if none
+  std::optional<Details>
+  findProvider(const ndn::Name& serviceName);
+
+  void
+  addWaiter(const ndn::Name& serviceName, ndn::time::milliseconds timeout,
+            const ResolveCallback& callback);
+
   void
   run();
 
@@ -230,10 +503,81 @@ private:
   stop();
 
   void
-  OnServiceUpdate(const ndn::svs::SVSPubSub::SubscriptionData &subscription);
+  OnSyncUpdate(const std::vector<ndn::svs::MissingDataInfo>& missingData);
+
+  void
+  OnServiceUpdate(Group& group, const ndn::svs::SVSPubSub::SubscriptionData &subscription);
+
+  void
+  OnServiceDiscovery(Group& group, const ndn::svs::SVSPubSub::SubscriptionData &subscription);
 
   void
-  OnServiceDiscovery(const ndn::svs::SVSPubSub::SubscriptionData &subscription);
+  OnHeartbeat(Group& group, const ndn::svs::SVSPubSub::SubscriptionData &subscription);
+
+  void
+  OnSummary(Group& group, const ndn::svs::SVSPubSub::SubscriptionData &subscription);
+
+  // services of the primary group whose summary may have changed
+  void
+  summaryChanged(const std::vector<ndn::Name>& serviceNames);
+
+  void
+  scheduleSummary();
+
+  // publish the services changed since the last summary, or all of them if isComplete
+  void
+  publishSummary(bool isComplete);
+
+  // serviceName as this node reaches it in the primary group
+  SummaryEntry
+  summarizeService(const ndn::Name& serviceName) const;
+
+  // ask an aggregator that summarizes serviceName for its providers, false if none does
+  bool
+  lookUp(const ndn::Name& serviceName);
+
+  void
+  onLookup(const ndn::Interest& interest);
+
+  void
+  replyLookup(const ndn::Name& name, const ndn::Block& content);
+
+  // content of a lookup reply, with this node appended to the trace of each service
+  ndn::Block
+  appendHop(const ndn::Block& content) const;
+
+  // drop received services whose lease has ended
+  void
+  expireServices();
+
+  // adopt the decisions of m_churnController and resync the groups with late fetches
+  void
+  tune();
+
+  // set the intervals and their gauges, 0 for the sync interval if there are no resyncs
+  void
+  setIntervals(ndn::time::milliseconds republishWindow, ndn::time::milliseconds summaryInterval,
+               ndn::time::milliseconds syncInterval);
+
+  // load the registry cache, returns the number of restored services
+  size_t
+  restoreServices(const std::string& cacheDirectory);
+
+  // keep the registry within its memory budget and report its size
+  void
+  evictServices();
+
+  // bring the evicted providers of serviceName back from the cache, false if there were none
+  bool
+  recoverServices(const ndn::Name& serviceName);
+
+  // write the buffered cache records from the event loop, once per burst of updates
+  void
+  scheduleCacheFlush();
+
+  // compact the cache, keeping the evicted services that can still be recovered
+  void
+  compactCache();
 
 public:
   uint8_t m_appType;
@@ -242,23 +586,154 @@ public:
 private:
   ndn::Face& m_face;
   ndn::KeyChain& m_keyChain;
-  std::shared_ptr<ndn::svs::SVSPubSub> m_svsps;
+  ndn::Scheduler m_scheduler;
 
   const std::string m_filename;
   ServiceInfoFileProcessor m_fileProcessor;
   ndn::Name m_servicegroupName;
   ndn::Name m_nodeName;
 
-  // cache the details in a map
-  std::map<std::string, Details> m_serviceDetails;
+  // joined groups, including the primary one
+  std::map<ndn::Name, Group> m_groups;
 
-  // cache recevied details in a map
-  std::map<std::string, Details> m_receivedDetails;
+  // received details of all groups, keyed by scope + applicationPrefix + serviceName
+  ServiceRegistry m_registry;
+  ChangeJournal m_journal;
+  ProviderSelector m_selector;
+  std::unique_ptr<RegistryCache> m_cache;
+  ndn::scheduler::ScopedEventId m_cacheFlushEvent;
+  bool m_isCacheFlushScheduled = false;
+  ndn::scheduler::ScopedEventId m_expiryEvent;
 
   DiscoveryCallback m_discoveryCallback;
 
-  ndn::time::steady_clock::time_point m_lastDiscoveryTime;
+  struct Instruments
+  {
+    explicit
+    Instruments(Metrics& metrics);
+
+    Counter& nPublished;
+    Counter& nUpdates;
+    Counter& nDecodeFailures;
+    Counter& nSuppressedResponses;
+    Counter& nBytesIn;
+    Counter& nBytesOut;
+    Counter& nEvictions;
+    Counter& nRecoveries;
+    Counter& nSummaries;
+    Counter& nLookups;
+    Counter& nLookupsServed;
+    Counter& nTuningChanges;
+    Counter& nResyncs;
+    // accounted registry bytes, see ServiceRegistry::getAccountedBytes()
+    Gauge& registryBytes;
+    // intervals in use, see setIntervals()
+    Gauge& republishWindow;
+    Gauge& summaryInterval;
+    Gauge& syncInterval;
+    // stages of the update latency: publication to sync notification, then data fetch,
+    // decode and callbacks
+    Histogram& syncTime;
+    Histogram& fetchTime;
+    Histogram& decodeTime;
+    Histogram& callbackTime;
+    Histogram& updateLatency;
+  };
+  std::shared_ptr<Metrics> m_metrics;
+  Instruments m_instruments;
+  bool m_traceHops;
+  struct ReceivedTrace
+  {
+    time_t publishTimestamp;
+    std::vector<Hop> hops;
+  };
+  // hop traces of the services received in the primary group, by applicationPrefix then
+  // serviceName, kept if m_traceHops
+  std::map<std::pair<ndn::Name, ndn::Name>, ReceivedTrace> m_receivedTraces;
+  struct Withdrawal
+  {
+    // publishTimestamp of the withdrawn details, older or equal ones are dropped
+    time_t version;
+    // when the withdrawn lease ends, the withdrawal is forgotten then
+    time_t expiry;
+  };
+  // withdrawn services by scope then registry key
+  std::map<std::pair<ndn::Name, ndn::Name>, Withdrawal> m_withdrawals;
+  SubscriptionFilter m_subscriptionFilter;
+  ndn::time::milliseconds m_summaryInterval;
+  ndn::time::milliseconds m_republishWindow;
+  // least time between two resyncs of a group, 0 for none
+  ndn::time::milliseconds m_syncInterval;
+  // set if ServiceDiscoveryOptions::adaptiveTuning
+  std::unique_ptr<ChurnController> m_churnController;
+  ndn::scheduler::ScopedEventId m_tuningEvent;
+  // set by aggregateInto()
+  std::unique_ptr<Aggregation> m_aggregation;
+  // lookups sent to aggregators, by serviceName
+  std::map<ndn::Name, ndn::ScopedPendingInterestHandle> m_lookups;
+
+  // when sync learned of publications not fetched yet, by producer then last sequence number
+  std::map<ndn::Name, std::map<ndn::svs::SeqNo, ndn::time::system_clock::time_point>> m_notified;
+
+  struct Waiter
+  {
+    ResolveCallback callback;
+    ndn::scheduler::ScopedEventId timeoutEvent;
+  };
+  // pending resolve() calls by serviceName, then by id
+  std::map<ndn::Name, std::map<uint64_t, Waiter>> m_waiters;
+  uint64_t m_lastWaiterId = 0;
+
+  // serviceNames with providers evicted to the cache, to the last end of their leases
+  std::map<ndn::Name, time_t> m_evictedServices;
+  // registry bytes added to Instruments::registryBytes
+  size_t m_reportedBytes = 0;
+  // registry changes not in m_journal, see getRegistryVersion()
+  uint64_t m_nUnjournaledChanges = 0;
+};
+
+#ifdef NDNSD_HAVE_COROUTINES
+class ServiceDiscovery::ResolveAwaitable
+{
+public:
+  ResolveAwaitable(ServiceDiscovery& discovery, const ndn::Name& serviceName,
+                   ndn::time::milliseconds timeout)
+    : m_discovery(discovery)
+    , m_serviceName(serviceName)
+    , m_timeout(timeout)
+  {
+  }
+
+  bool
+  await_ready()
+  {
+    m_result = m_discovery.findProvider(m_serviceName);
+    return m_result.has_value();
+  }
+
+  void
+  await_suspend(std::coroutine_handle<> handle)
+  {
+    m_discovery.addWaiter(m_serviceName, m_timeout,
+                          [this, handle] (const std::optional<Details>& details) {
+                            m_result = details;
+                            handle.resume();
+                          });
+  }
+
+  std::optional<Details>
+  await_resume()
+  {
+    return std::move(m_result);
+  }
+
+private:
+  ServiceDiscovery& m_discovery;
+  ndn::Name m_serviceName;
+  ndn::time::milliseconds m_timeout;
+  std::optional<Details> m_result;
 };
+#endif // NDNSD_HAVE_COROUTINES
 
 } //namespace discovery
 } //namespace ndnsd
@@ -0,0 +1,585 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "service-registry.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <new>
+
+namespace ndnsd {
+namespace discovery {
+
+// rough per-node overhead of node based std containers (links + hash/colour)
+static constexpr size_t NODE_OVERHEAD = 2 * sizeof(void*);
+
+static size_t
+estimateNameBytes(const ndn::Name& name)
+{
+  return name.wireEncode().size() + name.size() * sizeof(ndn::Name::Component);
+}
+
+// pool node of an interned name or value
+static size_t
+getPooledBytes(const ndn::Name& name)
+{
+  return sizeof(std::pair<const ndn::Name, uint64_t>) + NODE_OVERHEAD + estimateNameBytes(name);
+}
+
+static size_t
+getPooledBytes(const std::string& value)
+{
+  // strings of up to 15 characters are stored inline
+  return sizeof(std::pair<const std::string, uint64_t>) + NODE_OVERHEAD +
+         (value.capacity() > 15 ? value.capacity() + 1 : 0);
+}
+
+ServiceRegistry::~ServiceRegistry()
+{
+  for (auto& entry : m_entries) {
+    releaseMeta(entry);
+  }
+}
+
+ServiceRegistry::InsertResult
+ServiceRegistry::insert(const Details& details, const ndn::Name& scope)
+{
+  NamePool::Handle scopeHandle = scope.empty() ? NamePool::Handle() : m_names.intern(scope);
+  NamePool::Handle applicationPrefix = m_names.intern(details.applicationPrefix);
+  NamePool::Handle serviceName = m_names.intern(details.serviceName);
+  std::vector<MetaItem> meta = makeMeta(details.serviceMetaInfo);
+
+  auto [it, isNew] = m_index.try_emplace(EntryKey{scopeHandle.identity(),
+                                                  applicationPrefix.identity(),
+                                                  serviceName.identity()},
+                                         INVALID_ENTRY);
+  if (isNew) {
+    if (!m_freeEntries.empty()) {
+      it->second = m_freeEntries.back();
+      m_freeEntries.pop_back();
+    }
+    else {
+      it->second = static_cast<EntryId>(m_entries.size());
+      m_entries.emplace_back();
+    }
+  }
+
+  EntryId id = it->second;
+  if (isNew) {
+    m_providers[serviceName.identity()].push_back(id);
+  }
+  Entry& entry = m_entries[id];
+  if (!isNew && entry.serviceLifetime == details.serviceLifetime &&
+      entry.publishTimestamp == details.publishTimestamp && isSameMeta(entry, meta)) {
+    // a republication carrying a lease renewed since
+    bool isRenewed = static_cast<time_t>(details.leaseEnd) > entry.leaseEnd;
+    if (isRenewed) {
+      entry.leaseEnd = static_cast<time_t>(details.leaseEnd);
+      setExpiry(id);
+      setEvictionRank(id);
+    }
+    return {id, false, true, isRenewed};
+  }
+
+  if (!isNew) {
+    m_attributeIndex.remove(id, *this);
+  }
+  entry.scope = std::move(scopeHandle);
+  entry.serviceName = std::move(serviceName);
+  entry.applicationPrefix = std::move(applicationPrefix);
+  entry.serviceLifetime = details.serviceLifetime;
+  entry.publishTimestamp = details.publishTimestamp;
+  entry.leaseEnd = static_cast<time_t>(details.leaseEnd);
+  entry.inUse = true;
+
+  releaseMeta(entry);
+  storeMeta(entry, std::move(meta));
+  setExpiry(id);
+  m_attributeIndex.insert(id, *this);
+  if (m_columns) {
+    m_columns->update(id, *this);
+  }
+
+  updateEntryBytes(entry);
+  touch(id);
+  setEvictionRank(id);
+
+  return {id, isNew, false, false};
+}
+
+bool
+ServiceRegistry::erase(const ndn::Name& applicationPrefix, const ndn::Name& serviceName,
+                       const ndn::Name& scope)
+{
+  EntryId id = find(applicationPrefix, serviceName, scope);
+  if (id == INVALID_ENTRY) {
+    return false;
+  }
+  erase(id);
+  return true;
+}
+
+void
+ServiceRegistry::erase(EntryId id)
+{
+  Entry& entry = m_entries[id];
+  m_attributeIndex.remove(id, *this);
+  unlinkRecency(id);
+  clearEvictionRank(id);
+  m_accountedBytes -= entry.bytes;
+  if (entry.hasExpiry) {
+    m_expiryQueue.erase(entry.expiry);
+  }
+  releaseMeta(entry);
+  m_index.erase(EntryKey{entry.scope.identity(), entry.applicationPrefix.identity(),
+                         entry.serviceName.identity()});
+  auto providers = m_providers.find(entry.serviceName.identity());
+  auto& ids = providers->second;
+  *std::find(ids.begin(), ids.end(), id) = ids.back();
+  ids.pop_back();
+  if (ids.empty()) {
+    m_providers.erase(providers);
+  }
+  entry = Entry();
+  m_freeEntries.push_back(id);
+  if (m_columns) {
+    m_columns->clear(id);
+  }
+}
+
+void
+ServiceRegistry::applyHeartbeat(EntryId id, const Heartbeat& heartbeat, time_t now)
+{
+  Entry& entry = m_entries[id];
+  entry.load = heartbeat.load;
+  entry.queueDepth = heartbeat.queueDepth;
+  entry.hasHeartbeat = true;
+  if (heartbeat.lease == 0) {
+    return;
+  }
+  entry.leaseEnd = now + static_cast<time_t>(heartbeat.lease);
+  setExpiry(id);
+  setEvictionRank(id);
+}
+
+size_t
+ServiceRegistry::expire(time_t now, const EntryVisitor& onExpire)
+{
+  size_t nExpired = 0;
+  while (!m_expiryQueue.empty() && m_expiryQueue.begin()->first <= now) {
+    EntryId id = m_expiryQueue.begin()->second;
+    if (onExpire) {
+      onExpire(id);
+    }
+    erase(id);
+    ++nExpired;
+  }
+  return nExpired;
+}
+
+ServiceRegistry::EntryId
+ServiceRegistry::find(const ndn::Name& applicationPrefix, const ndn::Name& serviceName,
+                      const ndn::Name& scope) const
+{
+  // names that are not pooled cannot be registered
+  NamePool::Handle scopeHandle = scope.empty() ? NamePool::Handle() : m_names.find(scope);
+  NamePool::Handle prefixHandle = m_names.find(applicationPrefix);
+  NamePool::Handle nameHandle = m_names.find(serviceName);
+  if (!prefixHandle || !nameHandle || (!scope.empty() && !scopeHandle)) {
+    return INVALID_ENTRY;
+  }
+  auto it = m_index.find(EntryKey{scopeHandle.identity(), prefixHandle.identity(),
+                                  nameHandle.identity()});
+  return it == m_index.end() ? INVALID_ENTRY : it->second;
+}
+
+const std::vector<ServiceRegistry::EntryId>&
+ServiceRegistry::getProviders(const ndn::Name& serviceName) const
+{
+  static const std::vector<EntryId> NONE;
+  NamePool::Handle nameHandle = m_names.find(serviceName);
+  if (!nameHandle) {
+    return NONE;
+  }
+  auto it = m_providers.find(nameHandle.identity());
+  return it == m_providers.end() ? NONE : it->second;
+}
+
+Details
+ServiceRegistry::get(EntryId id) const
+{
+  const Entry& entry = m_entries[id];
+  Details details;
+  details.serviceName = *entry.serviceName;
+  details.applicationPrefix = *entry.applicationPrefix;
+  details.serviceLifetime = entry.serviceLifetime;
+  details.publishTimestamp = entry.publishTimestamp;
+  details.leaseEnd = static_cast<uint64_t>(entry.leaseEnd);
+
+  const MetaItem* items = getMetaItems(entry);
+  for (uint32_t i = 0; i < entry.metaCount; ++i) {
+    details.serviceMetaInfo.emplace(m_keys[items[i].key], *items[i].value);
+  }
+  return details;
+}
+
+std::optional<std::string_view>
+ServiceRegistry::getMetaValue(EntryId id, std::string_view key) const
+{
+  const MetaItem* item = findMetaItem(m_entries[id], key);
+  if (item == nullptr) {
+    return std::nullopt;
+  }
+  return std::string_view(*item->value);
+}
+
+ServiceRegistry::StringPool::Handle
+ServiceRegistry::getMetaValueHandle(EntryId id, std::string_view key) const
+{
+  const MetaItem* item = findMetaItem(m_entries[id], key);
+  return item == nullptr ? StringPool::Handle() : item->value;
+}
+
+std::optional<uint32_t>
+ServiceRegistry::findKeyId(std::string_view key) const
+{
+  auto it = m_keyIds.find(key);
+  if (it == m_keyIds.end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void
+ServiceRegistry::enableColumns(std::vector<std::string> metaKeys)
+{
+  m_columns = std::make_unique<RegistryColumns>(std::move(metaKeys));
+  for (EntryId id = 0; id < m_entries.size(); ++id) {
+    if (m_entries[id].inUse) {
+      m_columns->update(id, *this);
+    }
+    else {
+      m_columns->clear(id);
+    }
+  }
+}
+
+void
+ServiceRegistry::forEach(const EntryVisitor& visitor) const
+{
+  for (EntryId id = 0; id < m_entries.size(); ++id) {
+    if (m_entries[id].inUse) {
+      visitor(id);
+    }
+  }
+}
+
+std::map<std::string, Details>
+ServiceRegistry::toMap(const ndn::Name& scope) const
+{
+  std::map<std::string, Details> map;
+  for (const auto& [key, id] : m_index) {
+    const Entry& entry = m_entries[id];
+    if (getScope(id) != scope) {
+      continue;
+    }
+    map.emplace(makeKey(*entry.applicationPrefix, *entry.serviceName).toUri(), get(id));
+  }
+  return map;
+}
+
+ServiceRegistry::MemoryUsage
+ServiceRegistry::getMemoryUsage() const
+{
+  MemoryUsage usage;
+  usage.entryCount = size();
+  usage.entryBytes = m_entries.capacity() * sizeof(Entry) +
+                     m_freeEntries.capacity() * sizeof(EntryId);
+  m_names.forEach([&] (const ndn::Name& name, uint32_t) {
+    usage.nameBytes += getPooledBytes(name);
+  });
+  usage.nameBytes += m_names.bucket_count() * sizeof(void*);
+  m_strings.forEach([&] (const std::string& value, uint32_t) {
+    usage.valueBytes += getPooledBytes(value);
+  });
+  usage.valueBytes += m_strings.bucket_count() * sizeof(void*);
+  usage.metaBytesInUse = m_arena.getBytesInUse();
+  usage.metaBytesReserved = m_arena.getBytesReserved();
+  for (const auto& key : m_keys) {
+    // the string is held twice, in m_keys and as the m_keyIds key
+    usage.keyTableBytes += 2 * key.capacity() + sizeof(std::string) +
+                           sizeof(std::pair<const std::string, uint32_t>) + NODE_OVERHEAD;
+  }
+  usage.indexBytes = m_index.bucket_count() * sizeof(void*) +
+                     m_index.size() * (sizeof(std::pair<const EntryKey, EntryId>) + NODE_OVERHEAD) +
+                     m_expiryQueue.size() * (sizeof(std::pair<const time_t, EntryId>) + 2 * NODE_OVERHEAD) +
+                     m_providers.bucket_count() * sizeof(void*) +
+                     m_providers.size() * (sizeof(std::pair<const void*, std::vector<EntryId>>) + NODE_OVERHEAD) +
+                     m_index.size() * sizeof(EntryId) +
+                     m_attributeIndex.getMemoryUsage() +
+                     (m_columns ? m_columns->getMemoryUsage() : 0);
+  usage.accountedBytes = getAccountedBytes();
+  usage.budgetBytes = m_budget;
+  return usage;
+}
+
+void
+ServiceRegistry::setMemoryBudget(size_t bytes, EvictionPolicy policy,
+                                 const std::string& priorityKey)
+{
+  m_budget = bytes;
+  m_evictionPolicy = policy;
+  m_priorityKey = priorityKey;
+  m_evictionOrder.clear();
+  forEach([this] (EntryId id) { setEvictionRank(id); });
+}
+
+void
+ServiceRegistry::touch(EntryId id) const
+{
+  if (m_mostRecent == id) {
+    return;
+  }
+  unlinkRecency(id);
+  const Entry& entry = m_entries[id];
+  entry.lessRecent = m_mostRecent;
+  if (m_mostRecent != INVALID_ENTRY) {
+    m_entries[m_mostRecent].moreRecent = id;
+  }
+  else {
+    m_leastRecent = id;
+  }
+  m_mostRecent = id;
+}
+
+size_t
+ServiceRegistry::evict(const EntryVisitor& onEvict)
+{
+  if (m_budget == 0) {
+    return 0;
+  }
+  if (getAccountedBytes() > m_budget) {
+    m_arena.trim();
+  }
+  // an evicted block may stay reserved, but the rest of the entry's charge always goes
+  size_t nEvicted = 0;
+  while (getAccountedBytes() > m_budget && !m_index.empty()) {
+    EntryId id = m_evictionPolicy == EvictionPolicy::LEAST_RECENTLY_USED ?
+                 m_leastRecent : m_evictionOrder.begin()->second;
+    if (onEvict) {
+      onEvict(id);
+    }
+    erase(id);
+    ++nEvicted;
+  }
+  m_nEvicted += nEvicted;
+  return nEvicted;
+}
+
+uint32_t
+ServiceRegistry::internKey(const std::string& key)
+{
+  auto it = m_keyIds.find(key);
+  if (it != m_keyIds.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(m_keys.size());
+  m_keys.push_back(key);
+  m_keyIds.emplace(key, id);
+  return id;
+}
+
+std::vector<ServiceRegistry::MetaItem>
+ServiceRegistry::makeMeta(const std::map<std::string, std::string>& metaInfo)
+{
+  std::vector<MetaItem> items;
+  items.reserve(metaInfo.size());
+  for (const auto& [key, value] : metaInfo) {
+    items.push_back(MetaItem{internKey(key), m_strings.intern(value)});
+  }
+  // key ids follow first-seen order, not string order
+  std::sort(items.begin(), items.end(),
+            [] (const MetaItem& a, const MetaItem& b) { return a.key < b.key; });
+  return items;
+}
+
+bool
+ServiceRegistry::isSameMeta(const Entry& entry, const std::vector<MetaItem>& items) const
+{
+  if (entry.metaCount != items.size()) {
+    return false;
+  }
+  const MetaItem* stored = getMetaItems(entry);
+  for (uint32_t i = 0; i < entry.metaCount; ++i) {
+    if (stored[i].key != items[i].key || stored[i].value != items[i].value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+ServiceRegistry::storeMeta(Entry& entry, std::vector<MetaItem>&& items)
+{
+  entry.metaCount = static_cast<uint32_t>(items.size());
+  entry.meta = m_arena.allocate(entry.metaCount * sizeof(MetaItem));
+  MetaItem* stored = getMetaItems(entry);
+  for (uint32_t i = 0; i < entry.metaCount; ++i) {
+    new (&stored[i]) MetaItem(std::move(items[i]));
+  }
+}
+
+void
+ServiceRegistry::releaseMeta(Entry& entry)
+{
+  if (!entry.meta.isValid()) {
+    return;
+  }
+  MetaItem* stored = getMetaItems(entry);
+  for (uint32_t i = 0; i < entry.metaCount; ++i) {
+    stored[i].~MetaItem();
+  }
+  m_arena.deallocate(entry.meta);
+  entry.meta = SlabArena::Ref();
+  entry.metaCount = 0;
+}
+
+const ServiceRegistry::MetaItem*
+ServiceRegistry::findMetaItem(const Entry& entry, std::string_view key) const
+{
+  auto keyIt = m_keyIds.find(key);
+  if (keyIt == m_keyIds.end()) {
+    return nullptr;
+  }
+  const MetaItem* begin = getMetaItems(entry);
+  const MetaItem* end = begin + entry.metaCount;
+  const MetaItem* item = std::lower_bound(begin, end, keyIt->second,
+                                          [] (const MetaItem& i, uint32_t k) { return i.key < k; });
+  if (item == end || item->key != keyIt->second) {
+    return nullptr;
+  }
+  return item;
+}
+
+size_t
+ServiceRegistry::computeEntryBytes(const Entry& entry) const
+{
+  // slot, lookup index node and bucket, serviceName index slot
+  size_t bytes = sizeof(Entry) + sizeof(std::pair<const EntryKey, EntryId>) + NODE_OVERHEAD +
+                 sizeof(void*) + sizeof(EntryId);
+  if (entry.hasExpiry) {
+    bytes += sizeof(std::pair<const time_t, EntryId>) + 2 * NODE_OVERHEAD;
+  }
+  if (entry.scope) {
+    bytes += getPooledBytes(*entry.scope);
+  }
+  bytes += getPooledBytes(*entry.serviceName) + getPooledBytes(*entry.applicationPrefix);
+  if (entry.meta.isValid()) {
+    bytes += entry.meta.size;
+  }
+  const MetaItem* items = getMetaItems(entry);
+  for (uint32_t i = 0; i < entry.metaCount; ++i) {
+    bytes += getPooledBytes(*items[i].value);
+  }
+  return bytes;
+}
+
+void
+ServiceRegistry::updateEntryBytes(Entry& entry)
+{
+  m_accountedBytes -= entry.bytes;
+  entry.bytes = static_cast<uint32_t>(computeEntryBytes(entry));
+  m_accountedBytes += entry.bytes;
+}
+
+void
+ServiceRegistry::unlinkRecency(EntryId id) const
+{
+  const Entry& entry = m_entries[id];
+  if (entry.lessRecent != INVALID_ENTRY) {
+    m_entries[entry.lessRecent].moreRecent = entry.moreRecent;
+  }
+  else if (m_leastRecent == id) {
+    m_leastRecent = entry.moreRecent;
+  }
+  else {
+    // not linked
+    return;
+  }
+  if (entry.moreRecent != INVALID_ENTRY) {
+    m_entries[entry.moreRecent].lessRecent = entry.lessRecent;
+  }
+  else {
+    m_mostRecent = entry.lessRecent;
+  }
+  entry.lessRecent = INVALID_ENTRY;
+  entry.moreRecent = INVALID_ENTRY;
+}
+
+void
+ServiceRegistry::setEvictionRank(EntryId id)
+{
+  clearEvictionRank(id);
+  if (m_budget == 0 || m_evictionPolicy == EvictionPolicy::LEAST_RECENTLY_USED) {
+    return;
+  }
+
+  Entry& entry = m_entries[id];
+  int64_t rank = 0;
+  if (m_evictionPolicy == EvictionPolicy::LOWEST_PRIORITY) {
+    auto priority = getMetaValue(id, m_priorityKey);
+    if (priority) {
+      auto result = std::from_chars(priority->data(), priority->data() + priority->size(), rank);
+      if (result.ec != std::errc() || result.ptr != priority->data() + priority->size()) {
+        rank = 0;
+      }
+    }
+  }
+  else {
+    rank = entry.hasExpiry ? -static_cast<int64_t>(entry.expiry->first)
+                           : std::numeric_limits<int64_t>::min();
+  }
+  entry.evictionRank = rank;
+  m_evictionOrder.emplace(rank, id);
+}
+
+void
+ServiceRegistry::clearEvictionRank(EntryId id)
+{
+  m_evictionOrder.erase({m_entries[id].evictionRank, id});
+}
+
+void
+ServiceRegistry::setExpiry(EntryId id)
+{
+  Entry& entry = m_entries[id];
+  if (entry.hasExpiry) {
+    m_expiryQueue.erase(entry.expiry);
+    entry.hasExpiry = false;
+  }
+  time_t leaseEnd = computeLeaseEnd(entry);
+  if (leaseEnd != 0) {
+    entry.expiry = m_expiryQueue.emplace(leaseEnd, id);
+    entry.hasExpiry = true;
+  }
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,564 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SERVICE_REGISTRY_HPP
+#define NDNSD_SERVICE_REGISTRY_HPP
+
+#include "attribute-index.hpp"
+#include "details.hpp"
+#include "heartbeat.hpp"
+#include "intern-pool.hpp"
+#include "registry-columns.hpp"
+#include "slab-arena.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+// which entries go first when the registry is over its memory budget
+enum class EvictionPolicy : uint8_t {
+  // the entry returned by a lookup the longest time ago, see ServiceRegistry::touch()
+  LEAST_RECENTLY_USED,
+  // the entry with the lowest priority metadata, 0 if absent or not an integer
+  LOWEST_PRIORITY,
+  // the entry whose lease ends last, entries that never expire first
+  FARTHEST_EXPIRY,
+};
+
+/**
+  @brief Registry of received service details.
+
+  Entries live in a slot vector addressed by EntryId. serviceMetaInfo is not kept as a
+  std::map: each entry owns one arena block holding a key-sorted array of
+  (key id, value handle), keys are interned in a per-registry table, and names and
+  metadata values are interned in pools shared by all entries. Comparing two names or two
+  values of the registry is therefore a pointer comparison. Entries whose lease
+  (publishTimestamp + serviceLifetime, or the end a heartbeat renewed it to) has passed are
+  removed by expire().
+
+  Every entry belongs to a scope, a name such as the service group it was received in; the
+  same service registered in two scopes is two entries. The default scope is the empty
+  name.
+
+  Each entry is charged the bytes it takes: its slot, index nodes, metadata block and the
+  pooled names and values it refers to. Shared names and values are charged to every entry
+  using them, so the total is an upper bound. The metadata arena memory that holds no live
+  block, free blocks and slab tails, is added to the total: an entry pinning a slab costs
+  the registry more than its block. With a memory budget, evict() removes entries in the
+  order of the EvictionPolicy until the total fits in it.
+**/
+class ServiceRegistry
+{
+public:
+  using EntryId = uint32_t;
+  static constexpr EntryId INVALID_ENTRY = UINT32_MAX;
+
+  using NamePool = InternPool<ndn::Name>;
+  using StringPool = InternPool<std::string>;
+
+  struct InsertResult
+  {
+    EntryId id;
+    bool isNew;
+    // identical to the stored entry, including publishTimestamp; a later leaseEnd of a
+    // duplicate still renews the lease
+    bool isDuplicate;
+    // a duplicate that renewed the lease
+    bool isRenewed;
+  };
+
+  struct MemoryUsage
+  {
+    size_t entryCount = 0;
+    // slot vector, including free slots
+    size_t entryBytes = 0;
+    // interned names and metadata values, each unique value counted once
+    size_t nameBytes = 0;
+    size_t valueBytes = 0;
+    size_t metaBytesInUse = 0;
+    size_t metaBytesReserved = 0;
+    size_t keyTableBytes = 0;
+    // lookup and expiry indexes
+    size_t indexBytes = 0;
+    // sum of the per-entry charges and arena fragmentation compared to the budget
+    size_t accountedBytes = 0;
+    size_t budgetBytes = 0;
+
+    size_t
+    getTotalBytes() const
+    {
+      return entryBytes + nameBytes + valueBytes + metaBytesReserved + keyTableBytes +
+             indexBytes;
+    }
+
+    size_t
+    getBytesPerEntry() const
+    {
+      return entryCount == 0 ? 0 : getTotalBytes() / entryCount;
+    }
+
+    // fraction of the reserved metadata arena that holds no live metadata
+    double
+    getMetaFragmentation() const
+    {
+      return metaBytesReserved == 0 ? 0 :
+             static_cast<double>(metaBytesReserved - metaBytesInUse) / metaBytesReserved;
+    }
+  };
+
+  using EntryVisitor = std::function<void(EntryId)>;
+
+  ServiceRegistry() = default;
+  ServiceRegistry(const ServiceRegistry&) = delete;
+  ServiceRegistry& operator=(const ServiceRegistry&) = delete;
+
+  ~ServiceRegistry();
+
+  /**
+    @brief key under which a service is registered, applicationPrefix + serviceName
+  **/
+  static ndn::Name
+  makeKey(const ndn::Name& applicationPrefix, const ndn::Name& serviceName)
+  {
+    return ndn::Name(applicationPrefix).append(serviceName);
+  }
+
+  /**
+    @brief insert or replace the entry for details in scope
+  **/
+  InsertResult
+  insert(const Details& details, const ndn::Name& scope = ndn::Name());
+
+  bool
+  erase(const ndn::Name& applicationPrefix, const ndn::Name& serviceName,
+        const ndn::Name& scope = ndn::Name());
+
+  void
+  erase(EntryId id);
+
+  /**
+    @brief remove all entries whose lease ended at or before now
+    @param onExpire called for each entry right before it is removed
+    @return number of removed entries
+  **/
+  size_t
+  expire(time_t now, const EntryVisitor& onExpire = nullptr);
+
+  EntryId
+  find(const ndn::Name& applicationPrefix, const ndn::Name& serviceName,
+       const ndn::Name& scope = ndn::Name()) const;
+
+  size_t
+  size() const
+  {
+    return m_index.size();
+  }
+
+  /**
+    @brief entries registered under serviceName, one per scope and applicationPrefix, in no
+           particular order
+    @note the reference is invalidated by insert() and erase()
+  **/
+  const std::vector<EntryId>&
+  getProviders(const ndn::Name& serviceName) const;
+
+  /**
+    @brief materialize an entry as Details
+  **/
+  Details
+  get(EntryId id) const;
+
+  const ndn::Name&
+  getServiceName(EntryId id) const
+  {
+    return *m_entries[id].serviceName;
+  }
+
+  const ndn::Name&
+  getApplicationPrefix(EntryId id) const
+  {
+    return *m_entries[id].applicationPrefix;
+  }
+
+  const ndn::Name&
+  getScope(EntryId id) const
+  {
+    static const ndn::Name DEFAULT_SCOPE;
+    const Entry& entry = m_entries[id];
+    return entry.scope ? *entry.scope : DEFAULT_SCOPE;
+  }
+
+  const NamePool::Handle&
+  getServiceNameHandle(EntryId id) const
+  {
+    return m_entries[id].serviceName;
+  }
+
+  const NamePool::Handle&
+  getApplicationPrefixHandle(EntryId id) const
+  {
+    return m_entries[id].applicationPrefix;
+  }
+
+  int
+  getServiceLifetime(EntryId id) const
+  {
+    return m_entries[id].serviceLifetime;
+  }
+
+  time_t
+  getPublishTimestamp(EntryId id) const
+  {
+    return m_entries[id].publishTimestamp;
+  }
+
+  /**
+    @brief end of the lease in seconds since the epoch, 0 if it never ends
+  **/
+  time_t
+  getLeaseEnd(EntryId id) const
+  {
+    return computeLeaseEnd(m_entries[id]);
+  }
+
+  /**
+    @brief record a heartbeat in place; a lease renews the entry from now, publishTimestamp
+           stays the version set by the producer
+  **/
+  void
+  applyHeartbeat(EntryId id, const Heartbeat& heartbeat, time_t now);
+
+  /**
+    @brief last heartbeat of the entry, nullopt if none was received since it was added
+  **/
+  std::optional<Heartbeat>
+  getHeartbeat(EntryId id) const
+  {
+    const Entry& entry = m_entries[id];
+    if (!entry.hasHeartbeat) {
+      return std::nullopt;
+    }
+    return Heartbeat{entry.load, entry.queueDepth, 0};
+  }
+
+  /**
+    @brief look up one serviceMetaInfo value without materializing the entry
+    @note the view is invalidated when the entry is replaced or removed
+  **/
+  std::optional<std::string_view>
+  getMetaValue(EntryId id, std::string_view key) const;
+
+  /**
+    @brief interned metadata value, empty if the entry has no such key
+  **/
+  StringPool::Handle
+  getMetaValueHandle(EntryId id, std::string_view key) const;
+
+  /**
+    @brief id of an interned metadata key, nullopt if no entry ever used it
+  **/
+  std::optional<uint32_t>
+  findKeyId(std::string_view key) const;
+
+  NamePool&
+  getNamePool()
+  {
+    return m_names;
+  }
+
+  StringPool&
+  getStringPool()
+  {
+    return m_strings;
+  }
+
+  const StringPool&
+  getStringPool() const
+  {
+    return m_strings;
+  }
+
+  /**
+    @brief maintain a secondary index over serviceMetaInfo key
+  **/
+  void
+  addIndex(const std::string& key, IndexType type)
+  {
+    m_attributeIndex.addIndex(key, type, *this);
+  }
+
+  void
+  removeIndex(const std::string& key)
+  {
+    m_attributeIndex.removeIndex(key);
+  }
+
+  /**
+    @return ids of the entries matching every predicate of query, in ascending order
+  **/
+  std::vector<EntryId>
+  query(const Query& query) const
+  {
+    return m_attributeIndex.query(query, *this);
+  }
+
+  /**
+    @brief mirror the registry into RegistryColumns for ad-hoc predicate scans
+    @param metaKeys serviceMetaInfo keys to dictionary encode into columns
+  **/
+  void
+  enableColumns(std::vector<std::string> metaKeys);
+
+  /**
+    @brief columnar mirror, nullptr unless enableColumns() was called
+  **/
+  const RegistryColumns*
+  getColumns() const
+  {
+    return m_columns.get();
+  }
+
+  void
+  forEach(const EntryVisitor& visitor) const;
+
+  /**
+    @brief snapshot of one scope in the form returned by
+           ServiceDiscovery::getReceivedServiceDetails
+  **/
+  std::map<std::string, Details>
+  toMap(const ndn::Name& scope = ndn::Name()) const;
+
+  MemoryUsage
+  getMemoryUsage() const;
+
+  /**
+    @brief bound the bytes charged to the entries, see evict()
+    @param bytes budget, 0 for none
+    @param priorityKey serviceMetaInfo key read by EvictionPolicy::LOWEST_PRIORITY
+  **/
+  void
+  setMemoryBudget(size_t bytes, EvictionPolicy policy = EvictionPolicy::LEAST_RECENTLY_USED,
+                  const std::string& priorityKey = "priority");
+
+  size_t
+  getMemoryBudget() const
+  {
+    return m_budget;
+  }
+
+  /**
+    @brief bytes charged to all entries plus the fragmented bytes of the metadata arena
+  **/
+  size_t
+  getAccountedBytes() const
+  {
+    return m_accountedBytes + m_arena.getBytesFragmented();
+  }
+
+  size_t
+  getEntryBytes(EntryId id) const
+  {
+    return m_entries[id].bytes;
+  }
+
+  /**
+    @brief mark an entry as just used, for EvictionPolicy::LEAST_RECENTLY_USED
+
+    Inserting or replacing an entry marks it too. Lookups of the registry do not, the
+    caller decides which of them count as a use.
+  **/
+  void
+  touch(EntryId id) const;
+
+  /**
+    @brief remove entries until the accounted bytes fit in the budget
+    @param onEvict called for each entry right before it is removed
+    @return number of removed entries
+  **/
+  size_t
+  evict(const EntryVisitor& onEvict = nullptr);
+
+  // entries removed by evict() since the registry was created
+  uint64_t
+  getEvictionCount() const
+  {
+    return m_nEvicted;
+  }
+
+private:
+  struct MetaItem
+  {
+    uint32_t key;
+    StringPool::Handle value;
+  };
+
+  struct Entry
+  {
+    // empty for the default scope
+    NamePool::Handle scope;
+    NamePool::Handle serviceName;
+    NamePool::Handle applicationPrefix;
+    int serviceLifetime = 0;
+    time_t publishTimestamp = 0;
+    // lease end renewed by heartbeats, 0 if none since publishTimestamp
+    time_t leaseEnd = 0;
+    SlabArena::Ref meta;
+    uint32_t metaCount = 0;
+    std::multimap<time_t, EntryId>::iterator expiry;
+    // from the last heartbeat, kept when the details are replaced
+    uint32_t load = 0;
+    uint32_t queueDepth = 0;
+    // charged to the entry, see computeEntryBytes()
+    uint32_t bytes = 0;
+    // neighbours in the recency list, INVALID_ENTRY at its ends
+    mutable EntryId lessRecent = INVALID_ENTRY;
+    mutable EntryId moreRecent = INVALID_ENTRY;
+    // key in m_evictionOrder
+    int64_t evictionRank = 0;
+    bool hasHeartbeat = false;
+    bool hasExpiry = false;
+    bool inUse = false;
+  };
+
+  // interned (scope, applicationPrefix, serviceName)
+  struct EntryKey
+  {
+    const void* scope;
+    const void* applicationPrefix;
+    const void* serviceName;
+
+    bool
+    operator==(const EntryKey& other) const
+    {
+      return scope == other.scope && applicationPrefix == other.applicationPrefix &&
+             serviceName == other.serviceName;
+    }
+  };
+
+  struct EntryKeyHash
+  {
+    size_t
+    operator()(const EntryKey& key) const
+    {
+      std::hash<const void*> hash;
+      return (hash(key.scope) * 31 + hash(key.applicationPrefix)) * 31 + hash(key.serviceName);
+    }
+  };
+
+  uint32_t
+  internKey(const std::string& key);
+
+  // intern the metadata of details as key-sorted items
+  std::vector<MetaItem>
+  makeMeta(const std::map<std::string, std::string>& metaInfo);
+
+  bool
+  isSameMeta(const Entry& entry, const std::vector<MetaItem>& items) const;
+
+  void
+  storeMeta(Entry& entry, std::vector<MetaItem>&& items);
+
+  void
+  releaseMeta(Entry& entry);
+
+  const MetaItem*
+  findMetaItem(const Entry& entry, std::string_view key) const;
+
+  MetaItem*
+  getMetaItems(const Entry& entry) const
+  {
+    if (!entry.meta.isValid()) {
+      return nullptr;
+    }
+    return reinterpret_cast<MetaItem*>(m_arena.data(entry.meta));
+  }
+
+  static time_t
+  computeLeaseEnd(const Entry& entry)
+  {
+    if (entry.leaseEnd != 0) {
+      return entry.leaseEnd;
+    }
+    return entry.serviceLifetime <= 0 ? 0 : entry.publishTimestamp + entry.serviceLifetime;
+  }
+
+  void
+  setExpiry(EntryId id);
+
+  size_t
+  computeEntryBytes(const Entry& entry) const;
+
+  void
+  updateEntryBytes(Entry& entry);
+
+  void
+  unlinkRecency(EntryId id) const;
+
+  // rank the entry in m_evictionOrder if the policy needs it
+  void
+  setEvictionRank(EntryId id);
+
+  void
+  clearEvictionRank(EntryId id);
+
+private:
+  // pools first: every handle below must be released before its pool goes away
+  NamePool m_names;
+  StringPool m_strings;
+
+  SlabArena m_arena;
+  std::vector<std::string> m_keys;
+  std::map<std::string, uint32_t, std::less<>> m_keyIds;
+
+  std::vector<Entry> m_entries;
+  std::vector<EntryId> m_freeEntries;
+  std::unordered_map<EntryKey, EntryId, EntryKeyHash> m_index;
+  // interned serviceName -> entries
+  std::unordered_map<const void*, std::vector<EntryId>> m_providers;
+  std::multimap<time_t, EntryId> m_expiryQueue;
+  AttributeIndex m_attributeIndex;
+  std::unique_ptr<RegistryColumns> m_columns;
+
+  size_t m_budget = 0;
+  EvictionPolicy m_evictionPolicy = EvictionPolicy::LEAST_RECENTLY_USED;
+  std::string m_priorityKey;
+  size_t m_accountedBytes = 0;
+  uint64_t m_nEvicted = 0;
+  // every entry from the least to the most recently used
+  mutable EntryId m_leastRecent = INVALID_ENTRY;
+  mutable EntryId m_mostRecent = INVALID_ENTRY;
+  // (rank, id), lowest rank evicted first, for the policies other than LEAST_RECENTLY_USED
+  std::set<std::pair<int64_t, EntryId>> m_evictionOrder;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SERVICE_REGISTRY_HPP
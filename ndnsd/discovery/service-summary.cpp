@@ -0,0 +1,222 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "service-summary.hpp"
+
+#include <algorithm>
+
+namespace ndnsd {
+namespace discovery {
+
+schema::DecodeStatus
+SummaryEntriesCodec::read(const uint8_t* begin, const uint8_t* end, value_type& entries)
+{
+  schema::ElementReader elements(begin, end);
+  uint32_t type = 0;
+  const uint8_t* entryBegin = nullptr;
+  const uint8_t* entryEnd = nullptr;
+  while (elements.next(type, entryBegin, entryEnd)) {
+    if (type != tlv::SummaryEntry) {
+      if (ndn::tlv::isCriticalType(type)) {
+        return schema::DecodeStatus::UNKNOWN_CRITICAL;
+      }
+      continue;
+    }
+
+    schema::ElementReader fields(entryBegin, entryEnd);
+    const uint8_t* valueBegin = nullptr;
+    const uint8_t* valueEnd = nullptr;
+    SummaryEntry entry;
+    while (fields.next(type, valueBegin, valueEnd)) {
+      auto status = schema::DecodeStatus::OK;
+      if (type == tlv::SummaryService) {
+        status = schema::NameUriCodec::read(valueBegin, valueEnd, entry.serviceName);
+      }
+      else if (type == tlv::SummaryProviders) {
+        status = schema::NonNegativeIntegerCodec<uint32_t>::read(valueBegin, valueEnd,
+                                                                 entry.nProviders);
+      }
+      else if (type == tlv::SummaryExpiry) {
+        status = schema::NonNegativeIntegerCodec<time_t>::read(valueBegin, valueEnd, entry.expiry);
+      }
+      else if (ndn::tlv::isCriticalType(type)) {
+        status = schema::DecodeStatus::UNKNOWN_CRITICAL;
+      }
+      if (status != schema::DecodeStatus::OK) {
+        return status;
+      }
+    }
+    if (fields.isMalformed()) {
+      return schema::DecodeStatus::MALFORMED;
+    }
+    if (entry.serviceName.empty()) {
+      return schema::DecodeStatus::BAD_VALUE;
+    }
+    entries.push_back(std::move(entry));
+  }
+  return elements.isMalformed() ? schema::DecodeStatus::MALFORMED : schema::DecodeStatus::OK;
+}
+
+std::vector<ndn::Name>
+SummaryTable::apply(const ndn::Name& aggregatorName, ServiceSummary summary)
+{
+  std::vector<ndn::Name> changed;
+  Aggregator& aggregator = m_aggregators[aggregatorName];
+  if (summary.generation <= aggregator.generation) {
+    // duplicate, or superseded by a complete summary
+    return changed;
+  }
+
+  if (summary.isComplete()) {
+    // entries missing from the summary reach no provider anymore
+    std::set<ndn::Name> listed;
+    for (const auto& entry : summary.entries) {
+      listed.insert(entry.serviceName);
+    }
+    for (const auto& item : aggregator.entries) {
+      if (listed.count(item.first) == 0) {
+        summary.entries.push_back({item.first, 0, 0});
+      }
+    }
+  }
+  else if (summary.base != aggregator.generation) {
+    if (summary.base > aggregator.generation && aggregator.pending.size() < MAX_PENDING) {
+      aggregator.pending.emplace(summary.base, std::move(summary));
+    }
+    return changed;
+  }
+
+  setEntries(aggregatorName, aggregator, summary.entries, changed);
+  aggregator.generation = summary.generation;
+
+  // the summaries that were waiting for this one
+  auto& pending = aggregator.pending;
+  pending.erase(pending.begin(), pending.lower_bound(aggregator.generation));
+  while (!pending.empty() && pending.begin()->first == aggregator.generation) {
+    ServiceSummary next = std::move(pending.begin()->second);
+    pending.erase(pending.begin());
+    setEntries(aggregatorName, aggregator, next.entries, changed);
+    aggregator.generation = next.generation;
+    pending.erase(pending.begin(), pending.lower_bound(aggregator.generation));
+  }
+  return changed;
+}
+
+void
+SummaryTable::setEntries(const ndn::Name& aggregatorName, Aggregator& aggregator,
+                         const std::vector<SummaryEntry>& entries, std::vector<ndn::Name>& changed)
+{
+  for (const auto& entry : entries) {
+    auto it = aggregator.entries.find(entry.serviceName);
+    if (entry.nProviders == 0) {
+      if (it == aggregator.entries.end()) {
+        continue;
+      }
+      aggregator.entries.erase(it);
+      auto byService = m_byService.find(entry.serviceName);
+      byService->second.erase(aggregatorName);
+      if (byService->second.empty()) {
+        m_byService.erase(byService);
+      }
+    }
+    else if (it == aggregator.entries.end()) {
+      aggregator.entries.emplace(entry.serviceName, entry);
+      m_byService[entry.serviceName].insert(aggregatorName);
+    }
+    else if (it->second == entry) {
+      continue;
+    }
+    else {
+      it->second = entry;
+    }
+    changed.push_back(entry.serviceName);
+  }
+}
+
+std::vector<ndn::Name>
+SummaryTable::expire(time_t now)
+{
+  std::vector<ndn::Name> changed;
+  for (auto& [aggregatorName, aggregator] : m_aggregators) {
+    std::vector<SummaryEntry> ended;
+    for (const auto& [serviceName, entry] : aggregator.entries) {
+      if (entry.expiry != 0 && entry.expiry <= now) {
+        ended.push_back({serviceName, 0, 0});
+      }
+    }
+    setEntries(aggregatorName, aggregator, ended, changed);
+  }
+  return changed;
+}
+
+std::vector<ndn::Name>
+SummaryTable::findAggregators(const ndn::Name& serviceName) const
+{
+  std::vector<std::pair<uint32_t, ndn::Name>> ranked;
+  auto byService = m_byService.find(serviceName);
+  if (byService != m_byService.end()) {
+    for (const auto& aggregatorName : byService->second) {
+      const auto& entries = m_aggregators.at(aggregatorName).entries;
+      ranked.emplace_back(entries.at(serviceName).nProviders, aggregatorName);
+    }
+  }
+  std::stable_sort(ranked.begin(), ranked.end(), [] (const auto& a, const auto& b) {
+    return a.first > b.first;
+  });
+
+  std::vector<ndn::Name> aggregators;
+  for (auto& item : ranked) {
+    aggregators.push_back(std::move(item.second));
+  }
+  return aggregators;
+}
+
+SummaryEntry
+SummaryTable::summarize(const ndn::Name& serviceName) const
+{
+  SummaryEntry summary{serviceName, 0, 0};
+  auto byService = m_byService.find(serviceName);
+  if (byService == m_byService.end()) {
+    return summary;
+  }
+  bool isEndless = false;
+  for (const auto& aggregatorName : byService->second) {
+    const auto& entry = m_aggregators.at(aggregatorName).entries.at(serviceName);
+    summary.nProviders += entry.nProviders;
+    isEndless = isEndless || entry.expiry == 0;
+    summary.expiry = std::max(summary.expiry, entry.expiry);
+  }
+  if (isEndless) {
+    summary.expiry = 0;
+  }
+  return summary;
+}
+
+std::vector<ndn::Name>
+SummaryTable::getServices() const
+{
+  std::vector<ndn::Name> services;
+  for (const auto& item : m_byService) {
+    services.push_back(item.first);
+  }
+  return services;
+}
+
+} // namespace discovery
+} // namespace ndnsd
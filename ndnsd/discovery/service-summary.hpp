@@ -0,0 +1,225 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SERVICE_SUMMARY_HPP
+#define NDNSD_SERVICE_SUMMARY_HPP
+
+#include "details.hpp"
+
+#include <ctime>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+namespace tlv {
+
+  enum {
+    ServiceSummary = 150,
+    SummaryGeneration = 152,
+    SummaryBase = 154,
+    SummaryEntries = 156,
+    SummaryEntry = 158,
+    SummaryService = 160,
+    SummaryProviders = 162,
+    SummaryExpiry = 164,
+  };
+
+} // namespace tlv
+
+/**
+  @brief a service as seen through an aggregator
+**/
+struct SummaryEntry
+{
+  ndn::Name serviceName;
+  // providers the aggregator reaches, 0 once it reaches none
+  uint32_t nProviders = 0;
+  // latest lease end of these providers in seconds since the epoch, 0 if one never ends
+  time_t expiry = 0;
+
+  bool
+  operator==(const SummaryEntry& other) const
+  {
+    return serviceName == other.serviceName && nProviders == other.nProviders &&
+           expiry == other.expiry;
+  }
+};
+
+/**
+  @brief Services an aggregator reaches below it, published in its parent group
+
+  Published as <nodeName>/NDNSD/summary/<version>, nodeName being the name of the aggregator
+  in the parent group and a single component. Generations of an aggregator increase with
+  each summary; a summary with no base lists every service, otherwise it lists the entries
+  changed since the summary of generation base, the ones that reach no provider anymore
+  included.
+**/
+struct ServiceSummary
+{
+  uint64_t generation = 0;
+  // generation this summary changes, 0 for a complete summary
+  uint64_t base = 0;
+  std::vector<SummaryEntry> entries;
+
+  bool
+  isComplete() const
+  {
+    return base == 0;
+  }
+
+  static schema::DecodeResult<ServiceSummary>
+  tryDecode(const uint8_t* begin, const uint8_t* end);
+
+  ndn::Block
+  encode() const;
+};
+
+/**
+  @brief ServiceSummary::entries as <SummaryEntries><SummaryEntry>...</SummaryEntry></SummaryEntries>
+**/
+struct SummaryEntriesCodec
+{
+  using value_type = std::vector<SummaryEntry>;
+
+  static bool
+  isPresent(const value_type& entries)
+  {
+    return !entries.empty();
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, const value_type& entries)
+  {
+    size_t totalLength = 0;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      size_t entryLength = 0;
+      if (it->expiry != 0) {
+        entryLength += ndn::encoding::prependNonNegativeIntegerBlock(encoder, tlv::SummaryExpiry,
+                                                                     it->expiry);
+      }
+      entryLength += ndn::encoding::prependNonNegativeIntegerBlock(encoder, tlv::SummaryProviders,
+                                                                   it->nProviders);
+      entryLength += schema::NameUriCodec::prepend(encoder, tlv::SummaryService, it->serviceName);
+      entryLength += encoder.prependVarNumber(entryLength);
+      entryLength += encoder.prependVarNumber(tlv::SummaryEntry);
+      totalLength += entryLength;
+    }
+    totalLength += encoder.prependVarNumber(totalLength);
+    totalLength += encoder.prependVarNumber(type);
+    return totalLength;
+  }
+
+  static schema::DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, value_type& entries);
+};
+
+using ServiceSummarySchema = schema::Schema<tlv::ServiceSummary, ServiceSummary,
+  schema::Field<tlv::SummaryGeneration, &ServiceSummary::generation,
+                schema::NonNegativeIntegerCodec<uint64_t>, schema::REQUIRED_FIELD>,
+  schema::Field<tlv::SummaryBase, &ServiceSummary::base, OptionalTimestampCodec>,
+  schema::Field<tlv::SummaryEntries, &ServiceSummary::entries, SummaryEntriesCodec>>;
+
+inline schema::DecodeResult<ServiceSummary>
+ServiceSummary::tryDecode(const uint8_t* begin, const uint8_t* end)
+{
+  return ServiceSummarySchema::decode(begin, end);
+}
+
+inline ndn::Block
+ServiceSummary::encode() const
+{
+  return ServiceSummarySchema::encode(*this);
+}
+
+/**
+  @brief Summaries received in a group, by aggregator
+
+  Changes are applied in generation order: a summary whose base is newer than the last
+  applied one is kept until the ones in between arrive, or a complete summary supersedes
+  them. Entries are dropped when their lease ends.
+**/
+class SummaryTable
+{
+public:
+  // summaries kept per aggregator while waiting for an earlier one
+  static constexpr size_t MAX_PENDING = 64;
+
+  /**
+    @brief apply summary of aggregator
+    @return services whose entries changed, possibly none if summary was kept for later
+  **/
+  std::vector<ndn::Name>
+  apply(const ndn::Name& aggregator, ServiceSummary summary);
+
+  /**
+    @brief drop the entries whose lease ended before now
+    @return services whose entries were dropped
+  **/
+  std::vector<ndn::Name>
+  expire(time_t now);
+
+  /**
+    @brief aggregators that reach serviceName, the ones with the most providers first
+  **/
+  std::vector<ndn::Name>
+  findAggregators(const ndn::Name& serviceName) const;
+
+  /**
+    @brief serviceName through all the aggregators: providers added up and latest expiry
+  **/
+  SummaryEntry
+  summarize(const ndn::Name& serviceName) const;
+
+  // services reached through any aggregator
+  std::vector<ndn::Name>
+  getServices() const;
+
+  // number of aggregators with a summary
+  size_t
+  size() const
+  {
+    return m_aggregators.size();
+  }
+
+private:
+  struct Aggregator
+  {
+    uint64_t generation = 0;
+    std::map<ndn::Name, SummaryEntry> entries;
+    // summaries waiting for the one of their base, by base
+    std::map<uint64_t, ServiceSummary> pending;
+  };
+
+  void
+  setEntries(const ndn::Name& aggregatorName, Aggregator& aggregator,
+             const std::vector<SummaryEntry>& entries, std::vector<ndn::Name>& changed);
+
+private:
+  std::map<ndn::Name, Aggregator> m_aggregators;
+  // aggregators that reach a service, by serviceName
+  std::map<ndn::Name, std::set<ndn::Name>> m_byService;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SERVICE_SUMMARY_HPP
@@ -0,0 +1,416 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "shared-registry.hpp"
+#include "service-registry.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+INIT_LOGGER(SharedRegistry);
+
+namespace ndnsd {
+namespace discovery {
+
+static const char MAGIC[8] = {'N', 'D', 'N', 'S', 'D', 'S', 'H', '1'};
+static const size_t INITIAL_SIZE = 64 * 1024;
+// reads retried before a reader gives up on a writer that left the snapshot half written
+static const size_t MAX_READ_ATTEMPTS = 100000;
+
+struct SharedHeader
+{
+  char magic[8];
+  // odd while the writer is rewriting the snapshot
+  std::atomic<uint64_t> seq;
+  // size of the object, only grows
+  uint64_t regionSize;
+  uint32_t nEntries;
+  // set by the destructor of the writer, a restarted one writes another object
+  std::atomic<uint32_t> isClosed;
+  // bytes of the records following the index
+  uint64_t recordsSize;
+};
+
+struct SharedIndexEntry
+{
+  uint64_t hash;
+  // from the start of the records
+  uint32_t offset;
+  uint32_t length;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the sequence lock must be usable across processes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the closed mark must be usable across processes");
+
+static uint64_t
+hashKey(const ndn::Name& applicationPrefix, const ndn::Name& serviceName)
+{
+  // FNV-1a, the hash must be the same in every process
+  std::string key = ServiceRegistry::makeKey(applicationPrefix, serviceName).toUri();
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+
+SharedRegistryWriter::SharedRegistryWriter(const std::string& name)
+  : m_name(name)
+{
+  // start from a new object, readers of a previous daemon's one keep their stale mapping
+  ::shm_unlink(m_name.data());
+  m_fd = ::shm_open(m_name.data(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    throw Error("Cannot create shared memory " + m_name + ": " + std::strerror(errno));
+  }
+  if (!reserve(INITIAL_SIZE)) {
+    std::string reason = std::strerror(errno);
+    ::close(m_fd);
+    ::shm_unlink(m_name.data());
+    throw Error("Cannot map shared memory " + m_name + ": " + reason);
+  }
+
+  auto header = new (m_data) SharedHeader{};
+  std::memcpy(header->magic, MAGIC, sizeof(MAGIC));
+  header->regionSize = m_size;
+}
+
+SharedRegistryWriter::~SharedRegistryWriter()
+{
+  if (m_data != nullptr) {
+    reinterpret_cast<SharedHeader*>(m_data)->isClosed.store(1, std::memory_order_release);
+    ::munmap(m_data, m_size);
+  }
+  ::close(m_fd);
+  ::shm_unlink(m_name.data());
+}
+
+bool
+SharedRegistryWriter::reserve(size_t size)
+{
+  if (size <= m_size) {
+    return true;
+  }
+  size_t newSize = std::max(size, m_size * 2);
+  if (::ftruncate(m_fd, static_cast<off_t>(newSize)) != 0) {
+    return false;
+  }
+  void* data = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  if (m_data != nullptr) {
+    ::munmap(m_data, m_size);
+    // readers remap when they see the new size
+    reinterpret_cast<SharedHeader*>(data)->regionSize = newSize;
+  }
+  m_data = static_cast<uint8_t*>(data);
+  m_size = newSize;
+  return true;
+}
+
+bool
+SharedRegistryWriter::update(const ServiceRegistry& registry)
+{
+  std::vector<SharedIndexEntry> index;
+  index.reserve(registry.size());
+  m_buffer.clear();
+  registry.forEach([&] (ServiceRegistry::EntryId id) {
+    ndn::Block block = registry.get(id).encode();
+    index.push_back({hashKey(registry.getApplicationPrefix(id), registry.getServiceName(id)),
+                     static_cast<uint32_t>(m_buffer.size()), static_cast<uint32_t>(block.size())});
+    m_buffer.insert(m_buffer.end(), block.data(), block.data() + block.size());
+  });
+  std::sort(index.begin(), index.end(), [] (const auto& a, const auto& b) {
+    return a.hash < b.hash;
+  });
+
+  size_t indexSize = index.size() * sizeof(SharedIndexEntry);
+  if (!reserve(sizeof(SharedHeader) + indexSize + m_buffer.size())) {
+    NDNSD_LOG_WARN("Cannot grow shared memory " << m_name << ": " << std::strerror(errno));
+    return false;
+  }
+
+  auto header = reinterpret_cast<SharedHeader*>(m_data);
+  uint64_t seq = header->seq.load(std::memory_order_relaxed);
+  header->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  header->nEntries = static_cast<uint32_t>(index.size());
+  header->recordsSize = m_buffer.size();
+  std::memcpy(m_data + sizeof(SharedHeader), index.data(), indexSize);
+  std::memcpy(m_data + sizeof(SharedHeader) + indexSize, m_buffer.data(), m_buffer.size());
+
+  header->seq.store(seq + 2, std::memory_order_release);
+  NDNSD_LOG_TRACE("Shared " << index.size() << " services, version " << (seq + 2) / 2);
+  return true;
+}
+
+uint64_t
+SharedRegistryWriter::getVersion() const
+{
+  return reinterpret_cast<const SharedHeader*>(m_data)->seq.load(std::memory_order_relaxed) / 2;
+}
+
+struct SharedRegistryReader::View
+{
+  const SharedIndexEntry* index = nullptr;
+  size_t nEntries = 0;
+  const uint8_t* records = nullptr;
+  size_t recordsSize = 0;
+
+  std::optional<Details>
+  decode(const SharedIndexEntry& entry) const
+  {
+    if (entry.offset > recordsSize || entry.length > recordsSize - entry.offset) {
+      return std::nullopt;
+    }
+    auto result = Details::tryDecode(records + entry.offset, records + entry.offset + entry.length);
+    if (!result) {
+      return std::nullopt;
+    }
+    return std::move(*result);
+  }
+};
+
+SharedRegistryReader::SharedRegistryReader(const std::string& name)
+  : m_name(name)
+{
+  open(true);
+}
+
+bool
+SharedRegistryReader::open(bool isThrowing) const
+{
+  auto fail = [&] (const std::string& reason) {
+    if (isThrowing) {
+      throw Error(reason);
+    }
+    return false;
+  };
+
+  int fd = ::shm_open(m_name.data(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0) {
+    return fail("Cannot open shared memory " + m_name + ": " + std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedHeader)) {
+    ::close(fd);
+    return fail("Shared memory " + m_name + " is not initialized");
+  }
+  if (m_data != nullptr && st.st_ino == m_inode && st.st_dev == m_device) {
+    // still the object already mapped
+    ::close(fd);
+    return false;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    std::string reason = std::strerror(errno);
+    ::close(fd);
+    return fail("Cannot map shared memory " + m_name + ": " + reason);
+  }
+  if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) {
+    ::munmap(data, size);
+    ::close(fd);
+    return fail("Shared memory " + m_name + " is not an NDNSD registry");
+  }
+
+  if (m_data != nullptr) {
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+    ::close(m_fd);
+  }
+  m_fd = fd;
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = size;
+  m_inode = st.st_ino;
+  m_device = st.st_dev;
+  return true;
+}
+
+bool
+SharedRegistryReader::reopen() const
+{
+  // until the restarted writer has created its object, the name is missing or still the
+  // mapped one
+  auto header = reinterpret_cast<const SharedHeader*>(m_data);
+  uint64_t version = m_versionBase + header->seq.load(std::memory_order_acquire) / 2;
+  if (!open(false)) {
+    return false;
+  }
+  NDNSD_LOG_DEBUG("Reopened shared memory " << m_name << " of a restarted writer");
+  m_versionBase = version + 1;
+  return true;
+}
+
+void
+SharedRegistryReader::reopenIfClosed() const
+{
+  auto header = reinterpret_cast<const SharedHeader*>(m_data);
+  if (header->isClosed.load(std::memory_order_acquire) != 0) {
+    reopen();
+  }
+}
+
+SharedRegistryReader::~SharedRegistryReader()
+{
+  if (m_data != nullptr) {
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  ::close(m_fd);
+}
+
+void
+SharedRegistryReader::remap(size_t size) const
+{
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+  if (data == MAP_FAILED) {
+    throw Error(std::string("Cannot map shared memory: ") + std::strerror(errno));
+  }
+  if (m_data != nullptr) {
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  }
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = size;
+}
+
+template<typename Fn>
+auto
+SharedRegistryReader::read(Fn&& fn) const
+{
+  reopenIfClosed();
+  for (size_t nAttempts = 1;; ++nAttempts) {
+    auto header = reinterpret_cast<const SharedHeader*>(m_data);
+    uint64_t seq = header->seq.load(std::memory_order_acquire);
+    if (seq % 2 == 1) {
+      if (nAttempts >= MAX_READ_ATTEMPTS) {
+        // the writer was killed while rewriting the snapshot, a restarted one writes another
+        // object
+        if (reopen()) {
+          nAttempts = 0;
+          continue;
+        }
+        throw Error("Shared memory " + m_name + " stays half written, its writer may have "
+                    "died during an update");
+      }
+      std::this_thread::yield();
+      continue;
+    }
+    if (header->regionSize > m_size) {
+      remap(header->regionSize);
+      continue;
+    }
+
+    // a torn snapshot may hold anything, bound every access by the mapping
+    View view;
+    size_t available = m_size - sizeof(SharedHeader);
+    if (header->nEntries <= available / sizeof(SharedIndexEntry)) {
+      view.nEntries = header->nEntries;
+      view.index = reinterpret_cast<const SharedIndexEntry*>(m_data + sizeof(SharedHeader));
+      size_t indexSize = view.nEntries * sizeof(SharedIndexEntry);
+      view.records = m_data + sizeof(SharedHeader) + indexSize;
+      view.recordsSize = std::min<size_t>(header->recordsSize, available - indexSize);
+    }
+    auto result = fn(view);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->seq.load(std::memory_order_relaxed) == seq) {
+      return result;
+    }
+  }
+}
+
+std::optional<Details>
+SharedRegistryReader::find(const ndn::Name& applicationPrefix, const ndn::Name& serviceName) const
+{
+  uint64_t hash = hashKey(applicationPrefix, serviceName);
+  return read([&] (const View& view) -> std::optional<Details> {
+    auto it = std::lower_bound(view.index, view.index + view.nEntries, hash,
+                               [] (const SharedIndexEntry& entry, uint64_t hash) {
+                                 return entry.hash < hash;
+                               });
+    for (; it != view.index + view.nEntries && it->hash == hash; ++it) {
+      auto details = view.decode(*it);
+      if (details && details->applicationPrefix == applicationPrefix &&
+          details->serviceName == serviceName) {
+        return details;
+      }
+    }
+    return std::nullopt;
+  });
+}
+
+std::vector<Details>
+SharedRegistryReader::findByServiceName(const ndn::Name& serviceName) const
+{
+  return read([&] (const View& view) {
+    std::vector<Details> services;
+    for (size_t i = 0; i < view.nEntries; ++i) {
+      auto details = view.decode(view.index[i]);
+      if (details && details->serviceName == serviceName) {
+        services.push_back(std::move(*details));
+      }
+    }
+    return services;
+  });
+}
+
+std::map<std::string, Details>
+SharedRegistryReader::getServiceDetails() const
+{
+  return read([&] (const View& view) {
+    std::map<std::string, Details> services;
+    for (size_t i = 0; i < view.nEntries; ++i) {
+      auto details = view.decode(view.index[i]);
+      if (details) {
+        auto key = ServiceRegistry::makeKey(details->applicationPrefix, details->serviceName);
+        services.emplace(key.toUri(), std::move(*details));
+      }
+    }
+    return services;
+  });
+}
+
+size_t
+SharedRegistryReader::size() const
+{
+  return read([] (const View& view) { return view.nEntries; });
+}
+
+uint64_t
+SharedRegistryReader::getVersion() const
+{
+  reopenIfClosed();
+  auto header = reinterpret_cast<const SharedHeader*>(m_data);
+  return m_versionBase + header->seq.load(std::memory_order_acquire) / 2;
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,189 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SHARED_REGISTRY_HPP
+#define NDNSD_SHARED_REGISTRY_HPP
+
+#include "details.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace ndnsd {
+namespace discovery {
+
+class ServiceRegistry;
+
+/**
+  @brief Snapshot of a ServiceRegistry in a POSIX shared memory object
+
+  The object holds a header, an index of (hash of applicationPrefix + serviceName, offset,
+  length) sorted by hash, and the ServiceInfo TLV of every entry. It is written by one
+  process, the ndnsd daemon, and mapped read-only by any number of local readers.
+
+  Writes are published under a sequence lock: the writer makes the sequence number odd,
+  rewrites the snapshot and makes it even again. A reader decodes the entries it looks up
+  straight from the mapping into new Details, and retries if the sequence number was odd or
+  changed meanwhile, so lookups copy only the entries they return and never block the
+  writer. The object only grows, a reader remaps when the writer has grown it past the
+  reader's mapping.
+
+  A restarted writer creates a new object under the same name. The destructor of the old
+  writer marks its object closed, and readers that see the mark open the name again once
+  the new object exists, serving the last snapshot meanwhile. A writer that died without
+  running its destructor leaves readers on its last snapshot until they are recreated,
+  unless it died during an update: readers then stop retrying after a bounded number of
+  attempts, switch to the object of a restarted writer if there is one, and throw otherwise.
+**/
+class SharedRegistryWriter
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+    @param name shared memory object name, starting with '/'
+    @throw Error if the object cannot be created
+  **/
+  explicit
+  SharedRegistryWriter(const std::string& name);
+
+  SharedRegistryWriter(const SharedRegistryWriter&) = delete;
+  SharedRegistryWriter& operator=(const SharedRegistryWriter&) = delete;
+
+  // marks the object closed and unlinks it, mappings of readers stay valid
+  ~SharedRegistryWriter();
+
+  /**
+    @brief replace the snapshot with the entries of registry
+    @return false if the object could not be grown to fit them, the old snapshot is kept
+  **/
+  bool
+  update(const ServiceRegistry& registry);
+
+  uint64_t
+  getVersion() const;
+
+private:
+  bool
+  reserve(size_t size);
+
+private:
+  std::string m_name;
+  int m_fd = -1;
+  uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+  // snapshot being encoded, kept to reuse its capacity
+  std::vector<uint8_t> m_buffer;
+};
+
+class SharedRegistryReader
+{
+public:
+  class Error : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  /**
+    @throw Error if the object does not exist or was not written by SharedRegistryWriter
+  **/
+  explicit
+  SharedRegistryReader(const std::string& name);
+
+  SharedRegistryReader(const SharedRegistryReader&) = delete;
+  SharedRegistryReader& operator=(const SharedRegistryReader&) = delete;
+
+  ~SharedRegistryReader();
+
+  /**
+    @throw Error if the writer left the snapshot half written and was not restarted, for
+           every lookup below
+  **/
+  std::optional<Details>
+  find(const ndn::Name& applicationPrefix, const ndn::Name& serviceName) const;
+
+  std::vector<Details>
+  findByServiceName(const ndn::Name& serviceName) const;
+
+  /**
+    @brief all services, keyed like ServiceDiscovery::getReceivedServiceDetails
+  **/
+  std::map<std::string, Details>
+  getServiceDetails() const;
+
+  size_t
+  size() const;
+
+  /**
+    @brief number of updates of the snapshot, for cheap change detection; keeps increasing
+           across writer restarts
+  **/
+  uint64_t
+  getVersion() const;
+
+private:
+  struct View;
+
+  // map the object called m_name, false if it does not exist yet or is not initialized
+  bool
+  open(bool isThrowing) const;
+
+  // switch to the object of a restarted writer, false if there is none yet
+  bool
+  reopen() const;
+
+  void
+  reopenIfClosed() const;
+
+  // run fn over a consistent snapshot, retrying while the writer is active
+  template<typename Fn>
+  auto
+  read(Fn&& fn) const;
+
+  void
+  remap(size_t size) const;
+
+private:
+  std::string m_name;
+  mutable int m_fd = -1;
+  mutable const uint8_t* m_data = nullptr;
+  mutable size_t m_size = 0;
+  // identity of the mapped object
+  mutable ino_t m_inode = 0;
+  mutable dev_t m_device = 0;
+  // added to the versions of the current object, so that they follow those of the closed ones
+  mutable uint64_t m_versionBase = 0;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SHARED_REGISTRY_HPP
@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "slab-arena.hpp"
+
+#include <algorithm>
+
+namespace ndnsd {
+namespace discovery {
+
+static size_t
+alignUp(size_t size)
+{
+  return (size + 7) & ~size_t(7);
+}
+
+size_t
+SlabArena::getClassSize(size_t size)
+{
+  size = alignUp(size == 0 ? 1 : size);
+  if (size <= 128) {
+    return size;
+  }
+  // quarters of the power of two below size, at most 25% wasted
+  size_t step = (size_t(1) << (63 - __builtin_clzll(size))) / 4;
+  return (size + step - 1) & ~(step - 1);
+}
+
+SlabArena::SlabArena(size_t slabSize)
+  : m_slabSize(alignUp(slabSize))
+{
+}
+
+SlabArena::Ref
+SlabArena::allocate(size_t size)
+{
+  size = getClassSize(size);
+
+  Ref ref;
+  ref.size = static_cast<uint32_t>(size);
+
+  if (size > m_slabSize) {
+    // dedicated slab, released as soon as the allocation is freed
+    ref.slab = newSlab(size);
+  }
+  else {
+    auto freeBlocks = m_freeBlocks.find(ref.size);
+    while (freeBlocks != m_freeBlocks.end() && !freeBlocks->second.empty()) {
+      FreeBlock block = freeBlocks->second.back();
+      freeBlocks->second.pop_back();
+      --m_nFreeBlocks;
+      Slab& slab = m_slabs[block.slab];
+      if (slab.generation != block.generation) {
+        continue;
+      }
+      ref.slab = block.slab;
+      ref.offset = block.offset;
+      slab.live += ref.size;
+      m_bytesInUse += ref.size;
+      return ref;
+    }
+
+    if (m_current == INVALID_SLAB ||
+        m_slabs[m_current].capacity - m_slabs[m_current].used < size) {
+      if (!m_emptySlabs.empty()) {
+        m_current = m_emptySlabs.back();
+        m_emptySlabs.pop_back();
+      }
+      else {
+        m_current = newSlab(m_slabSize);
+      }
+    }
+    ref.slab = m_current;
+  }
+
+  Slab& slab = m_slabs[ref.slab];
+  ref.offset = slab.used;
+  slab.used += ref.size;
+  slab.live += ref.size;
+  m_bytesInUse += ref.size;
+  return ref;
+}
+
+void
+SlabArena::deallocate(const Ref& ref)
+{
+  if (!ref.isValid()) {
+    return;
+  }
+
+  Slab& slab = m_slabs[ref.slab];
+  slab.live -= ref.size;
+  m_bytesInUse -= ref.size;
+  if (slab.live != 0) {
+    m_freeBlocks[ref.size].push_back({ref.slab, ref.offset, slab.generation});
+    if (++m_nFreeBlocks > 2 * m_nPurgedFreeBlocks + 64) {
+      purgeStaleBlocks();
+    }
+    return;
+  }
+
+  // the whole slab is garbage now, and so are its free blocks
+  slab.used = 0;
+  ++slab.generation;
+  if (ref.slab == m_current) {
+    return;
+  }
+  if (slab.capacity == m_slabSize && m_emptySlabs.size() < MAX_CACHED_EMPTY_SLABS) {
+    m_emptySlabs.push_back(ref.slab);
+  }
+  else {
+    releaseSlab(ref.slab);
+  }
+}
+
+uint32_t
+SlabArena::newSlab(size_t capacity)
+{
+  uint32_t index;
+  if (!m_unusedSlots.empty()) {
+    index = m_unusedSlots.back();
+    m_unusedSlots.pop_back();
+  }
+  else {
+    index = static_cast<uint32_t>(m_slabs.size());
+    m_slabs.emplace_back();
+  }
+
+  Slab& slab = m_slabs[index];
+  slab.memory.reset(new uint8_t[capacity]);
+  slab.capacity = static_cast<uint32_t>(capacity);
+  slab.used = 0;
+  slab.live = 0;
+  m_bytesReserved += capacity;
+  return index;
+}
+
+void
+SlabArena::trim()
+{
+  for (uint32_t index : m_emptySlabs) {
+    releaseSlab(index);
+  }
+  m_emptySlabs.clear();
+}
+
+void
+SlabArena::purgeStaleBlocks()
+{
+  m_nFreeBlocks = 0;
+  for (auto it = m_freeBlocks.begin(); it != m_freeBlocks.end();) {
+    auto& blocks = it->second;
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [this] (const FreeBlock& block) {
+                   return m_slabs[block.slab].generation != block.generation;
+                 }),
+                 blocks.end());
+    m_nFreeBlocks += blocks.size();
+    it = blocks.empty() ? m_freeBlocks.erase(it) : std::next(it);
+  }
+  m_nPurgedFreeBlocks = m_nFreeBlocks;
+}
+
+void
+SlabArena::releaseSlab(uint32_t index)
+{
+  Slab& slab = m_slabs[index];
+  m_bytesReserved -= slab.capacity;
+  slab.memory.reset();
+  slab.capacity = 0;
+  m_unusedSlots.push_back(index);
+}
+
+} // namespace discovery
+} // namespace ndnsd
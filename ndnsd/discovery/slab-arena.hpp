@@ -0,0 +1,161 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SLAB_ARENA_HPP
+#define NDNSD_SLAB_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Bump allocator over fixed-size slabs with per-slab live byte counts.
+
+  Sizes are rounded up to size classes, four per power of two above 128 bytes. A freed
+  block goes to the free list of its class and is handed out again before the slab bumps,
+  so a slab kept alive by a few long-lived allocations still serves the churn of the
+  others. Once a slab holds no live allocations it is reset as a whole and reused (or
+  returned to the system if enough empty slabs are already cached); free blocks of a reset
+  slab are recognized as stale by its generation and dropped lazily.
+**/
+class SlabArena
+{
+public:
+  struct Ref
+  {
+    uint32_t slab = INVALID_SLAB;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+
+    bool
+    isValid() const
+    {
+      return slab != INVALID_SLAB;
+    }
+  };
+
+  static constexpr uint32_t INVALID_SLAB = UINT32_MAX;
+  static constexpr size_t DEFAULT_SLAB_SIZE = 64 * 1024;
+
+  explicit
+  SlabArena(size_t slabSize = DEFAULT_SLAB_SIZE);
+
+  Ref
+  allocate(size_t size);
+
+  void
+  deallocate(const Ref& ref);
+
+  uint8_t*
+  data(const Ref& ref) const
+  {
+    return m_slabs[ref.slab].memory.get() + ref.offset;
+  }
+
+  // bytes handed out and not yet freed (after alignment)
+  size_t
+  getBytesInUse() const
+  {
+    return m_bytesInUse;
+  }
+
+  // bytes currently obtained from the system
+  size_t
+  getBytesReserved() const
+  {
+    return m_bytesReserved;
+  }
+
+  // reserved bytes not in use: free blocks, slab tails and cached empty slabs
+  size_t
+  getBytesFragmented() const
+  {
+    return m_bytesReserved - m_bytesInUse;
+  }
+
+  // return the cached empty slabs to the system
+  void
+  trim();
+
+  // size handed out for a request of size bytes
+  static size_t
+  getClassSize(size_t size);
+
+  size_t
+  getSlabCount() const
+  {
+    return m_slabs.size() - m_unusedSlots.size();
+  }
+
+private:
+  struct Slab
+  {
+    std::unique_ptr<uint8_t[]> memory;
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    uint32_t live = 0;
+    // incremented whenever the slab is reset, invalidating its free blocks
+    uint32_t generation = 0;
+  };
+
+  struct FreeBlock
+  {
+    uint32_t slab;
+    uint32_t offset;
+    uint32_t generation;
+  };
+
+  uint32_t
+  newSlab(size_t capacity);
+
+  void
+  releaseSlab(uint32_t index);
+
+  // drop the free blocks of slabs reset since they were freed
+  void
+  purgeStaleBlocks();
+
+private:
+  const size_t m_slabSize;
+  std::vector<Slab> m_slabs;
+  // indices of released slabs whose slot in m_slabs can be reused
+  std::vector<uint32_t> m_unusedSlots;
+  // empty full-size slabs kept around for reuse
+  std::vector<uint32_t> m_emptySlabs;
+  uint32_t m_current = INVALID_SLAB;
+  // freed blocks by class size, possibly stale
+  std::map<uint32_t, std::vector<FreeBlock>> m_freeBlocks;
+  size_t m_nFreeBlocks = 0;
+  // m_nFreeBlocks after the last purge, purges happen as it doubles
+  size_t m_nPurgedFreeBlocks = 0;
+  size_t m_bytesInUse = 0;
+  size_t m_bytesReserved = 0;
+
+  static constexpr size_t MAX_CACHED_EMPTY_SLABS = 2;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SLAB_ARENA_HPP
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "subscription-filter.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+namespace ndnsd {
+namespace discovery {
+
+// component of an ndn::Regex: the URI of the component, as a std::regex
+static std::string
+escapeComponent(const ndn::name::Component& component)
+{
+  std::string escaped;
+  for (char c : component.toUri()) {
+    if (std::string_view(".[]{}()*+?^$|\\").find(c) != std::string_view::npos) {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+SubscriptionFilter&
+SubscriptionFilter::addService(const ndn::Name& prefix)
+{
+  addPrefix(m_services, prefix);
+  return *this;
+}
+
+SubscriptionFilter&
+SubscriptionFilter::addNode(const ndn::Name& prefix)
+{
+  addPrefix(m_nodes, prefix);
+  return *this;
+}
+
+bool
+SubscriptionFilter::matches(const ndn::Name& nodeName, const ndn::Name& serviceName) const
+{
+  return (m_services.empty() || isUnder(serviceName, m_services)) &&
+         (m_nodes.empty() || isUnder(nodeName, m_nodes));
+}
+
+std::vector<std::string>
+SubscriptionFilter::makeRegexes(const std::string& type, bool byNode) const
+{
+  // the publishing node is a single component holding the URI of its name
+  std::vector<std::string> nodePatterns;
+  if (!byNode || m_nodes.empty() || m_nodes.front().empty()) {
+    nodePatterns.push_back("<>");
+  }
+  else {
+    for (const auto& prefix : m_nodes) {
+      std::string uri = escapeComponent(ndn::name::Component(prefix.toUri()));
+      std::string separator = escapeComponent(ndn::name::Component("/"));
+      nodePatterns.push_back("<" + uri + "(" + separator + ".*)?>");
+    }
+  }
+
+  std::vector<std::string> servicePatterns;
+  if (m_services.empty()) {
+    servicePatterns.push_back("");
+  }
+  for (const auto& prefix : m_services) {
+    std::string pattern;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+      pattern += "<" + escapeComponent(prefix[i]) + ">";
+    }
+    servicePatterns.push_back(pattern);
+  }
+
+  std::vector<std::string> regexes;
+  for (const auto& node : nodePatterns) {
+    for (const auto& service : servicePatterns) {
+      regexes.push_back("^" + node + service + "<>*<NDNSD><" + type + ">");
+    }
+  }
+  return regexes;
+}
+
+void
+SubscriptionFilter::addPrefix(std::vector<ndn::Name>& prefixes, const ndn::Name& prefix)
+{
+  if (isUnder(prefix, prefixes)) {
+    return;
+  }
+  prefixes.erase(std::remove_if(prefixes.begin(), prefixes.end(),
+                                [&] (const ndn::Name& other) { return prefix.isPrefixOf(other); }),
+                 prefixes.end());
+  prefixes.push_back(prefix);
+}
+
+bool
+SubscriptionFilter::isUnder(const ndn::Name& name, const std::vector<ndn::Name>& prefixes)
+{
+  return std::any_of(prefixes.begin(), prefixes.end(),
+                     [&] (const ndn::Name& prefix) { return prefix.isPrefixOf(name); });
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,95 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SUBSCRIPTION_FILTER_HPP
+#define NDNSD_SUBSCRIPTION_FILTER_HPP
+
+#include <ndn-cxx/name.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief Publications of a group a node is interested in
+
+  A publication matches if its serviceName is under one of the service prefixes and it was
+  published by a node whose name is under one of the node prefixes; no prefix of a kind
+  matches everything.
+
+  @code
+    SubscriptionFilter().addService("/FlightControl").addNode("/site-a")
+  @endcode
+
+  ServiceDiscovery subscribes to the matching publications only, so SVS fetches the
+  payloads of no other; their sequence numbers are still tracked by sync. Heartbeats are
+  named by application prefix rather than node, only the service prefixes apply to them.
+**/
+class SubscriptionFilter
+{
+public:
+  SubscriptionFilter&
+  addService(const ndn::Name& prefix);
+
+  /**
+    @param prefix of the nodeName the publishing nodes joined the group with
+  **/
+  SubscriptionFilter&
+  addNode(const ndn::Name& prefix);
+
+  bool
+  matchesAll() const
+  {
+    return m_services.empty() && m_nodes.empty();
+  }
+
+  bool
+  matches(const ndn::Name& nodeName, const ndn::Name& serviceName) const;
+
+  /**
+    @brief ndn::Regex patterns matching the publication names of type ("service-info",
+           "heartbeat") that pass the filter, one per combination of prefixes
+
+    The prefixes are made disjoint first, so a publication matches at most one pattern.
+
+    @param byNode whether the first component of the names is the publishing node and the
+           node prefixes apply
+  **/
+  std::vector<std::string>
+  makeRegexes(const std::string& type, bool byNode) const;
+
+private:
+  // add prefix to prefixes unless covered, dropping the ones it covers
+  static void
+  addPrefix(std::vector<ndn::Name>& prefixes, const ndn::Name& prefix);
+
+  static bool
+  isUnder(const ndn::Name& name, const std::vector<ndn::Name>& prefixes);
+
+private:
+  std::vector<ndn::Name> m_services;
+  std::vector<ndn::Name> m_nodes;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_SUBSCRIPTION_FILTER_HPP
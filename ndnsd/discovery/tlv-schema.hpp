@@ -0,0 +1,525 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_TLV_SCHEMA_HPP
+#define NDNSD_TLV_SCHEMA_HPP
+
+#include <ndn-cxx/name.hpp>
+#include <ndn-cxx/encoding/block.hpp>
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/encoding/encoding-buffer.hpp>
+#include <ndn-cxx/encoding/tlv.hpp>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+
+namespace ndnsd {
+namespace discovery {
+namespace schema {
+
+/**
+  @brief Declarative TLV schema.
+
+  A schema is a list of Field<Type, &T::member, Codec> entries. Schema<OuterType, T, Fields...>
+  generates a two-pass (estimate, then prepend) encoder and a single-pass decoder that walks
+  the wire directly, without building Block element vectors and without throwing.
+
+  Unknown elements are skipped when their type is non-critical (even and > 31, see NDN
+  packet format 0.3) and rejected otherwise, so new optional fields must use even types.
+**/
+
+enum class DecodeStatus : uint8_t {
+  OK = 0,
+  WRONG_TYPE,
+  MALFORMED,
+  BAD_VALUE,
+  MISSING_FIELD,
+  UNKNOWN_CRITICAL,
+};
+
+inline const char*
+toString(DecodeStatus status)
+{
+  switch (status) {
+    case DecodeStatus::OK: return "ok";
+    case DecodeStatus::WRONG_TYPE: return "unexpected TLV type";
+    case DecodeStatus::MALFORMED: return "malformed TLV";
+    case DecodeStatus::BAD_VALUE: return "invalid field value";
+    case DecodeStatus::MISSING_FIELD: return "missing required field";
+    case DecodeStatus::UNKNOWN_CRITICAL: return "unknown critical TLV type";
+  }
+  return "unknown error";
+}
+
+template<typename T>
+class DecodeResult
+{
+public:
+  DecodeResult(T value)
+    : m_value(std::move(value))
+  {
+  }
+
+  static DecodeResult
+  failure(DecodeStatus status, uint32_t tlvType = 0)
+  {
+    return DecodeResult(status, tlvType);
+  }
+
+  explicit
+  operator bool() const
+  {
+    return m_status == DecodeStatus::OK;
+  }
+
+  DecodeStatus
+  status() const
+  {
+    return m_status;
+  }
+
+  // type of the offending element, 0 if not applicable
+  uint32_t
+  errorType() const
+  {
+    return m_errorType;
+  }
+
+  std::string
+  errorMessage() const
+  {
+    std::string msg = toString(m_status);
+    if (m_errorType != 0) {
+      msg += " (" + std::to_string(m_errorType) + ")";
+    }
+    return msg;
+  }
+
+  T&
+  operator*()
+  {
+    return *m_value;
+  }
+
+  const T&
+  operator*() const
+  {
+    return *m_value;
+  }
+
+  T*
+  operator->()
+  {
+    return &*m_value;
+  }
+
+  const T*
+  operator->() const
+  {
+    return &*m_value;
+  }
+
+private:
+  DecodeResult(DecodeStatus status, uint32_t tlvType)
+    : m_status(status)
+    , m_errorType(tlvType)
+  {
+  }
+
+private:
+  std::optional<T> m_value;
+  DecodeStatus m_status = DecodeStatus::OK;
+  uint32_t m_errorType = 0;
+};
+
+/**
+  @brief Non-throwing iterator over the TLV elements in [begin, end)
+**/
+class ElementReader
+{
+public:
+  ElementReader(const uint8_t* begin, const uint8_t* end)
+    : m_pos(begin)
+    , m_end(end)
+  {
+  }
+
+  /**
+    @brief advance to the next element
+    @return false at the end of input or on malformed input, see isMalformed()
+  **/
+  bool
+  next(uint32_t& type, const uint8_t*& valueBegin, const uint8_t*& valueEnd)
+  {
+    if (m_pos == m_end) {
+      return false;
+    }
+    uint64_t length = 0;
+    if (!ndn::tlv::readType(m_pos, m_end, type) ||
+        !ndn::tlv::readVarNumber(m_pos, m_end, length) ||
+        length > static_cast<uint64_t>(m_end - m_pos)) {
+      m_malformed = true;
+      return false;
+    }
+    valueBegin = m_pos;
+    m_pos += length;
+    valueEnd = m_pos;
+    return true;
+  }
+
+  bool
+  isMalformed() const
+  {
+    return m_malformed;
+  }
+
+private:
+  const uint8_t* m_pos;
+  const uint8_t* m_end;
+  bool m_malformed = false;
+};
+
+// Codecs: prepend(encoder, type, value) and read(begin, end, value) -> DecodeStatus.
+// isPresent() lets a codec omit a field, e.g. an empty name.
+
+struct StringCodec
+{
+  using value_type = std::string;
+
+  static bool
+  isPresent(const std::string&)
+  {
+    return true;
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, const std::string& value)
+  {
+    return ndn::encoding::prependStringBlock(encoder, type, value);
+  }
+
+  static DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, std::string& value)
+  {
+    value.assign(reinterpret_cast<const char*>(begin), end - begin);
+    return DecodeStatus::OK;
+  }
+};
+
+/**
+  @brief ndn::Name carried as its URI string, omitted when empty
+**/
+struct NameUriCodec
+{
+  using value_type = ndn::Name;
+
+  static bool
+  isPresent(const ndn::Name& name)
+  {
+    return !name.empty();
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, const ndn::Name& name)
+  {
+    return ndn::encoding::prependStringBlock(encoder, type, name.toUri());
+  }
+
+  static DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, ndn::Name& name)
+  {
+    // Name's URI parser is the only thing on this path that reports errors by throwing
+    try {
+      name = ndn::Name(std::string(reinterpret_cast<const char*>(begin), end - begin));
+    }
+    catch (const std::exception&) {
+      return DecodeStatus::BAD_VALUE;
+    }
+    return DecodeStatus::OK;
+  }
+};
+
+template<typename Int>
+struct NonNegativeIntegerCodec
+{
+  using value_type = Int;
+
+  static bool
+  isPresent(Int)
+  {
+    return true;
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, Int value)
+  {
+    return ndn::encoding::prependNonNegativeIntegerBlock(encoder, type, static_cast<uint64_t>(value));
+  }
+
+  static DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, Int& value)
+  {
+    size_t size = end - begin;
+    if (size != 1 && size != 2 && size != 4 && size != 8) {
+      return DecodeStatus::BAD_VALUE;
+    }
+    uint64_t number = 0;
+    for (; begin != end; ++begin) {
+      number = (number << 8) | *begin;
+    }
+    value = static_cast<Int>(number);
+    return DecodeStatus::OK;
+  }
+};
+
+/**
+  @brief string map carried as a sequence of <PairType><KeyType/><ValueType/></PairType>
+**/
+template<uint32_t PairType, uint32_t KeyType, uint32_t ValueType>
+struct StringMapCodec
+{
+  using value_type = std::map<std::string, std::string>;
+
+  static bool
+  isPresent(const value_type&)
+  {
+    return true;
+  }
+
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, uint32_t type, const value_type& map)
+  {
+    size_t totalLength = 0;
+    for (auto it = map.rbegin(); it != map.rend(); ++it) {
+      size_t pairLength = ndn::encoding::prependStringBlock(encoder, ValueType, it->second);
+      pairLength += ndn::encoding::prependStringBlock(encoder, KeyType, it->first);
+      pairLength += encoder.prependVarNumber(pairLength);
+      pairLength += encoder.prependVarNumber(PairType);
+      totalLength += pairLength;
+    }
+    totalLength += encoder.prependVarNumber(totalLength);
+    totalLength += encoder.prependVarNumber(type);
+    return totalLength;
+  }
+
+  static DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, value_type& map)
+  {
+    ElementReader pairs(begin, end);
+    uint32_t type = 0;
+    const uint8_t* pairBegin = nullptr;
+    const uint8_t* pairEnd = nullptr;
+    while (pairs.next(type, pairBegin, pairEnd)) {
+      if (type != PairType) {
+        if (ndn::tlv::isCriticalType(type)) {
+          return DecodeStatus::UNKNOWN_CRITICAL;
+        }
+        continue;
+      }
+
+      ElementReader elements(pairBegin, pairEnd);
+      const uint8_t* valueBegin = nullptr;
+      const uint8_t* valueEnd = nullptr;
+      std::optional<std::string> key;
+      std::optional<std::string> value;
+      while (elements.next(type, valueBegin, valueEnd)) {
+        if (type == KeyType) {
+          key.emplace(reinterpret_cast<const char*>(valueBegin), valueEnd - valueBegin);
+        }
+        else if (type == ValueType) {
+          value.emplace(reinterpret_cast<const char*>(valueBegin), valueEnd - valueBegin);
+        }
+        else if (ndn::tlv::isCriticalType(type)) {
+          return DecodeStatus::UNKNOWN_CRITICAL;
+        }
+      }
+      if (elements.isMalformed()) {
+        return DecodeStatus::MALFORMED;
+      }
+      if (!key || !value) {
+        return DecodeStatus::MISSING_FIELD;
+      }
+      map.insert_or_assign(std::move(*key), std::move(*value));
+    }
+    return pairs.isMalformed() ? DecodeStatus::MALFORMED : DecodeStatus::OK;
+  }
+};
+
+enum Presence : bool {
+  OPTIONAL_FIELD = false,
+  REQUIRED_FIELD = true,
+};
+
+template<uint32_t Type, auto Member, typename Codec, Presence P = OPTIONAL_FIELD>
+struct Field
+{
+  static constexpr uint32_t type = Type;
+  static constexpr bool isRequired = P;
+
+  template<typename T, ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, const T& object)
+  {
+    const auto& value = object.*Member;
+    if (!Codec::isPresent(value)) {
+      return 0;
+    }
+    return Codec::prepend(encoder, Type, value);
+  }
+
+  template<typename T>
+  static DecodeStatus
+  read(const uint8_t* begin, const uint8_t* end, T& object)
+  {
+    return Codec::read(begin, end, object.*Member);
+  }
+};
+
+template<uint32_t OuterType, typename T, typename... Fields>
+class Schema
+{
+public:
+  template<ndn::encoding::Tag TAG>
+  static size_t
+  prepend(ndn::EncodingImpl<TAG>& encoder, const T& object)
+  {
+    size_t totalLength = 0;
+    // fields are prepended, so walk them back to front to keep the declared order on the wire
+    prependReversed(encoder, object, totalLength, std::index_sequence_for<Fields...>{});
+    totalLength += encoder.prependVarNumber(totalLength);
+    totalLength += encoder.prependVarNumber(OuterType);
+    return totalLength;
+  }
+
+  static ndn::Block
+  encode(const T& object)
+  {
+    ndn::EncodingEstimator estimator;
+    size_t estimatedSize = prepend(estimator, object);
+
+    ndn::EncodingBuffer buffer(estimatedSize, 0);
+    prepend(buffer, object);
+    return buffer.block();
+  }
+
+  /**
+    @brief decode a complete TLV element (type, length and value)
+  **/
+  static DecodeResult<T>
+  decode(const uint8_t* begin, const uint8_t* end)
+  {
+    ElementReader outer(begin, end);
+    uint32_t type = 0;
+    const uint8_t* valueBegin = nullptr;
+    const uint8_t* valueEnd = nullptr;
+    if (!outer.next(type, valueBegin, valueEnd)) {
+      return DecodeResult<T>::failure(DecodeStatus::MALFORMED);
+    }
+    if (type != OuterType) {
+      return DecodeResult<T>::failure(DecodeStatus::WRONG_TYPE, type);
+    }
+    return decodeValue(valueBegin, valueEnd);
+  }
+
+  static DecodeResult<T>
+  decode(const ndn::Block& block)
+  {
+    if (block.type() != OuterType) {
+      return DecodeResult<T>::failure(DecodeStatus::WRONG_TYPE, block.type());
+    }
+    return decodeValue(block.value(), block.value() + block.value_size());
+  }
+
+  /**
+    @brief decode the value part of an element whose type has already been checked
+  **/
+  static DecodeResult<T>
+  decodeValue(const uint8_t* begin, const uint8_t* end)
+  {
+    T object{};
+    bool seen[sizeof...(Fields) + 1] = {};
+    ElementReader elements(begin, end);
+    uint32_t type = 0;
+    const uint8_t* valueBegin = nullptr;
+    const uint8_t* valueEnd = nullptr;
+
+    while (elements.next(type, valueBegin, valueEnd)) {
+      DecodeStatus status = DecodeStatus::UNKNOWN_CRITICAL;
+      bool matched = readMatching(type, valueBegin, valueEnd, object, seen, status,
+                                  std::index_sequence_for<Fields...>{});
+      if (!matched && !ndn::tlv::isCriticalType(type)) {
+        continue;
+      }
+      if (status != DecodeStatus::OK) {
+        return DecodeResult<T>::failure(status, type);
+      }
+    }
+    if (elements.isMalformed()) {
+      return DecodeResult<T>::failure(DecodeStatus::MALFORMED);
+    }
+
+    uint32_t missing = findMissing(seen, std::index_sequence_for<Fields...>{});
+    if (missing != 0) {
+      return DecodeResult<T>::failure(DecodeStatus::MISSING_FIELD, missing);
+    }
+    return DecodeResult<T>(std::move(object));
+  }
+
+private:
+  template<ndn::encoding::Tag TAG, size_t... I>
+  static void
+  prependReversed(ndn::EncodingImpl<TAG>& encoder, const T& object, size_t& totalLength,
+                  std::index_sequence<I...>)
+  {
+    using FieldList = std::tuple<Fields...>;
+    constexpr size_t n = sizeof...(Fields);
+    ((totalLength += std::tuple_element_t<n - 1 - I, FieldList>::prepend(encoder, object)), ...);
+  }
+
+  template<size_t... I>
+  static bool
+  readMatching(uint32_t type, const uint8_t* begin, const uint8_t* end, T& object,
+               bool* seen, DecodeStatus& status, std::index_sequence<I...>)
+  {
+    // short-circuits on the first field declared with this type
+    return ((type == Fields::type &&
+             (status = Fields::read(begin, end, object), seen[I] = true)) || ...);
+  }
+
+  template<size_t... I>
+  static uint32_t
+  findMissing(const bool* seen, std::index_sequence<I...>)
+  {
+    uint32_t missing = 0;
+    ((missing = (missing == 0 && Fields::isRequired && !seen[I]) ? Fields::type : missing), ...);
+    return missing;
+  }
+};
+
+} // namespace schema
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_TLV_SCHEMA_HPP
@@ -0,0 +1,290 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "trace-log.hpp"
+#include "tlv-schema.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace ndnsd {
+namespace discovery {
+
+std::atomic<TraceLog*> TraceLog::s_active{nullptr};
+std::atomic<uint32_t> TraceLog::s_nAppending{0};
+
+static uint32_t
+getThreadId()
+{
+  static std::atomic<uint32_t> nThreads{0};
+  thread_local uint32_t id = nThreads.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+TraceLog::TraceLog(size_t capacity)
+{
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  m_slots = std::make_unique<Slot[]>(size);
+  m_mask = size - 1;
+  for (size_t i = 0; i < size; ++i) {
+    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+TraceLog::~TraceLog()
+{
+  TraceLog* self = this;
+  if (s_active.compare_exchange_strong(self, nullptr)) {
+    // an appendActive() that counted itself before the exchange may still use this log
+    while (s_nAppending.load() != 0) {
+      std::this_thread::yield();
+    }
+  }
+  if (m_writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_isStopping = true;
+    }
+    m_stop.notify_one();
+    m_writer.join();
+  }
+  if (m_file != nullptr) {
+    std::fclose(m_file);
+  }
+}
+
+// append the TLV-VAR-NUMBER of value to buffer at offset, as far as it fits
+static void
+writeVarNumber(uint8_t* buffer, size_t& offset, uint64_t value)
+{
+  uint8_t bytes[9];
+  size_t size = 0;
+  if (value < 253) {
+    bytes[size++] = static_cast<uint8_t>(value);
+  }
+  else {
+    size_t width = value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8;
+    bytes[size++] = width == 2 ? 253 : width == 4 ? 254 : 255;
+    for (size_t i = width; i > 0; --i) {
+      bytes[size++] = static_cast<uint8_t>(value >> (8 * (i - 1)));
+    }
+  }
+  if (offset < TraceRecord::MAX_NAME_SIZE) {
+    std::memcpy(buffer + offset, bytes, std::min(size, TraceRecord::MAX_NAME_SIZE - offset));
+  }
+  offset += size;
+}
+
+void
+TraceLog::encodeName(const ndn::Name& name, TraceRecord& record)
+{
+  size_t size = 0;
+  if (name.hasWire()) {
+    // the cached wire, no encoding
+    const ndn::Block& wire = name.wireEncode();
+    size = wire.size();
+    std::memcpy(record.name, wire.data(), std::min(size, TraceRecord::MAX_NAME_SIZE));
+  }
+  else {
+    // encode the components straight into the record, without a Block
+    size_t valueSize = 0;
+    for (const auto& component : name) {
+      valueSize += ndn::tlv::sizeOfVarNumber(component.type()) +
+                   ndn::tlv::sizeOfVarNumber(component.value_size()) + component.value_size();
+    }
+    writeVarNumber(record.name, size, ndn::tlv::Name);
+    writeVarNumber(record.name, size, valueSize);
+    for (const auto& component : name) {
+      writeVarNumber(record.name, size, component.type());
+      writeVarNumber(record.name, size, component.value_size());
+      if (size < TraceRecord::MAX_NAME_SIZE) {
+        std::memcpy(record.name + size, component.value(),
+                    std::min(component.value_size(), TraceRecord::MAX_NAME_SIZE - size));
+      }
+      size += component.value_size();
+    }
+  }
+  record.nameSize = static_cast<uint16_t>(std::min<size_t>(size, UINT16_MAX));
+}
+
+bool
+TraceLog::appendActive(TraceEvent event, const ndn::Name& name, uint64_t arg0, uint64_t arg1)
+{
+  // sequentially consistent with the destructor: either it sees this call counted or this
+  // call sees the log deactivated
+  s_nAppending.fetch_add(1);
+  TraceLog* log = s_active.load();
+  if (log != nullptr) {
+    log->append(event, name, arg0, arg1);
+  }
+  s_nAppending.fetch_sub(1, std::memory_order_release);
+  return log != nullptr;
+}
+
+void
+TraceLog::append(TraceEvent event, const ndn::Name& name, uint64_t arg0, uint64_t arg1)
+{
+  // bounded MPMC queue of D. Vyukov: a slot is free for position pos when its sequence is
+  // pos, and holds the record of pos when it is pos + 1
+  uint64_t pos = m_head.load(std::memory_order_relaxed);
+  Slot* slot = nullptr;
+  while (true) {
+    slot = &m_slots[pos & m_mask];
+    uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+    auto diff = static_cast<int64_t>(sequence - pos);
+    if (diff == 0) {
+      if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    else if (diff < 0) {
+      m_nDropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else {
+      pos = m_head.load(std::memory_order_relaxed);
+    }
+  }
+
+  TraceRecord& record = slot->record;
+  auto now = ndn::time::system_clock::now().time_since_epoch();
+  record.timestamp = ndn::time::duration_cast<ndn::time::nanoseconds>(now).count();
+  record.thread = getThreadId();
+  record.event = event;
+  encodeName(name, record);
+  record.args[0] = arg0;
+  record.args[1] = arg1;
+
+  slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+size_t
+TraceLog::drain(const std::function<void(const TraceRecord&)>& sink)
+{
+  size_t nRecords = 0;
+  while (true) {
+    Slot& slot = m_slots[m_tail & m_mask];
+    if (slot.sequence.load(std::memory_order_acquire) != m_tail + 1) {
+      return nRecords;
+    }
+    sink(slot.record);
+    slot.sequence.store(m_tail + m_mask + 1, std::memory_order_release);
+    ++m_tail;
+    ++nRecords;
+  }
+}
+
+void
+TraceLog::startWriter(const std::string& path, ndn::time::milliseconds interval)
+{
+  m_file = std::fopen(path.data(), "wb");
+  if (m_file == nullptr) {
+    throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+  }
+  std::fwrite(FILE_MAGIC, sizeof(FILE_MAGIC), 1, m_file);
+  m_writer = std::thread([this, interval] { runWriter(interval); });
+}
+
+void
+TraceLog::runWriter(ndn::time::milliseconds interval)
+{
+  auto write = [this] (const TraceRecord& record) {
+    std::fwrite(&record, sizeof(record), 1, m_file);
+  };
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop.wait_for(lock, std::chrono::milliseconds(interval.count()),
+                          [this] { return m_isStopping; })) {
+    drain(write);
+    std::fflush(m_file);
+  }
+  drain(write);
+  std::fflush(m_file);
+}
+
+// name of the record, its last components are missing if it was truncated
+static std::string
+formatName(const TraceRecord& record)
+{
+  size_t size = std::min<size_t>(record.nameSize, TraceRecord::MAX_NAME_SIZE);
+  const uint8_t* begin = record.name;
+  const uint8_t* end = begin + size;
+  uint32_t type = 0;
+  uint64_t length = 0;
+  if (!ndn::tlv::readType(begin, end, type) || !ndn::tlv::readVarNumber(begin, end, length)) {
+    return "?";
+  }
+
+  std::ostringstream os;
+  schema::ElementReader components(begin, end);
+  const uint8_t* valueBegin = nullptr;
+  const uint8_t* valueEnd = nullptr;
+  while (components.next(type, valueBegin, valueEnd)) {
+    ndn::span<const uint8_t> value(valueBegin, static_cast<size_t>(valueEnd - valueBegin));
+    os << '/' << ndn::name::Component(type, value);
+  }
+  if (record.nameSize > TraceRecord::MAX_NAME_SIZE) {
+    os << "/...";
+  }
+  std::string uri = os.str();
+  return uri.empty() ? "/" : uri;
+}
+
+std::string
+TraceLog::format(const TraceRecord& record)
+{
+  const char* event = "unknown";
+  const char* arg0 = "arg0";
+  const char* arg1 = "arg1";
+  switch (record.event) {
+    case TraceEvent::SERVICE_UPDATE:
+      event = "service-update"; arg0 = "seq"; arg1 = "bytes";
+      break;
+    case TraceEvent::SERVICE_DISCOVERY:
+      event = "discovery"; arg0 = "seq"; arg1 = "services";
+      break;
+    case TraceEvent::DISCOVERY_SUPPRESSED:
+      event = "discovery-suppressed"; arg0 = "seq"; arg1 = "services";
+      break;
+    case TraceEvent::HEARTBEAT:
+      event = "heartbeat"; arg0 = "seq"; arg1 = "load";
+      break;
+    case TraceEvent::DECODE_FAILURE:
+      event = "decode-failure"; arg0 = "seq"; arg1 = "status";
+      break;
+    case TraceEvent::PUBLISH:
+      event = "publish"; arg0 = "seq"; arg1 = "bytes";
+      break;
+  }
+
+  std::ostringstream os;
+  os << record.timestamp / 1000000000 << '.' << std::setw(9) << std::setfill('0')
+     << record.timestamp % 1000000000 << std::setfill(' ') << " [" << record.thread << "] "
+     << event << ' ' << formatName(record) << ' ' << arg0 << '=' << record.args[0] << ' '
+     << arg1 << '=' << record.args[1];
+  return os.str();
+}
+
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,190 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_TRACE_LOG_HPP
+#define NDNSD_TRACE_LOG_HPP
+
+#include <ndn-cxx/name.hpp>
+#include <ndn-cxx/util/time.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ndnsd {
+namespace discovery {
+
+/**
+  @brief hot path events, see TraceLog::format() for the meaning of their arguments
+**/
+enum class TraceEvent : uint16_t {
+  SERVICE_UPDATE = 1,
+  SERVICE_DISCOVERY = 2,
+  DISCOVERY_SUPPRESSED = 3,
+  HEARTBEAT = 4,
+  DECODE_FAILURE = 5,
+  PUBLISH = 6,
+};
+
+/**
+  @brief one event as stored in the ring and in trace files, 128 bytes in host byte order
+**/
+struct TraceRecord
+{
+  static constexpr size_t MAX_NAME_SIZE = 96;
+
+  // nanoseconds since the epoch
+  uint64_t timestamp;
+  uint32_t thread;
+  TraceEvent event;
+  // size of the Name TLV, only the first MAX_NAME_SIZE bytes of it are in name
+  uint16_t nameSize;
+  uint64_t args[2];
+  uint8_t name[MAX_NAME_SIZE];
+};
+
+static_assert(sizeof(TraceRecord) == 128, "TraceRecord is written as is to trace files");
+
+/**
+  @brief lock-free ring of binary event records, formatted later or offline
+
+  append() copies the event into a fixed size slot of a bounded multi-producer queue (no
+  allocation, no formatting, no lock), and drops it if the ring is full rather than wait.
+  A single consumer takes records out with drain(), usually the writer thread started by
+  startWriter() that appends them to a trace file for ndnsd-trace.
+
+  The statements of NDNSD_LOG_EVENT go to the TraceLog made active with setActive(), through
+  appendActive(). The destructor deactivates the log and waits for the appendActive() calls
+  in flight on other threads, such as the shards of a ServiceDiscoveryPool; a log that
+  is only used through append() must outlive every thread calling it.
+**/
+class TraceLog
+{
+public:
+  /**
+    @param capacity number of records, rounded up to a power of two
+  **/
+  explicit
+  TraceLog(size_t capacity = 1 << 16);
+
+  ~TraceLog();
+
+  TraceLog(const TraceLog&) = delete;
+  TraceLog& operator=(const TraceLog&) = delete;
+
+  void
+  append(TraceEvent event, const ndn::Name& name, uint64_t arg0 = 0, uint64_t arg1 = 0);
+
+  /**
+    @brief append() to the active log, safely against its destruction
+    @return false if no log is active
+  **/
+  static bool
+  appendActive(TraceEvent event, const ndn::Name& name, uint64_t arg0 = 0, uint64_t arg1 = 0);
+
+  /**
+    @brief take the records out in order and pass them to sink, one consumer at a time
+    @return number of records taken
+  **/
+  size_t
+  drain(const std::function<void(const TraceRecord&)>& sink);
+
+  /**
+    @brief append the records to the trace file at path every interval, from a thread of
+           its own, until the TraceLog is destroyed
+    @throw std::runtime_error if the file cannot be opened
+  **/
+  void
+  startWriter(const std::string& path,
+              ndn::time::milliseconds interval = ndn::time::milliseconds(100));
+
+  // records dropped because the ring was full
+  uint64_t
+  getDropCount() const
+  {
+    return m_nDropped.load(std::memory_order_relaxed);
+  }
+
+  /**
+    @brief one line of text for record
+  **/
+  static std::string
+  format(const TraceRecord& record);
+
+  /**
+    @brief make log the target of NDNSD_LOG_EVENT, nullptr to go back to text logging
+  **/
+  static void
+  setActive(TraceLog* log)
+  {
+    s_active.store(log, std::memory_order_release);
+  }
+
+  static TraceLog*
+  getActive()
+  {
+    return s_active.load(std::memory_order_acquire);
+  }
+
+public:
+  // first bytes of a trace file, followed by records
+  static constexpr char FILE_MAGIC[8] = {'N', 'D', 'N', 'S', 'D', 'T', 'R', '1'};
+
+private:
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t> sequence;
+    TraceRecord record;
+  };
+
+  void
+  runWriter(ndn::time::milliseconds interval);
+
+  // the Name TLV of name into record, truncated to TraceRecord::MAX_NAME_SIZE, without
+  // allocating
+  static void
+  encodeName(const ndn::Name& name, TraceRecord& record);
+
+private:
+  std::unique_ptr<Slot[]> m_slots;
+  size_t m_mask;
+  alignas(64) std::atomic<uint64_t> m_head{0};
+  alignas(64) uint64_t m_tail = 0;
+  std::atomic<uint64_t> m_nDropped{0};
+
+  std::FILE* m_file = nullptr;
+  std::thread m_writer;
+  std::mutex m_mutex;
+  std::condition_variable m_stop;
+  bool m_isStopping = false;
+
+  static std::atomic<TraceLog*> s_active;
+  // appendActive() calls in flight, waited for by the destructor
+  static std::atomic<uint32_t> s_nAppending;
+};
+
+} // namespace discovery
+} // namespace ndnsd
+
+#endif // NDNSD_TRACE_LOG_HPP
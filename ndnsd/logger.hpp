@@ -0,0 +1,105 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2019,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * See AUTHORS.md for complete list of NDNSD authors and contributors.
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+/*! \file logger.hpp
+ * \brief Define macros and auxiliary functions for logging.
+ *
+ * This file defines the macros that NDNSD uses for logging
+ * messages. An intrepid hacker could replace this system cleanly by
+ * providing a system that redefines all of the _LOG_* macros with an
+ * arbitrary system, as long as the underlying system accepts strings.
+ *
+ * Statements below NDNSD_MIN_LOG_LEVEL, set with ./waf configure --min-log-level, are
+ * removed at compile time, arguments included. NDNSD_LOG_EVENT records hot path events in
+ * the active TraceLog, in binary and without formatting, and falls back to a debug
+ * statement when no TraceLog is active.
+ */
+
+#ifndef NDNSD_LOGGER_HPP
+#define NDNSD_LOGGER_HPP
+
+#include "ndnsd/config.hpp"
+#include "ndnsd/discovery/trace-log.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+#define NDNSD_LOG_LEVEL_TRACE 0
+#define NDNSD_LOG_LEVEL_DEBUG 1
+#define NDNSD_LOG_LEVEL_INFO 2
+#define NDNSD_LOG_LEVEL_WARN 3
+#define NDNSD_LOG_LEVEL_ERROR 4
+#define NDNSD_LOG_LEVEL_FATAL 5
+
+#ifndef NDNSD_MIN_LOG_LEVEL
+#define NDNSD_MIN_LOG_LEVEL NDNSD_LOG_LEVEL_TRACE
+#endif
+
+#define NDNSD_LOG_DISABLED(x) do {} while (false)
+
+#define INIT_LOGGER(name) NDN_LOG_INIT(ndnsd.name)
+
+#if NDNSD_MIN_LOG_LEVEL <= NDNSD_LOG_LEVEL_TRACE
+#define NDNSD_LOG_TRACE(x) NDN_LOG_TRACE(x)
+#else
+#define NDNSD_LOG_TRACE(x) NDNSD_LOG_DISABLED(x)
+#endif
+
+#if NDNSD_MIN_LOG_LEVEL <= NDNSD_LOG_LEVEL_DEBUG
+#define NDNSD_LOG_DEBUG(x) NDN_LOG_DEBUG(x)
+#define NDNSD_LOG_EVENT(event, name, arg0, arg1, x)                                        \
+  do {                                                                                   \
+    if (!::ndnsd::discovery::TraceLog::appendActive(::ndnsd::discovery::TraceEvent::event,  \
+                                                    name, arg0, arg1)) {                 \
+      NDN_LOG_DEBUG(x);                                                                  \
+    }                                                                                    \
+  } while (false)
+#else
+#define NDNSD_LOG_DEBUG(x) NDNSD_LOG_DISABLED(x)
+// the arguments stay referenced, not evaluated, so that variables kept for them are not unused
+#define NDNSD_LOG_EVENT(event, name, arg0, arg1, x)                                        \
+  do {                                                                                   \
+    if (false) {                                                                         \
+      static_cast<void>(name);                                                           \
+      static_cast<void>(arg0);                                                           \
+      static_cast<void>(arg1);                                                           \
+    }                                                                                    \
+  } while (false)
+#endif
+
+#if NDNSD_MIN_LOG_LEVEL <= NDNSD_LOG_LEVEL_INFO
+#define NDNSD_LOG_INFO(x) NDN_LOG_INFO(x)
+#else
+#define NDNSD_LOG_INFO(x) NDNSD_LOG_DISABLED(x)
+#endif
+
+#if NDNSD_MIN_LOG_LEVEL <= NDNSD_LOG_LEVEL_WARN
+#define NDNSD_LOG_WARN(x) NDN_LOG_WARN(x)
+#else
+#define NDNSD_LOG_WARN(x) NDNSD_LOG_DISABLED(x)
+#endif
+
+#if NDNSD_MIN_LOG_LEVEL <= NDNSD_LOG_LEVEL_ERROR
+#define NDNSD_LOG_ERROR(x) NDN_LOG_ERROR(x)
+#else
+#define NDNSD_LOG_ERROR(x) NDNSD_LOG_DISABLED(x)
+#endif
+
+#define NDNSD_LOG_FATAL(x) NDN_LOG_FATAL(x)
+
+#endif // NDNSD_LOGGER_HPP
@@ -0,0 +1,267 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "baseline-discovery.hpp"
+#include "ndnsd/logger.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <set>
+
+INIT_LOGGER(BaselineDiscovery);
+
+namespace ndnsd {
+namespace simulation {
+
+using ndnsd::discovery::Details;
+using ndnsd::discovery::DiscoveryCallback;
+
+static void
+onRegisterFailed(const ndn::Name& prefix, const std::string& reason)
+{
+  NDNSD_LOG_ERROR("Failed to register prefix " << prefix << ": " << reason);
+}
+
+static ndn::Data
+makeReply(const ndn::Name& name, const Details& details, ndn::KeyChain& keyChain)
+{
+  ndn::Data data(name);
+  ndn::Block block = details.encode();
+  data.setContent(ndn::span<const uint8_t>(block.data(), block.size()));
+  data.setFreshnessPeriod(ndn::time::milliseconds(2));
+  keyChain.sign(data, ndn::security::signingWithSha256());
+  return data;
+}
+
+static std::optional<Details>
+decodeReply(const ndn::Data& data)
+{
+  const ndn::Block& content = data.getContent();
+  auto result = Details::tryDecode(content.value(), content.value() + content.value_size());
+  if (!result) {
+    NDNSD_LOG_DEBUG("Invalid service info in " << data.getName() << ": " << result.errorMessage());
+    return std::nullopt;
+  }
+  return std::move(*result);
+}
+
+ProactiveDiscovery::ProactiveDiscovery(ndn::Face& face, ndn::KeyChain& keyChain,
+                                       const DiscoveryCallback& callback,
+                                       const BaselineOptions& options)
+  : m_face(face)
+  , m_keyChain(keyChain)
+  , m_scheduler(face.getIoService())
+  , m_callback(callback)
+  , m_options(options)
+{
+  m_discoveryPrefix = m_face.setInterestFilter(
+    ndn::InterestFilter(m_options.discoveryPrefix).allowLoopback(false),
+    [this] (const ndn::InterestFilter&, const ndn::Interest& interest) {
+      onAnnouncement(interest);
+    },
+    onRegisterFailed);
+}
+
+void
+ProactiveDiscovery::publish(const Details& details)
+{
+  auto [it, isNew] = m_services.try_emplace(details.applicationPrefix);
+  Service& service = it->second;
+  service.details = details;
+  ++service.version;
+  if (isNew) {
+    service.prefix = m_face.setInterestFilter(
+      ndn::InterestFilter(details.applicationPrefix).allowLoopback(false),
+      [this, &service] (const ndn::InterestFilter&, const ndn::Interest& interest) {
+        onFetch(service, interest);
+      },
+      onRegisterFailed);
+  }
+  announce(service);
+}
+
+void
+ProactiveDiscovery::announce(Service& service)
+{
+  ndn::Interest interest(ndn::Name(m_options.discoveryPrefix)
+                           .append(service.details.applicationPrefix)
+                           .appendNumber(service.version));
+  interest.setCanBePrefix(true);
+  interest.setInterestLifetime(m_options.interestLifetime);
+  // announcements are never answered
+  m_face.expressInterest(interest, nullptr, nullptr, nullptr);
+
+  service.announceEvent = m_scheduler.schedule(m_options.interval,
+                                               [this, &service] { announce(service); });
+}
+
+void
+ProactiveDiscovery::onAnnouncement(const ndn::Interest& interest)
+{
+  // <discoveryPrefix>/<applicationPrefix>/<version>
+  const ndn::Name& name = interest.getName();
+  size_t prefixSize = m_options.discoveryPrefix.size();
+  if (name.size() < prefixSize + 2 || !name[-1].isNumber()) {
+    return;
+  }
+  ndn::Name applicationPrefix = name.getSubName(prefixSize, name.size() - prefixSize - 1);
+  uint64_t version = name[-1].toNumber();
+  uint64_t& fetching = m_fetching[applicationPrefix];
+  if (version <= fetching) {
+    return;
+  }
+  fetching = version;
+
+  ndn::Interest fetch(ndn::Name(applicationPrefix).appendNumber(version));
+  fetch.setInterestLifetime(m_options.interestLifetime);
+  m_face.expressInterest(fetch,
+                         [this] (const ndn::Interest&, const ndn::Data& data) { onData(data); },
+                         [this, applicationPrefix] (const ndn::Interest&, const ndn::lp::Nack&) {
+                           // fetch again on the next announcement
+                           m_fetching[applicationPrefix] = m_known[applicationPrefix];
+                         },
+                         [this, applicationPrefix] (const ndn::Interest&) {
+                           m_fetching[applicationPrefix] = m_known[applicationPrefix];
+                         });
+}
+
+void
+ProactiveDiscovery::onFetch(const Service& service, const ndn::Interest& interest)
+{
+  m_face.put(makeReply(interest.getName(), service.details, m_keyChain));
+}
+
+void
+ProactiveDiscovery::onData(const ndn::Data& data)
+{
+  auto details = decodeReply(data);
+  if (!details || !data.getName()[-1].isNumber()) {
+    return;
+  }
+  uint64_t version = data.getName()[-1].toNumber();
+  uint64_t& known = m_known[details->applicationPrefix];
+  if (version <= known) {
+    return;
+  }
+  known = version;
+  m_callback(*details);
+}
+
+ReactiveDiscovery::ReactiveDiscovery(ndn::Face& face, ndn::KeyChain& keyChain,
+                                     const DiscoveryCallback& callback,
+                                     const BaselineOptions& options)
+  : m_face(face)
+  , m_keyChain(keyChain)
+  , m_scheduler(face.getIoService())
+  , m_callback(callback)
+  , m_options(options)
+{
+  startRound();
+}
+
+void
+ReactiveDiscovery::publish(const Details& details)
+{
+  Service& service = m_services[details.applicationPrefix];
+  service.details = details;
+  ++service.version;
+  // producers only answer once they have something to offer
+  if (m_services.size() == 1 && service.version == 1) {
+    m_discoveryPrefix = m_face.setInterestFilter(
+      ndn::InterestFilter(m_options.discoveryPrefix).allowLoopback(false),
+      [this] (const ndn::InterestFilter&, const ndn::Interest& interest) { onQuery(interest); },
+      onRegisterFailed);
+  }
+}
+
+void
+ReactiveDiscovery::startRound()
+{
+  // a round still running when the next one is due continues instead
+  if (!m_isQuerying) {
+    m_isQuerying = true;
+    m_excluded.clear();
+    query();
+  }
+  m_roundEvent = m_scheduler.schedule(m_options.interval, [this] { startRound(); });
+}
+
+void
+ReactiveDiscovery::query()
+{
+  ndn::Name name(m_options.discoveryPrefix);
+  for (const auto& producer : m_excluded) {
+    name.append(producer.toUri());
+  }
+  ndn::Interest interest(name);
+  interest.setCanBePrefix(true);
+  interest.setMustBeFresh(true);
+  interest.setInterestLifetime(m_options.interestLifetime);
+  m_face.expressInterest(interest,
+                         [this] (const ndn::Interest&, const ndn::Data& data) { onData(data); },
+                         [this] (const ndn::Interest&, const ndn::lp::Nack&) {
+                           m_isQuerying = false;
+                         },
+                         [this] (const ndn::Interest&) {
+                           // under stable conditions every round ends with a timeout
+                           m_isQuerying = false;
+                         });
+}
+
+void
+ReactiveDiscovery::onQuery(const ndn::Interest& interest)
+{
+  // <discoveryPrefix>/<excluded applicationPrefix>...
+  const ndn::Name& name = interest.getName();
+  std::set<std::string> excluded;
+  for (size_t i = m_options.discoveryPrefix.size(); i < name.size(); ++i) {
+    excluded.insert(ndn::encoding::readString(name[i]));
+  }
+  for (const auto& [applicationPrefix, service] : m_services) {
+    if (excluded.count(applicationPrefix.toUri()) == 0) {
+      // a single answer per query, the next one excludes this service
+      m_face.put(makeReply(ndn::Name(name).append(applicationPrefix.toUri())
+                             .appendNumber(service.version),
+                           service.details, m_keyChain));
+      return;
+    }
+  }
+}
+
+void
+ReactiveDiscovery::onData(const ndn::Data& data)
+{
+  auto details = decodeReply(data);
+  if (!details || !data.getName()[-1].isNumber()) {
+    m_isQuerying = false;
+    return;
+  }
+  m_excluded.push_back(details->applicationPrefix);
+
+  uint64_t version = data.getName()[-1].toNumber();
+  uint64_t& known = m_known[details->applicationPrefix];
+  if (version > known) {
+    known = version;
+    m_callback(*details);
+  }
+  query();
+}
+
+} // namespace simulation
+} // namespace ndnsd
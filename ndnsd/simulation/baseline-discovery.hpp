@@ -0,0 +1,163 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_BASELINE_DISCOVERY_HPP
+#define NDNSD_BASELINE_DISCOVERY_HPP
+
+#include "simulator.hpp"
+
+#include <ndn-cxx/face.hpp>
+#include <ndn-cxx/security/key-chain.hpp>
+
+namespace ndnsd {
+namespace simulation {
+
+struct BaselineOptions
+{
+  // prefix consumers listen on for announcements, or producers answer queries on
+  ndn::Name discoveryPrefix = "/uofm/discovery/printer";
+  // period of the announcements of a producer, or of the query rounds of a consumer
+  ndn::time::milliseconds interval = ndn::time::seconds(1);
+  ndn::time::milliseconds interestLifetime = ndn::time::seconds(1);
+};
+
+/**
+  @brief proactive discovery of comparision/proactive, as a simulated node
+
+  A producer announces each of its services with a notification Interest
+  <discoveryPrefix>/<applicationPrefix>/<version> every interval, and at once when the
+  service is published again. Consumers listen on discoveryPrefix and fetch
+  <applicationPrefix>/<version> when the version is new to them, the producer answers
+  with the ServiceInfo TLV. Every node is a consumer.
+**/
+class ProactiveDiscovery : public Application
+{
+public:
+  ProactiveDiscovery(ndn::Face& face, ndn::KeyChain& keyChain,
+                     const ndnsd::discovery::DiscoveryCallback& callback,
+                     const BaselineOptions& options = {});
+
+  void
+  publish(const ndnsd::discovery::Details& details) final;
+
+  size_t
+  getServiceCount() const final
+  {
+    return m_known.size();
+  }
+
+private:
+  struct Service
+  {
+    ndnsd::discovery::Details details;
+    uint64_t version = 0;
+    ndn::ScopedRegisteredPrefixHandle prefix;
+    ndn::scheduler::ScopedEventId announceEvent;
+  };
+
+  void
+  announce(Service& service);
+
+  void
+  onAnnouncement(const ndn::Interest& interest);
+
+  void
+  onFetch(const Service& service, const ndn::Interest& interest);
+
+  void
+  onData(const ndn::Data& data);
+
+private:
+  ndn::Face& m_face;
+  ndn::KeyChain& m_keyChain;
+  ndn::Scheduler m_scheduler;
+  ndnsd::discovery::DiscoveryCallback m_callback;
+  BaselineOptions m_options;
+  ndn::ScopedRegisteredPrefixHandle m_discoveryPrefix;
+
+  // published services, by applicationPrefix
+  std::map<ndn::Name, Service> m_services;
+  // latest version received or being fetched, by applicationPrefix
+  std::map<ndn::Name, uint64_t> m_known;
+  std::map<ndn::Name, uint64_t> m_fetching;
+};
+
+/**
+  @brief reactive discovery of comparision/reactive, as a simulated node
+
+  Producers answer Interests for discoveryPrefix with their ServiceInfo, unless their
+  applicationPrefix is one of the components following discoveryPrefix. Every interval a
+  consumer starts a query round: it asks discoveryPrefix, then again excluding every
+  producer that answered, until the query times out. Every node is a consumer.
+**/
+class ReactiveDiscovery : public Application
+{
+public:
+  ReactiveDiscovery(ndn::Face& face, ndn::KeyChain& keyChain,
+                    const ndnsd::discovery::DiscoveryCallback& callback,
+                    const BaselineOptions& options = {});
+
+  void
+  publish(const ndnsd::discovery::Details& details) final;
+
+  size_t
+  getServiceCount() const final
+  {
+    return m_known.size();
+  }
+
+private:
+  struct Service
+  {
+    ndnsd::discovery::Details details;
+    uint64_t version = 0;
+  };
+
+  void
+  startRound();
+
+  void
+  query();
+
+  void
+  onQuery(const ndn::Interest& interest);
+
+  void
+  onData(const ndn::Data& data);
+
+private:
+  ndn::Face& m_face;
+  ndn::KeyChain& m_keyChain;
+  ndn::Scheduler m_scheduler;
+  ndnsd::discovery::DiscoveryCallback m_callback;
+  BaselineOptions m_options;
+  ndn::ScopedRegisteredPrefixHandle m_discoveryPrefix;
+  ndn::scheduler::ScopedEventId m_roundEvent;
+
+  std::map<ndn::Name, Service> m_services;
+  std::map<ndn::Name, uint64_t> m_known;
+  // producers that answered in the current round
+  std::vector<ndn::Name> m_excluded;
+  bool m_isQuerying = false;
+};
+
+} // namespace simulation
+} // namespace ndnsd
+
+#endif // NDNSD_BASELINE_DISCOVERY_HPP
@@ -0,0 +1,338 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "simulated-network.hpp"
+#include "ndnsd/logger.hpp"
+
+#include <ndn-cxx/mgmt/nfd/control-parameters.hpp>
+
+#include <algorithm>
+
+INIT_LOGGER(SimulatedNetwork);
+
+namespace ndnsd {
+namespace simulation {
+
+static const ndn::Name RIB_COMMAND_PREFIX("/localhost/nfd/rib");
+static const ndn::Name LOCALHOST_PREFIX("/localhost");
+
+PacketCounters&
+PacketCounters::operator+=(const PacketCounters& other)
+{
+  nInterestsSent += other.nInterestsSent;
+  nDataSent += other.nDataSent;
+  nNacksSent += other.nNacksSent;
+  nBytesSent += other.nBytesSent;
+  nInterestsReceived += other.nInterestsReceived;
+  nDataReceived += other.nDataReceived;
+  nNacksReceived += other.nNacksReceived;
+  nBytesReceived += other.nBytesReceived;
+  nLost += other.nLost;
+  return *this;
+}
+
+static void
+countReceived(PacketCounters& counters, const ndn::Interest&)
+{
+  ++counters.nInterestsReceived;
+}
+
+static void
+countReceived(PacketCounters& counters, const ndn::Data&)
+{
+  ++counters.nDataReceived;
+}
+
+static void
+countReceived(PacketCounters& counters, const ndn::lp::Nack&)
+{
+  ++counters.nNacksReceived;
+}
+
+SimulatedNetwork::SimulatedNetwork(boost::asio::io_service& io, size_t nNodes,
+                                   const LinkOptions& options)
+  : m_scheduler(io)
+  , m_options(options)
+  , m_random(options.seed)
+  , m_nodes(nNodes)
+{
+  removeExpiredPitEntries();
+}
+
+void
+SimulatedNetwork::attach(size_t node, ndn::DummyClientFace& face)
+{
+  if (isAttached(node)) {
+    detach(node);
+  }
+  Node& entry = m_nodes.at(node);
+  entry.face = &face;
+  entry.connections.emplace_back(face.onSendInterest.connect(
+    [this, node] (const ndn::Interest& interest) { onSendInterest(node, interest); }));
+  entry.connections.emplace_back(face.onSendData.connect(
+    [this, node] (const ndn::Data& data) { onSendData(node, data); }));
+  entry.connections.emplace_back(face.onSendNack.connect(
+    [this, node] (const ndn::lp::Nack& nack) { onSendNack(node, nack); }));
+}
+
+void
+SimulatedNetwork::detach(size_t node)
+{
+  Node& entry = m_nodes.at(node);
+  entry.connections.clear();
+  entry.face = nullptr;
+  ++entry.generation;
+
+  for (auto it = m_fib.begin(); it != m_fib.end();) {
+    auto& nexthops = it->second;
+    nexthops.erase(std::remove(nexthops.begin(), nexthops.end(), node), nexthops.end());
+    it = nexthops.empty() ? m_fib.erase(it) : std::next(it);
+  }
+  for (auto it = m_pit.begin(); it != m_pit.end();) {
+    auto& entries = it->second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [node] (const PitEntry& e) { return e.node == node; }),
+                  entries.end());
+    it = entries.empty() ? m_pit.erase(it) : std::next(it);
+  }
+}
+
+void
+SimulatedNetwork::setPartition(size_t node, uint32_t partition)
+{
+  m_nodes.at(node).partition = partition;
+}
+
+void
+SimulatedNetwork::heal()
+{
+  for (auto& node : m_nodes) {
+    node.partition = 0;
+  }
+}
+
+void
+SimulatedNetwork::setLinkOptions(const LinkOptions& options)
+{
+  // keep the random sequence, a workload changing the links stays reproducible
+  m_options = options;
+}
+
+void
+SimulatedNetwork::onSendInterest(size_t node, const ndn::Interest& interest)
+{
+  if (LOCALHOST_PREFIX.isPrefixOf(interest.getName())) {
+    onCommand(node, interest);
+    return;
+  }
+
+  size_t size = interest.wireEncode().size();
+  PacketCounters& counters = m_nodes[node].counters;
+  ++counters.nInterestsSent;
+  counters.nBytesSent += size;
+
+  auto nexthops = lookupFib(interest.getName(), node);
+  if (nexthops.empty()) {
+    NDNSD_LOG_TRACE("No route for " << interest.getName() << " from node " << node);
+    return;
+  }
+  m_pit[interest.getName()].push_back({node, interest.getCanBePrefix(),
+                                       ndn::time::steady_clock::now() +
+                                         interest.getInterestLifetime()});
+  deliver(node, nexthops, interest, size);
+}
+
+void
+SimulatedNetwork::onSendData(size_t node, const ndn::Data& data)
+{
+  size_t size = data.wireEncode().size();
+  PacketCounters& counters = m_nodes[node].counters;
+  ++counters.nDataSent;
+  counters.nBytesSent += size;
+
+  auto requesters = satisfy(data.getName(), false);
+  requesters.erase(std::remove(requesters.begin(), requesters.end(), node), requesters.end());
+  deliver(node, requesters, data, size);
+}
+
+void
+SimulatedNetwork::onSendNack(size_t node, const ndn::lp::Nack& nack)
+{
+  size_t size = nack.getInterest().wireEncode().size();
+  PacketCounters& counters = m_nodes[node].counters;
+  ++counters.nNacksSent;
+  counters.nBytesSent += size;
+
+  auto requesters = satisfy(nack.getInterest().getName(), true);
+  requesters.erase(std::remove(requesters.begin(), requesters.end(), node), requesters.end());
+  deliver(node, requesters, nack, size);
+}
+
+void
+SimulatedNetwork::onCommand(size_t node, const ndn::Interest& interest)
+{
+  // /localhost/nfd/rib/<verb>/<ControlParameters>/..., answered by the face itself
+  const ndn::Name& name = interest.getName();
+  if (!RIB_COMMAND_PREFIX.isPrefixOf(name) || name.size() <= 4) {
+    return;
+  }
+  ndn::nfd::ControlParameters parameters;
+  try {
+    parameters.wireDecode(name[4].blockFromValue());
+  }
+  catch (const std::exception& e) {
+    NDNSD_LOG_DEBUG("Invalid command " << name << ": " << e.what());
+    return;
+  }
+  if (!parameters.hasName()) {
+    return;
+  }
+
+  const ndn::Name& prefix = parameters.getName();
+  if (name[3] == ndn::name::Component("register")) {
+    auto& nexthops = m_fib[prefix];
+    if (std::find(nexthops.begin(), nexthops.end(), node) == nexthops.end()) {
+      nexthops.push_back(node);
+    }
+    NDNSD_LOG_TRACE("Node " << node << " registered " << prefix);
+  }
+  else if (name[3] == ndn::name::Component("unregister")) {
+    auto it = m_fib.find(prefix);
+    if (it != m_fib.end()) {
+      auto& nexthops = it->second;
+      nexthops.erase(std::remove(nexthops.begin(), nexthops.end(), node), nexthops.end());
+      if (nexthops.empty()) {
+        m_fib.erase(it);
+      }
+    }
+  }
+}
+
+template<typename Packet>
+void
+SimulatedNetwork::deliver(size_t from, const std::vector<size_t>& to, const Packet& packet,
+                          size_t size)
+{
+  // one event per arrival time rather than per receiver, multicast to a large group is
+  // the common case
+  std::map<ndn::time::milliseconds, std::vector<std::pair<size_t, uint64_t>>> arrivals;
+  std::uniform_real_distribution<double> loss;
+  for (size_t node : to) {
+    Node& receiver = m_nodes[node];
+    if (receiver.face == nullptr) {
+      continue;
+    }
+    if (receiver.partition != m_nodes[from].partition ||
+        (m_options.lossRate > 0 && loss(m_random) < m_options.lossRate)) {
+      ++receiver.counters.nLost;
+      continue;
+    }
+    auto delay = m_options.latency;
+    if (m_options.jitter > ndn::time::milliseconds::zero()) {
+      std::uniform_int_distribution<ndn::time::milliseconds::rep> jitter(0, m_options.jitter.count());
+      delay += ndn::time::milliseconds(jitter(m_random));
+    }
+    arrivals[delay].emplace_back(node, receiver.generation);
+  }
+
+  auto shared = std::make_shared<Packet>(packet);
+  for (auto& [delay, receivers] : arrivals) {
+    m_scheduler.schedule(delay, [this, shared, size, receivers = std::move(receivers)] {
+      for (const auto& [node, generation] : receivers) {
+        Node& receiver = m_nodes[node];
+        if (receiver.face == nullptr || receiver.generation != generation) {
+          continue;
+        }
+        countReceived(receiver.counters, *shared);
+        receiver.counters.nBytesReceived += size;
+        receiver.face->receive(*shared);
+      }
+    });
+  }
+}
+
+std::vector<size_t>
+SimulatedNetwork::lookupFib(const ndn::Name& name, size_t from) const
+{
+  for (size_t length = name.size() + 1; length-- > 0;) {
+    auto it = m_fib.find(name.getPrefix(static_cast<ssize_t>(length)));
+    if (it == m_fib.end()) {
+      continue;
+    }
+    std::vector<size_t> nexthops;
+    for (size_t node : it->second) {
+      if (node != from) {
+        nexthops.push_back(node);
+      }
+    }
+    return nexthops;
+  }
+  return {};
+}
+
+std::vector<size_t>
+SimulatedNetwork::satisfy(const ndn::Name& name, bool isExact)
+{
+  std::vector<size_t> requesters;
+  auto now = ndn::time::steady_clock::now();
+  size_t minLength = isExact ? name.size() : 0;
+  for (size_t length = name.size() + 1; length-- > minLength;) {
+    auto it = m_pit.find(name.getPrefix(static_cast<ssize_t>(length)));
+    if (it == m_pit.end()) {
+      continue;
+    }
+    bool isPrefix = length < name.size();
+    auto& entries = it->second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&] (const PitEntry& entry) {
+                    if (entry.expiry < now) {
+                      return true;
+                    }
+                    if (isPrefix && !entry.canBePrefix) {
+                      return false;
+                    }
+                    requesters.push_back(entry.node);
+                    return true;
+                  }),
+                  entries.end());
+    if (entries.empty()) {
+      m_pit.erase(it);
+    }
+  }
+  std::sort(requesters.begin(), requesters.end());
+  requesters.erase(std::unique(requesters.begin(), requesters.end()), requesters.end());
+  return requesters;
+}
+
+void
+SimulatedNetwork::removeExpiredPitEntries()
+{
+  auto now = ndn::time::steady_clock::now();
+  for (auto it = m_pit.begin(); it != m_pit.end();) {
+    auto& entries = it->second;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [now] (const PitEntry& e) { return e.expiry < now; }),
+                  entries.end());
+    it = entries.empty() ? m_pit.erase(it) : std::next(it);
+  }
+  m_pitCleanupEvent = m_scheduler.schedule(ndn::time::seconds(1),
+                                           [this] { removeExpiredPitEntries(); });
+}
+
+} // namespace simulation
+} // namespace ndnsd
@@ -0,0 +1,187 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SIMULATED_NETWORK_HPP
+#define NDNSD_SIMULATED_NETWORK_HPP
+
+#include <ndn-cxx/util/dummy-client-face.hpp>
+#include <ndn-cxx/util/scheduler.hpp>
+#include <ndn-cxx/util/signal.hpp>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace ndnsd {
+namespace simulation {
+
+struct LinkOptions
+{
+  // one-way delay of every delivery
+  ndn::time::milliseconds latency = ndn::time::milliseconds(10);
+  // uniform extra delay in [0, jitter]
+  ndn::time::milliseconds jitter = ndn::time::milliseconds(0);
+  // probability that a delivery is dropped
+  double lossRate = 0;
+  uint64_t seed = 1;
+};
+
+struct PacketCounters
+{
+  uint64_t nInterestsSent = 0;
+  uint64_t nDataSent = 0;
+  uint64_t nNacksSent = 0;
+  uint64_t nBytesSent = 0;
+  uint64_t nInterestsReceived = 0;
+  uint64_t nDataReceived = 0;
+  uint64_t nNacksReceived = 0;
+  uint64_t nBytesReceived = 0;
+  // deliveries to this node dropped by loss or partitions
+  uint64_t nLost = 0;
+
+  PacketCounters&
+  operator+=(const PacketCounters& other);
+};
+
+/**
+  @brief One-hop broadcast network between DummyClientFaces
+
+  Stands in for the forwarders: the prefixes a face registers form a FIB, an Interest is
+  delivered to every other face registered under its longest matching prefix, and Data
+  and Nacks follow the PIT back to the faces whose Interests they satisfy. Every delivery
+  goes through the link model, delayed by LinkOptions and dropped at random or when the
+  two nodes are in different partitions.
+
+  Nodes are numbered 0 .. nNodes-1 and keep their counters over detach() and attach(), so
+  a restarted node is attached with a new face under the same number. Deliveries are
+  scheduled on the io_service, set ndn::time custom clocks to run them on simulated time.
+**/
+class SimulatedNetwork
+{
+public:
+  SimulatedNetwork(boost::asio::io_service& io, size_t nNodes, const LinkOptions& options = {});
+
+  SimulatedNetwork(const SimulatedNetwork&) = delete;
+  SimulatedNetwork& operator=(const SimulatedNetwork&) = delete;
+
+  /**
+    @brief connect face as node, the face must use Options::enableRegistrationReply
+  **/
+  void
+  attach(size_t node, ndn::DummyClientFace& face);
+
+  /**
+    @brief disconnect the face of node, dropping its routes and pending deliveries
+  **/
+  void
+  detach(size_t node);
+
+  bool
+  isAttached(size_t node) const
+  {
+    return m_nodes.at(node).face != nullptr;
+  }
+
+  /**
+    @brief nodes only reach nodes of the same partition, all start in partition 0
+  **/
+  void
+  setPartition(size_t node, uint32_t partition);
+
+  void
+  heal();
+
+  void
+  setLinkOptions(const LinkOptions& options);
+
+  const PacketCounters&
+  getCounters(size_t node) const
+  {
+    return m_nodes.at(node).counters;
+  }
+
+  size_t
+  size() const
+  {
+    return m_nodes.size();
+  }
+
+private:
+  struct Node
+  {
+    ndn::DummyClientFace* face = nullptr;
+    // invalidates deliveries scheduled for a previous face of the node
+    uint64_t generation = 0;
+    uint32_t partition = 0;
+    std::vector<ndn::signal::ScopedConnection> connections;
+    PacketCounters counters;
+  };
+
+  struct PitEntry
+  {
+    size_t node;
+    bool canBePrefix;
+    ndn::time::steady_clock::time_point expiry;
+  };
+
+  void
+  onSendInterest(size_t node, const ndn::Interest& interest);
+
+  void
+  onSendData(size_t node, const ndn::Data& data);
+
+  void
+  onSendNack(size_t node, const ndn::lp::Nack& nack);
+
+  // handle the prefix registration commands of the face
+  void
+  onCommand(size_t node, const ndn::Interest& interest);
+
+  // deliver packet from one node to others, through the link model
+  template<typename Packet>
+  void
+  deliver(size_t from, const std::vector<size_t>& to, const Packet& packet, size_t size);
+
+  std::vector<size_t>
+  lookupFib(const ndn::Name& name, size_t from) const;
+
+  // remove the PIT entries satisfied by name, only those of exactly name if isExact, and
+  // return the nodes that were waiting
+  std::vector<size_t>
+  satisfy(const ndn::Name& name, bool isExact);
+
+  void
+  removeExpiredPitEntries();
+
+private:
+  ndn::Scheduler m_scheduler;
+  LinkOptions m_options;
+  std::mt19937_64 m_random;
+
+  std::vector<Node> m_nodes;
+  std::map<ndn::Name, std::vector<size_t>> m_fib;
+  std::map<ndn::Name, std::vector<PitEntry>> m_pit;
+  ndn::scheduler::ScopedEventId m_pitCleanupEvent;
+};
+
+} // namespace simulation
+} // namespace ndnsd
+
+#endif // NDNSD_SIMULATED_NETWORK_HPP
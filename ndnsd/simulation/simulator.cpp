@@ -0,0 +1,464 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "simulator.hpp"
+
+#include "ndnsd/logger.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+INIT_LOGGER(Simulator);
+
+namespace ndnsd {
+namespace simulation {
+
+using ndnsd::discovery::Details;
+using ndnsd::discovery::ServiceDiscovery;
+using ndnsd::discovery::ServiceDiscoveryOptions;
+using ndnsd::discovery::ServiceRegistry;
+
+// serviceMetaInfo key carrying the publication id, to tell versions of a service apart
+static const std::string PUBLICATION_KEY = "sim-publication";
+
+namespace {
+
+class DiscoveryApplication : public Application
+{
+public:
+  DiscoveryApplication(const ndn::Name& groupName, const ndn::Name& nodeName,
+                       ndn::Face& face, ndn::KeyChain& keyChain,
+                       const ndnsd::discovery::DiscoveryCallback& callback,
+                       const ServiceDiscoveryOptions& options)
+    : m_discovery(groupName, nodeName, face, keyChain, callback, options)
+  {
+  }
+
+  void
+  publish(const Details& details) final
+  {
+    m_discovery.publishServiceDetail(details);
+  }
+
+  size_t
+  getServiceCount() const final
+  {
+    return m_discovery.getRegistry().size();
+  }
+
+  ServiceDiscovery*
+  getDiscovery() final
+  {
+    return &m_discovery;
+  }
+
+private:
+  ServiceDiscovery m_discovery;
+};
+
+} // namespace
+
+static double
+toMilliseconds(ndn::time::steady_clock::duration d)
+{
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+Simulator::Simulator(const SimulatorOptions& options)
+  : m_options(options)
+  , m_steadyClock(std::make_shared<ndn::time::UnitTestSteadyClock>())
+  , m_systemClock(std::make_shared<ndn::time::UnitTestSystemClock>())
+  , m_keyChain("pib-memory:", "tpm-memory:")
+  , m_scheduler(m_io)
+  , m_network(m_io, options.nNodes, options.link)
+  , m_random(options.link.seed)
+  , m_nodes(options.nNodes)
+{
+  ndn::time::setCustomClocks(m_steadyClock, m_systemClock);
+  m_startTime = ndn::time::steady_clock::now();
+  // the latency histograms of the group, rather than of each node
+  if (!m_options.discovery.metrics) {
+    m_options.discovery.metrics = std::make_shared<ndnsd::discovery::Metrics>();
+  }
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    // short names, every one of them is in each sync Interest
+    m_nodes[i].name = ndn::Name("/node" + std::to_string(i));
+  }
+}
+
+Simulator::~Simulator()
+{
+  m_scheduler.cancelAllEvents();
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    stop(i);
+  }
+  // destroy the faces, after the handlers they posted
+  m_io.restart();
+  try {
+    m_io.poll();
+  }
+  catch (const std::exception& e) {
+    NDNSD_LOG_WARN("Event handler failed at shutdown: " << e.what());
+  }
+  ndn::time::setCustomClocks();
+}
+
+void
+Simulator::at(ndn::time::milliseconds time, std::function<void()> action)
+{
+  auto delay = time - ndn::time::duration_cast<ndn::time::milliseconds>(getElapsed());
+  m_scheduler.schedule(std::max(delay, ndn::time::milliseconds::zero()), std::move(action));
+}
+
+void
+Simulator::start(size_t node)
+{
+  Node& entry = m_nodes.at(node);
+  if (entry.application != nullptr) {
+    return;
+  }
+  NDNSD_LOG_DEBUG("Starting node " << node);
+  entry.face = std::make_unique<ndn::DummyClientFace>(m_io, m_keyChain,
+                                                      ndn::DummyClientFace::Options(false, true));
+  m_network.attach(node, *entry.face);
+
+  auto callback = [this, node] (const Details& details) { onDiscovered(node, details); };
+  entry.application = m_options.makeApplication ?
+                        m_options.makeApplication(node, *entry.face, callback) :
+                        makeDiscovery(node, *entry.face, callback);
+
+  auto now = ndn::time::system_clock::to_time_t(ndn::time::system_clock::now());
+  for (auto& item : entry.published) {
+    item.second.publishTimestamp = now;
+    entry.application->publish(item.second);
+  }
+}
+
+std::unique_ptr<Application>
+Simulator::makeDiscovery(size_t node, ndn::DummyClientFace& face,
+                         const ndnsd::discovery::DiscoveryCallback& callback)
+{
+  ServiceDiscoveryOptions options = m_options.discovery;
+  if (!m_options.cacheDirectory.empty()) {
+    options.cacheDirectory = m_options.cacheDirectory + "/" + std::to_string(node);
+  }
+  return std::make_unique<DiscoveryApplication>(m_options.groupName, m_nodes[node].name, face,
+                                                m_keyChain, callback, options);
+}
+
+void
+Simulator::stop(size_t node)
+{
+  Node& entry = m_nodes.at(node);
+  if (entry.application == nullptr) {
+    return;
+  }
+  NDNSD_LOG_DEBUG("Stopping node " << node);
+  entry.application.reset();
+  // callbacks of the Interests it expressed must not outlive the application
+  entry.face->removeAllPendingInterests();
+  m_network.detach(node);
+  // the face may have posted handlers already, destroy it after them
+  std::shared_ptr<ndn::DummyClientFace> face = std::move(entry.face);
+  boost::asio::post(m_io, [face] {});
+  unexpect(node);
+}
+
+void
+Simulator::restart(size_t node)
+{
+  if (!isUp(node)) {
+    return;
+  }
+  stop(node);
+  start(node);
+  ++m_nodes[node].nRestarts;
+}
+
+void
+Simulator::churn(double fraction, ndn::time::milliseconds downtime)
+{
+  std::vector<size_t> up;
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    if (isUp(i)) {
+      up.push_back(i);
+    }
+  }
+  std::shuffle(up.begin(), up.end(), m_random);
+  size_t nStopped = std::min(up.size(), static_cast<size_t>(std::lround(fraction * up.size())));
+  NDNSD_LOG_DEBUG("Churn: stopping " << nStopped << " of " << up.size() << " nodes");
+  for (size_t i = 0; i < nStopped; ++i) {
+    size_t node = up[i];
+    stop(node);
+    m_scheduler.schedule(downtime, [this, node] {
+      start(node);
+      ++m_nodes[node].nRestarts;
+    });
+  }
+}
+
+uint64_t
+Simulator::publish(size_t node, const ndn::Name& serviceName, ndn::time::seconds lifetime,
+                   std::map<std::string, std::string> metaInfo)
+{
+  Node& entry = m_nodes.at(node);
+  if (entry.application == nullptr) {
+    return 0;
+  }
+  uint64_t id = m_publications.size() + 1;
+
+  Details details;
+  details.serviceName = serviceName;
+  details.applicationPrefix = ndn::Name(entry.name).append(serviceName);
+  details.serviceLifetime = static_cast<int>(lifetime.count());
+  details.publishTimestamp = ndn::time::system_clock::to_time_t(ndn::time::system_clock::now());
+  details.serviceMetaInfo = std::move(metaInfo);
+  details.serviceMetaInfo[PUBLICATION_KEY] = std::to_string(id);
+
+  Publication publication;
+  publication.node = node;
+  publication.serviceName = serviceName;
+  publication.key = ServiceRegistry::makeKey(details.applicationPrefix, serviceName).toUri();
+  publication.publishedAt = ndn::time::steady_clock::now();
+  publication.isUpdate = m_latest.count(publication.key) > 0;
+  m_latest[publication.key] = id;
+  publication.isExpected.resize(m_nodes.size());
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    if (i != node && isUp(i)) {
+      publication.isExpected[i] = true;
+      ++publication.nExpected;
+    }
+  }
+  if (publication.nExpected == 0) {
+    publication.convergedAt = publication.publishedAt;
+  }
+  else {
+    m_pending[publication.key].push_back(id);
+    ++m_nPending;
+  }
+  m_publications.push_back(std::move(publication));
+
+  entry.published[serviceName.toUri()] = details;
+  entry.application->publish(details);
+  return id;
+}
+
+void
+Simulator::run(ndn::time::milliseconds duration)
+{
+  auto end = ndn::time::steady_clock::now() + duration;
+  while (ndn::time::steady_clock::now() < end) {
+    advance();
+  }
+}
+
+bool
+Simulator::runUntilConverged(ndn::time::milliseconds timeout)
+{
+  auto end = ndn::time::steady_clock::now() + timeout;
+  while (!isConverged() && ndn::time::steady_clock::now() < end) {
+    advance();
+  }
+  return isConverged();
+}
+
+void
+Simulator::advance()
+{
+  m_steadyClock->advance(m_options.tick);
+  m_systemClock->advance(m_options.tick);
+  if (m_io.stopped()) {
+    m_io.restart();
+  }
+  try {
+    m_io.poll();
+  }
+  catch (const std::exception& e) {
+    ++m_nErrors;
+    NDNSD_LOG_WARN("Event handler failed at " << toMilliseconds(getElapsed()) << " ms: "
+                 << e.what());
+  }
+}
+
+void
+Simulator::onDiscovered(size_t node, const Details& details)
+{
+  ++m_nodes[node].nCallbacks;
+
+  auto meta = details.serviceMetaInfo.find(PUBLICATION_KEY);
+  if (meta == details.serviceMetaInfo.end()) {
+    return;
+  }
+  auto pending = m_pending.find(ServiceRegistry::makeKey(details.applicationPrefix,
+                                                         details.serviceName).toUri());
+  if (pending == m_pending.end()) {
+    return;
+  }
+  // a newer version of the service also delivers the older ones it replaces
+  uint64_t id = std::strtoull(meta->second.data(), nullptr, 10);
+  auto& ids = pending->second;
+  for (uint64_t pendingId : ids) {
+    if (pendingId <= id) {
+      markReceived(m_publications[pendingId - 1], node);
+    }
+  }
+  ids.erase(std::remove_if(ids.begin(), ids.end(), [this] (uint64_t pendingId) {
+              return m_publications[pendingId - 1].convergedAt.has_value();
+            }),
+            ids.end());
+  if (ids.empty()) {
+    m_pending.erase(pending);
+  }
+}
+
+void
+Simulator::markReceived(Publication& publication, size_t node)
+{
+  if (!publication.isExpected[node]) {
+    return;
+  }
+  publication.isExpected[node] = false;
+  ++publication.nReceived;
+  publication.delays.push_back(ndn::time::steady_clock::now() - publication.publishedAt);
+  if (publication.nReceived == publication.nExpected) {
+    publication.convergedAt = ndn::time::steady_clock::now();
+    --m_nPending;
+  }
+}
+
+void
+Simulator::unexpect(size_t node)
+{
+  for (auto it = m_pending.begin(); it != m_pending.end();) {
+    auto& ids = it->second;
+    for (uint64_t id : ids) {
+      Publication& publication = m_publications[id - 1];
+      if (!publication.isExpected[node]) {
+        continue;
+      }
+      publication.isExpected[node] = false;
+      --publication.nExpected;
+      if (publication.nReceived == publication.nExpected) {
+        publication.convergedAt = ndn::time::steady_clock::now();
+        --m_nPending;
+      }
+    }
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [this] (uint64_t id) {
+                return m_publications[id - 1].convergedAt.has_value();
+              }),
+              ids.end());
+    it = ids.empty() ? m_pending.erase(it) : std::next(it);
+  }
+}
+
+SimulationReport
+Simulator::getReport() const
+{
+  SimulationReport report;
+  report.elapsed = getElapsed();
+  report.nErrors = m_nErrors;
+  for (size_t i = 0; i < m_nodes.size(); ++i) {
+    const Node& node = m_nodes[i];
+    report.nodes.push_back({node.name, node.application != nullptr, m_network.getCounters(i),
+                            node.nCallbacks,
+                            node.application ? node.application->getServiceCount() : 0,
+                            node.nRestarts});
+  }
+  for (size_t i = 0; i < m_publications.size(); ++i) {
+    const Publication& publication = m_publications[i];
+    PublicationReport entry{i + 1, publication.node, publication.serviceName,
+                            publication.publishedAt - m_startTime, publication.isUpdate,
+                            publication.nExpected, publication.nReceived, std::nullopt,
+                            publication.delays};
+    if (publication.convergedAt) {
+      entry.convergenceTime = *publication.convergedAt - publication.publishedAt;
+    }
+    report.publications.push_back(std::move(entry));
+  }
+  return report;
+}
+
+void
+SimulationReport::writeSummary(std::ostream& os) const
+{
+  PacketCounters total;
+  uint64_t nCallbacks = 0;
+  size_t nUp = 0;
+  for (const auto& node : nodes) {
+    total += node.counters;
+    nCallbacks += node.nCallbacks;
+    nUp += node.isUp ? 1 : 0;
+  }
+  std::vector<double> convergence;
+  for (const auto& publication : publications) {
+    if (publication.convergenceTime) {
+      convergence.push_back(toMilliseconds(*publication.convergenceTime));
+    }
+  }
+  std::sort(convergence.begin(), convergence.end());
+  auto percentile = [&] (double p) {
+    return convergence.empty() ? 0.0 :
+      convergence[std::min(convergence.size() - 1,
+                           static_cast<size_t>(p * convergence.size()))];
+  };
+  double mean = 0;
+  for (double c : convergence) {
+    mean += c / convergence.size();
+  }
+  double perNode = nodes.empty() ? 0.0 : 1.0 / nodes.size();
+
+  os << "elapsed_ms: " << toMilliseconds(elapsed) << "\n"
+     << "nodes: " << nodes.size() << " (" << nUp << " up)\n"
+     << "publications: " << publications.size() << " (" << convergence.size()
+     << " converged)\n"
+     << "convergence_ms: mean " << mean << " p50 " << percentile(0.5) << " p90 "
+     << percentile(0.9) << " p99 " << percentile(0.99) << " max "
+     << (convergence.empty() ? 0.0 : convergence.back()) << "\n"
+     << "interests_sent: " << total.nInterestsSent << " (" << total.nInterestsSent * perNode
+     << " per node)\n"
+     << "data_sent: " << total.nDataSent << " (" << total.nDataSent * perNode << " per node)\n"
+     << "bytes_sent: " << total.nBytesSent << " (" << total.nBytesSent * perNode
+     << " per node)\n"
+     << "bytes_received: " << total.nBytesReceived << " (" << total.nBytesReceived * perNode
+     << " per node)\n"
+     << "lost: " << total.nLost << "\n"
+     << "callbacks: " << nCallbacks << " (" << nCallbacks * perNode << " per node)\n"
+     << "errors: " << nErrors << "\n";
+}
+
+void
+SimulationReport::writeNodes(std::ostream& os) const
+{
+  os << "node,up,restarts,interests_sent,data_sent,nacks_sent,bytes_sent,"
+     << "interests_received,data_received,nacks_received,bytes_received,lost,callbacks,"
+     << "services\n";
+  for (const auto& node : nodes) {
+    const auto& c = node.counters;
+    os << node.name << ',' << node.isUp << ',' << node.nRestarts << ','
+       << c.nInterestsSent << ',' << c.nDataSent << ',' << c.nNacksSent << ','
+       << c.nBytesSent << ',' << c.nInterestsReceived << ',' << c.nDataReceived << ','
+       << c.nNacksReceived << ',' << c.nBytesReceived << ',' << c.nLost << ','
+       << node.nCallbacks << ',' << node.nServices << '\n';
+  }
+}
+
+} // namespace simulation
+} // namespace ndnsd
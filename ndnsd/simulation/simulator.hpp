@@ -0,0 +1,361 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NDNSD_SIMULATOR_HPP
+#define NDNSD_SIMULATOR_HPP
+
+#include "simulated-network.hpp"
+#include "ndnsd/discovery/service-discovery.hpp"
+
+#include <ndn-cxx/util/time-unit-test-clock.hpp>
+
+#include <functional>
+#include <optional>
+#include <ostream>
+
+namespace ndnsd {
+namespace simulation {
+
+/**
+  @brief what runs on a simulated node, ServiceDiscovery unless another discovery scheme
+         is compared with it
+**/
+class Application
+{
+public:
+  virtual
+  ~Application() = default;
+
+  virtual void
+  publish(const ndnsd::discovery::Details& details) = 0;
+
+  // number of services the node knows of
+  virtual size_t
+  getServiceCount() const = 0;
+
+  virtual ndnsd::discovery::ServiceDiscovery*
+  getDiscovery()
+  {
+    return nullptr;
+  }
+};
+
+/**
+  @brief create the application of node on face, it reports received services to callback
+**/
+using ApplicationFactory = std::function<std::unique_ptr<Application>(
+  size_t node, ndn::DummyClientFace& face, const ndnsd::discovery::DiscoveryCallback& callback)>;
+
+struct SimulatorOptions
+{
+  size_t nNodes = 10;
+  ndn::Name groupName = "/ndnsd/sim";
+  LinkOptions link;
+  // granularity of the simulated clock
+  ndn::time::milliseconds tick = ndn::time::milliseconds(1);
+  /**
+    directory holding one registry cache per node, empty to disable. Restarted nodes then
+    come back warm, see ServiceDiscoveryOptions::cacheDirectory.
+  **/
+  std::string cacheDirectory;
+  ndnsd::discovery::ServiceDiscoveryOptions discovery;
+  // runs ServiceDiscovery on every node if not set
+  ApplicationFactory makeApplication;
+};
+
+struct NodeReport
+{
+  ndn::Name name;
+  bool isUp;
+  PacketCounters counters;
+  // discovery callbacks since the start of the simulation
+  uint64_t nCallbacks;
+  size_t nServices;
+  uint64_t nRestarts;
+};
+
+struct PublicationReport
+{
+  uint64_t id;
+  size_t node;
+  ndn::Name serviceName;
+  ndn::time::steady_clock::duration publishedAt;
+  // whether it replaced an earlier publication of the same service
+  bool isUpdate;
+  // nodes up when it was published and still up, the publisher excluded
+  size_t nExpected;
+  size_t nReceived;
+  // time until every expected node received it, nullopt if some did not yet
+  std::optional<ndn::time::steady_clock::duration> convergenceTime;
+  // time until each node that received it did
+  std::vector<ndn::time::steady_clock::duration> delays;
+};
+
+struct SimulationReport
+{
+  ndn::time::steady_clock::duration elapsed;
+  std::vector<NodeReport> nodes;
+  std::vector<PublicationReport> publications;
+  // exceptions escaping event handlers, the simulation goes on after each
+  uint64_t nErrors;
+
+  void
+  writeSummary(std::ostream& os) const;
+
+  /**
+    @brief one CSV row per node
+  **/
+  void
+  writeNodes(std::ostream& os) const;
+};
+
+/**
+  @brief N ServiceDiscovery nodes of one group in this process, on simulated time
+
+  Every node has its own DummyClientFace attached to a SimulatedNetwork and runs
+  ServiceDiscovery, or the Application of SimulatorOptions::makeApplication. All faces share
+  one io_service, one in-memory KeyChain and the ndn::time custom clocks installed by the
+  constructor, so that sync timers, leases and link delays all run on simulated time and a
+  run of minutes takes as long as its events need to be processed. Only one Simulator can
+  exist at a time.
+
+  The workload is a list of actions scheduled with at(): nodes are started, stopped and
+  restarted, publish services, and the network is partitioned and healed. Publications
+  made with publish() are tracked until every node that was up when they were made has
+  received them, which gives their convergence time.
+**/
+class Simulator
+{
+public:
+  explicit
+  Simulator(const SimulatorOptions& options);
+
+  ~Simulator();
+
+  Simulator(const Simulator&) = delete;
+  Simulator& operator=(const Simulator&) = delete;
+
+  /**
+    @brief run action when the simulated time since the start reaches time
+  **/
+  void
+  at(ndn::time::milliseconds time, std::function<void()> action);
+
+  /**
+    @brief join the group with node, no-op if it is up
+
+    Services the node published before being stopped are published again.
+  **/
+  void
+  start(size_t node);
+
+  /**
+    @brief leave abruptly, as a crash would, no-op if the node is down
+  **/
+  void
+  stop(size_t node);
+
+  void
+  restart(size_t node);
+
+  /**
+    @brief stop a random fraction of the nodes that are up and start them after downtime
+  **/
+  void
+  churn(double fraction, ndn::time::milliseconds downtime);
+
+  /**
+    @brief publish serviceName from node with a lease of lifetime
+    @return id of the publication in SimulationReport, 0 if the node is down
+  **/
+  uint64_t
+  publish(size_t node, const ndn::Name& serviceName, ndn::time::seconds lifetime,
+          std::map<std::string, std::string> metaInfo = {});
+
+  void
+  partition(size_t node, uint32_t partition)
+  {
+    m_network.setPartition(node, partition);
+  }
+
+  void
+  heal()
+  {
+    m_network.heal();
+  }
+
+  /**
+    @brief advance the simulated time by duration, running every event due meanwhile
+  **/
+  void
+  run(ndn::time::milliseconds duration);
+
+  /**
+    @brief run until every publication converged, or for at most timeout
+    @return whether every publication converged
+  **/
+  bool
+  runUntilConverged(ndn::time::milliseconds timeout);
+
+  bool
+  isConverged() const
+  {
+    return m_nPending == 0;
+  }
+
+  bool
+  isUp(size_t node) const
+  {
+    return m_nodes.at(node).application != nullptr;
+  }
+
+  /**
+    @return nullptr if the node is down or does not run ServiceDiscovery
+  **/
+  ndnsd::discovery::ServiceDiscovery*
+  getDiscovery(size_t node)
+  {
+    auto& application = m_nodes.at(node).application;
+    return application ? application->getDiscovery() : nullptr;
+  }
+
+  const ndn::Name&
+  getNodeName(size_t node) const
+  {
+    return m_nodes.at(node).name;
+  }
+
+  size_t
+  size() const
+  {
+    return m_nodes.size();
+  }
+
+  SimulatedNetwork&
+  getNetwork()
+  {
+    return m_network;
+  }
+
+  boost::asio::io_service&
+  getIoService()
+  {
+    return m_io;
+  }
+
+  ndn::KeyChain&
+  getKeyChain()
+  {
+    return m_keyChain;
+  }
+
+  /**
+    @brief metrics of all ServiceDiscovery nodes, see ServiceDiscoveryOptions::metrics
+  **/
+  ndnsd::discovery::Metrics&
+  getMetrics()
+  {
+    return *m_options.discovery.metrics;
+  }
+
+  ndn::time::steady_clock::duration
+  getElapsed() const
+  {
+    return ndn::time::steady_clock::now() - m_startTime;
+  }
+
+  std::mt19937_64&
+  getRandom()
+  {
+    return m_random;
+  }
+
+  SimulationReport
+  getReport() const;
+
+private:
+  struct Node
+  {
+    ndn::Name name;
+    std::unique_ptr<ndn::DummyClientFace> face;
+    std::unique_ptr<Application> application;
+    // published services, by serviceName
+    std::map<std::string, ndnsd::discovery::Details> published;
+    uint64_t nCallbacks = 0;
+    uint64_t nRestarts = 0;
+  };
+
+  struct Publication
+  {
+    size_t node;
+    ndn::Name serviceName;
+    std::string key;
+    ndn::time::steady_clock::time_point publishedAt;
+    bool isUpdate = false;
+    std::vector<bool> isExpected;
+    size_t nExpected = 0;
+    size_t nReceived = 0;
+    std::optional<ndn::time::steady_clock::time_point> convergedAt;
+    std::vector<ndn::time::steady_clock::duration> delays;
+  };
+
+  std::unique_ptr<Application>
+  makeDiscovery(size_t node, ndn::DummyClientFace& face,
+                const ndnsd::discovery::DiscoveryCallback& callback);
+
+  void
+  onDiscovered(size_t node, const ndnsd::discovery::Details& details);
+
+  void
+  markReceived(Publication& publication, size_t node);
+
+  // a node is no longer expected to receive the pending publications
+  void
+  unexpect(size_t node);
+
+  void
+  advance();
+
+private:
+  SimulatorOptions m_options;
+  std::shared_ptr<ndn::time::UnitTestSteadyClock> m_steadyClock;
+  std::shared_ptr<ndn::time::UnitTestSystemClock> m_systemClock;
+  ndn::time::steady_clock::time_point m_startTime;
+
+  boost::asio::io_service m_io;
+  ndn::KeyChain m_keyChain;
+  ndn::Scheduler m_scheduler;
+  SimulatedNetwork m_network;
+  std::mt19937_64 m_random;
+
+  std::vector<Node> m_nodes;
+  // index i is publication id i + 1
+  std::vector<Publication> m_publications;
+  // not converged publications, by registry key
+  std::map<std::string, std::vector<uint64_t>> m_pending;
+  // latest publication, by registry key
+  std::map<std::string, uint64_t> m_latest;
+  size_t m_nPending = 0;
+  uint64_t m_nErrors = 0;
+};
+
+} // namespace simulation
+} // namespace ndnsd
+
+#endif // NDNSD_SIMULATOR_HPP
@@ -0,0 +1,103 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "ndnsd/discovery/service-registry.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace ndnsd {
+namespace discovery {
+namespace tests {
+
+class RegistryFixture
+{
+protected:
+  RegistryFixture()
+  {
+    for (const char* version : {"1.0.0", "1.9", "1.10", "2.0", "3.1"}) {
+      Details details;
+      details.serviceName = "/printer";
+      details.applicationPrefix = ndn::Name("/node").append(version);
+      details.serviceMetaInfo["version"] = version;
+      ids[version] = registry.insert(details).id;
+    }
+  }
+
+  // versions of the entries matching query, ascending by entry id
+  std::vector<std::string>
+  select(const Query& query) const
+  {
+    std::vector<std::string> versions;
+    for (auto id : registry.query(query)) {
+      versions.emplace_back(*registry.getMetaValue(id, "version"));
+    }
+    return versions;
+  }
+
+protected:
+  ServiceRegistry registry;
+  std::map<std::string, ServiceRegistry::EntryId> ids;
+};
+
+using Versions = std::vector<std::string>;
+
+BOOST_FIXTURE_TEST_SUITE(TestAttributeIndex, RegistryFixture)
+
+BOOST_AUTO_TEST_CASE(EmptyRanges)
+{
+  for (bool isIndexed : {false, true}) {
+    if (isIndexed) {
+      registry.addIndex("version", IndexType::VERSION);
+    }
+    BOOST_CHECK(registry.query(Query().greater("version", "2.0").less("version", "1.0")).empty());
+    BOOST_CHECK(registry.query(Query().equals("version", "2.0").greater("version", "3.0")).empty());
+    BOOST_CHECK(registry.query(Query().greater("version", "2.0")
+                                      .lessOrEqual("version", "2.0")).empty());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(UnindexedVersions)
+{
+  // the same order as a VERSION index
+  Versions expected{"1.0.0", "1.9", "1.10", "2.0", "3.1"};
+  BOOST_CHECK(select(Query().greaterOrEqual("version", "1.0")) == expected);
+  BOOST_CHECK(select(Query().greater("version", "1.9")) == Versions({"1.10", "2.0", "3.1"}));
+  BOOST_CHECK(select(Query().greater("version", "1.9").less("version", "3")) ==
+              Versions({"1.10", "2.0"}));
+
+  registry.addIndex("version", IndexType::VERSION);
+  BOOST_CHECK(select(Query().greaterOrEqual("version", "1.0")) == expected);
+  BOOST_CHECK(select(Query().greater("version", "1.9")) == Versions({"1.10", "2.0", "3.1"}));
+}
+
+BOOST_AUTO_TEST_CASE(TypePerKey)
+{
+  // the type follows every operand of the key, not only the first one
+  BOOST_CHECK(select(Query().less("version", "3").greater("version", "1.9")) ==
+              Versions({"1.10", "2.0"}));
+  // a negative operand is not a version, the key compares as numbers
+  BOOST_CHECK(select(Query().greater("version", "-1").less("version", "1.95")) ==
+              Versions({"1.9", "1.10"}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "ndnsd/discovery/registry-columns.hpp"
+#include "ndnsd/discovery/service-registry.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace ndnsd {
+namespace discovery {
+namespace tests {
+
+static Details
+makeDetails(time_t publishTimestamp, const std::string& version)
+{
+  Details details;
+  details.serviceName = "/printer";
+  details.applicationPrefix = "/node1/printer";
+  details.serviceLifetime = 3600;
+  details.publishTimestamp = publishTimestamp;
+  details.serviceMetaInfo["version"] = version;
+  return details;
+}
+
+BOOST_AUTO_TEST_SUITE(TestRegistryColumns)
+
+BOOST_AUTO_TEST_CASE(DictionaryFollowsRows)
+{
+  ServiceRegistry registry;
+  registry.enableColumns({"version"});
+  const RegistryColumns& columns = *registry.getColumns();
+
+  auto id = registry.insert(makeDetails(1000, "v0")).id;
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v0").count(), 1);
+  size_t bytes = 0;
+  for (int i = 1; i <= 1000; ++i) {
+    registry.insert(makeDetails(1000 + i, "v" + std::to_string(i)));
+    if (i == 10) {
+      bytes = columns.getMemoryUsage();
+    }
+  }
+  // the values no row holds anymore are gone
+  BOOST_CHECK_EQUAL(columns.getMemoryUsage(), bytes);
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v0").count(), 0);
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v1000").count(), 1);
+
+  registry.erase(id);
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v1000").count(), 0);
+
+  // a freed code is handed out again, not shared with a stale row
+  registry.insert(makeDetails(3000, "v0"));
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v0").count(), 1);
+  BOOST_CHECK_EQUAL(columns.selectMetaEquals("version", "v1000").count(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace discovery
+} // namespace ndnsd
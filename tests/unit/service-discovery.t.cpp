@@ -0,0 +1,99 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "ndnsd/simulation/simulator.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace ndnsd {
+namespace discovery {
+namespace tests {
+
+using simulation::Simulator;
+using simulation::SimulatorOptions;
+
+BOOST_AUTO_TEST_SUITE(TestServiceDiscovery)
+
+BOOST_AUTO_TEST_CASE(WithdrawAfterHeartbeat)
+{
+  SimulatorOptions options;
+  options.nNodes = 3;
+  Simulator simulator(options);
+  simulator.start(0);
+  simulator.start(1);
+  simulator.run(ndn::time::seconds(1));
+
+  simulator.publish(0, "/printer", ndn::time::seconds(60));
+  BOOST_REQUIRE(simulator.runUntilConverged(ndn::time::seconds(10)));
+  ServiceDiscovery& receiver = *simulator.getDiscovery(1);
+  ndn::Name applicationPrefix = ndn::Name(simulator.getNodeName(0)).append("/printer");
+  auto id = receiver.getRegistry().find(applicationPrefix, "/printer");
+  BOOST_REQUIRE(id != ServiceRegistry::INVALID_ENTRY);
+  time_t version = receiver.getRegistry().getPublishTimestamp(id);
+
+  // seconds later, so that a heartbeat taken for a new version would outrank the withdrawal
+  simulator.run(ndn::time::seconds(3));
+  BOOST_REQUIRE(simulator.getDiscovery(0)->publishHeartbeat("/printer", Heartbeat{1, 0, 120}));
+  simulator.run(ndn::time::seconds(2));
+  BOOST_CHECK_EQUAL(receiver.getRegistry().getPublishTimestamp(id), version);
+  BOOST_CHECK_GT(receiver.getRegistry().getLeaseEnd(id), version + 60);
+
+  // the producer answers the discovery message of the joining node with the renewed lease,
+  // a duplicate for the receiver
+  uint64_t nCallbacks = simulator.getReport().nodes[1].nCallbacks;
+  simulator.start(2);
+  simulator.run(ndn::time::seconds(5));
+  BOOST_CHECK_EQUAL(simulator.getDiscovery(2)->getRegistry().size(), 1);
+  BOOST_CHECK_EQUAL(simulator.getReport().nodes[1].nCallbacks, nCallbacks);
+
+  BOOST_REQUIRE(simulator.getDiscovery(0)->withdrawServiceDetail("/printer"));
+  simulator.run(ndn::time::seconds(2));
+  BOOST_CHECK_EQUAL(receiver.getRegistry().size(), 0);
+  BOOST_CHECK_EQUAL(simulator.getDiscovery(2)->getRegistry().size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(EvictionIsJournaled)
+{
+  SimulatorOptions options;
+  options.nNodes = 2;
+  // no room for any service
+  options.discovery.memoryBudget = 1;
+  Simulator simulator(options);
+  simulator.start(0);
+  simulator.start(1);
+  simulator.run(ndn::time::seconds(1));
+
+  simulator.publish(0, "/printer", ndn::time::seconds(60));
+  simulator.run(ndn::time::seconds(5));
+  ServiceDiscovery& receiver = *simulator.getDiscovery(1);
+  BOOST_CHECK_EQUAL(receiver.getRegistry().size(), 0);
+
+  auto batch = receiver.changesSince(0);
+  BOOST_REQUIRE(!batch.changes.empty());
+  const Change& last = batch.changes.back();
+  BOOST_CHECK_EQUAL(last.type, Change::EVICTED);
+  BOOST_CHECK_EQUAL(last.details.serviceName, "/printer");
+  BOOST_CHECK_EQUAL(last.group, options.groupName);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace discovery
+} // namespace ndnsd
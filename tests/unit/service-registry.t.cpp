@@ -0,0 +1,87 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "ndnsd/discovery/service-registry.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+namespace ndnsd {
+namespace discovery {
+namespace tests {
+
+static Details
+makeDetails(time_t publishTimestamp, int lifetime)
+{
+  Details details;
+  details.serviceName = "/printer";
+  details.applicationPrefix = "/node1/printer";
+  details.serviceLifetime = lifetime;
+  details.publishTimestamp = publishTimestamp;
+  details.serviceMetaInfo["version"] = "1.0";
+  return details;
+}
+
+BOOST_AUTO_TEST_SUITE(TestServiceRegistry)
+
+BOOST_AUTO_TEST_CASE(HeartbeatKeepsVersion)
+{
+  ServiceRegistry registry;
+  auto id = registry.insert(makeDetails(1000, 10)).id;
+  BOOST_CHECK_EQUAL(registry.getLeaseEnd(id), 1010);
+
+  registry.applyHeartbeat(id, Heartbeat{3, 0, 60}, 1005);
+  BOOST_CHECK_EQUAL(registry.getPublishTimestamp(id), 1000);
+  BOOST_CHECK_EQUAL(registry.getServiceLifetime(id), 10);
+  BOOST_CHECK_EQUAL(registry.getLeaseEnd(id), 1065);
+  BOOST_CHECK_EQUAL(registry.get(id).getLeaseEnd(), 1065);
+
+  // renewed lease, not the end of the original one
+  BOOST_CHECK_EQUAL(registry.expire(1010), 0);
+  BOOST_CHECK_EQUAL(registry.expire(1065), 1);
+}
+
+BOOST_AUTO_TEST_CASE(RepublishAfterHeartbeatIsDuplicate)
+{
+  ServiceRegistry registry;
+  Details details = makeDetails(1000, 10);
+  auto id = registry.insert(details).id;
+  registry.applyHeartbeat(id, Heartbeat{3, 0, 60}, 1005);
+
+  // what the producer answers discovery messages with after the heartbeat
+  details.leaseEnd = 1070;
+  auto inserted = registry.insert(details);
+  BOOST_CHECK(inserted.isDuplicate);
+  BOOST_CHECK_EQUAL(registry.getLeaseEnd(id), 1070);
+
+  // an older lease does not shorten the renewed one
+  details.leaseEnd = 0;
+  BOOST_CHECK(registry.insert(details).isDuplicate);
+  BOOST_CHECK_EQUAL(registry.getLeaseEnd(id), 1070);
+
+  // a new version restarts the lease from its publishTimestamp
+  inserted = registry.insert(makeDetails(1080, 10));
+  BOOST_CHECK(!inserted.isDuplicate);
+  BOOST_CHECK_EQUAL(registry.getLeaseEnd(id), 1090);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace tests
+} // namespace discovery
+} // namespace ndnsd
@@ -0,0 +1,260 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Compares proactive discovery, reactive discovery and NDNSD on the same simulated
+// network and workload, and writes one CSV row per strategy and run.
+//
+// The workload is the one of the programs in comparision/: every node joins, the producers
+// publish a service, then update it every --update-interval until --updates publications
+// were made. Discovery latency is the delay until a node first learns of a service,
+// staleness the delay until it learns of each update. Interests, Data and bytes are the
+// totals sent by all nodes.
+
+#include "ndnsd/simulation/baseline-discovery.hpp"
+#include "ndnsd/simulation/simulator.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace po = boost::program_options;
+using namespace ndnsd::simulation;
+
+struct Workload
+{
+  size_t nProducers = 1;
+  size_t nUpdates = 30;
+  ndn::time::milliseconds updateInterval = ndn::time::seconds(10);
+};
+
+struct Statistics
+{
+  double mean = 0;
+  double p50 = 0;
+  double p99 = 0;
+  double max = 0;
+};
+
+static ndn::time::milliseconds
+parseDuration(const std::string& text)
+{
+  size_t end = 0;
+  double value = std::stod(text, &end);
+  std::string unit = text.substr(end);
+  double factor = unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "min" ? 60000 : -1;
+  if (factor < 0 || value < 0) {
+    throw std::invalid_argument("invalid duration " + text);
+  }
+  return ndn::time::milliseconds(static_cast<int64_t>(value * factor));
+}
+
+static Statistics
+getStatistics(std::vector<double> values)
+{
+  Statistics statistics;
+  if (values.empty()) {
+    return statistics;
+  }
+  std::sort(values.begin(), values.end());
+  auto percentile = [&values] (double p) {
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+  };
+  statistics.mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+  statistics.p50 = percentile(0.5);
+  statistics.p99 = percentile(0.99);
+  statistics.max = values.back();
+  return statistics;
+}
+
+static void
+writeHeader(std::ostream& os)
+{
+  os << "strategy,run,nodes,producers,updates,update_interval_ms,interval_ms,latency_ms,loss,"
+     << "discovery_mean_ms,discovery_p50_ms,discovery_p99_ms,"
+     << "staleness_mean_ms,staleness_p99_ms,staleness_max_ms,"
+     << "missed,interests,data,bytes,callbacks\n";
+}
+
+static void
+runOnce(const std::string& strategy, size_t run, SimulatorOptions options,
+        const BaselineOptions& baseline, const Workload& workload, std::ostream& os)
+{
+  // the factory runs once the Simulator, which owns the KeyChain, exists
+  ndn::KeyChain* keyChain = nullptr;
+  if (strategy == "proactive") {
+    options.makeApplication = [&keyChain, baseline] (size_t, ndn::DummyClientFace& face,
+                                                      const auto& callback) {
+      return std::make_unique<ProactiveDiscovery>(face, *keyChain, callback, baseline);
+    };
+  }
+  else if (strategy == "reactive") {
+    options.makeApplication = [&keyChain, baseline] (size_t, ndn::DummyClientFace& face,
+                                                      const auto& callback) {
+      return std::make_unique<ReactiveDiscovery>(face, *keyChain, callback, baseline);
+    };
+  }
+  else {
+    options.groupName = baseline.discoveryPrefix;
+  }
+
+  Simulator simulator(options);
+  keyChain = &simulator.getKeyChain();
+
+  ndn::time::milliseconds joinTime = ndn::time::seconds(1);
+  ndn::time::milliseconds publishTime = ndn::time::seconds(2);
+  for (size_t node = 0; node < options.nNodes; ++node) {
+    auto offset = joinTime * static_cast<int64_t>(node) / static_cast<int64_t>(options.nNodes);
+    simulator.at(offset, [&simulator, node] { simulator.start(node); });
+  }
+  // the last update is followed by one update interval to settle
+  auto duration = publishTime + workload.updateInterval * static_cast<int64_t>(workload.nUpdates);
+  auto lifetime = ndn::time::duration_cast<ndn::time::seconds>(duration) + ndn::time::seconds(1);
+  size_t nProducers = std::min(workload.nProducers, options.nNodes);
+  for (size_t update = 0; update < workload.nUpdates; ++update) {
+    simulator.at(publishTime + workload.updateInterval * static_cast<int64_t>(update),
+                 [&simulator, nProducers, lifetime] {
+                   for (size_t node = 0; node < nProducers; ++node) {
+                     simulator.publish(node, "/printer", lifetime);
+                   }
+                 });
+  }
+  simulator.run(duration);
+
+  auto report = simulator.getReport();
+  std::vector<double> discovery;
+  std::vector<double> staleness;
+  size_t nMissed = 0;
+  for (const auto& publication : report.publications) {
+    auto& values = publication.isUpdate ? staleness : discovery;
+    for (const auto& delay : publication.delays) {
+      values.push_back(ndn::time::duration_cast<ndn::time::microseconds>(delay).count() / 1000.0);
+    }
+    nMissed += publication.nExpected - publication.nReceived;
+  }
+  PacketCounters total;
+  uint64_t nCallbacks = 0;
+  for (const auto& node : report.nodes) {
+    total += node.counters;
+    nCallbacks += node.nCallbacks;
+  }
+
+  Statistics discoveryStatistics = getStatistics(discovery);
+  Statistics stalenessStatistics = getStatistics(staleness);
+  os << strategy << ',' << run << ',' << options.nNodes << ',' << nProducers << ','
+     << workload.nUpdates << ',' << workload.updateInterval.count() << ','
+     << baseline.interval.count() << ',' << options.link.latency.count() << ','
+     << options.link.lossRate << ','
+     << discoveryStatistics.mean << ',' << discoveryStatistics.p50 << ','
+     << discoveryStatistics.p99 << ','
+     << stalenessStatistics.mean << ',' << stalenessStatistics.p99 << ','
+     << stalenessStatistics.max << ','
+     << nMissed << ',' << total.nInterestsSent << ',' << total.nDataSent << ','
+     << total.nBytesSent << ',' << nCallbacks << '\n';
+}
+
+int
+main(int argc, char* argv[])
+{
+  SimulatorOptions options;
+  BaselineOptions baseline;
+  Workload workload;
+  std::string strategy;
+  std::string prefix;
+  std::string updateInterval;
+  std::string interval;
+  std::string latency;
+  std::string jitter;
+  size_t nRuns = 1;
+
+  po::options_description description("Options");
+  description.add_options()
+    ("help,h", "print this help message")
+    ("strategy", po::value<std::string>(&strategy)->default_value("all"),
+     "proactive, reactive, ndnsd or all")
+    ("nodes,n", po::value<size_t>(&options.nNodes)->default_value(options.nNodes),
+     "number of nodes")
+    ("producers,p", po::value<size_t>(&workload.nProducers)->default_value(workload.nProducers),
+     "number of nodes publishing the service")
+    ("updates,u", po::value<size_t>(&workload.nUpdates)->default_value(workload.nUpdates),
+     "publications of the service per producer, the first included")
+    ("update-interval", po::value<std::string>(&updateInterval)->default_value("10s"),
+     "time between two publications")
+    ("interval", po::value<std::string>(&interval)->default_value("1s"),
+     "announcement or query period of the proactive and reactive strategies")
+    ("prefix", po::value<std::string>(&prefix)->default_value(baseline.discoveryPrefix.toUri()),
+     "discovery prefix, also the sync group of NDNSD")
+    ("latency", po::value<std::string>(&latency)->default_value("10ms"), "one-way link delay")
+    ("jitter", po::value<std::string>(&jitter)->default_value("0ms"),
+     "uniform extra link delay")
+    ("loss", po::value<double>(&options.link.lossRate)->default_value(0),
+     "probability that a delivery is dropped")
+    ("seed", po::value<uint64_t>(&options.link.seed)->default_value(options.link.seed),
+     "seed of the link model, run i uses seed + i")
+    ("runs", po::value<size_t>(&nRuns)->default_value(nRuns), "runs per strategy");
+
+  std::vector<std::string> strategies;
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    if (vm.count("help") > 0) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << description;
+      return 0;
+    }
+    po::notify(vm);
+    baseline.discoveryPrefix = prefix;
+    baseline.interval = parseDuration(interval);
+    workload.updateInterval = parseDuration(updateInterval);
+    options.link.latency = parseDuration(latency);
+    options.link.jitter = parseDuration(jitter);
+    if (strategy == "all") {
+      strategies = {"proactive", "reactive", "ndnsd"};
+    }
+    else if (strategy == "proactive" || strategy == "reactive" || strategy == "ndnsd") {
+      strategies = {strategy};
+    }
+    else {
+      throw po::error("unknown strategy " + strategy);
+    }
+    if (options.nNodes == 0 || baseline.interval <= ndn::time::milliseconds::zero()) {
+      throw po::error("nodes and interval must be positive");
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << "\n" << description;
+    return 2;
+  }
+
+  try {
+    writeHeader(std::cout);
+    uint64_t seed = options.link.seed;
+    for (size_t run = 0; run < nRuns; ++run) {
+      options.link.seed = seed + run;
+      for (const auto& name : strategies) {
+        runOnce(name, run, options, baseline, workload, std::cout);
+      }
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,273 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Runs N ServiceDiscovery nodes in this process over a simulated network and reports
+// convergence time, packets and bytes per node and callback counts, see Simulator.
+//
+// The workload is a script of one action per line, times are since the start:
+//
+//   at 0s join all over 5s          start the nodes, spread over 5 seconds
+//   at 10s publish 0-9 /printer 60s publish from nodes 0..9, lease of 60 seconds
+//   at 20s churn 0.1 5s             stop 10% of the nodes for 5 seconds
+//   at 30s restart 3                stop and start node 3
+//   at 40s leave 5                  stop node 5
+//   at 50s partition 0-499 1        move nodes 0..499 to partition 1
+//   at 60s heal                     merge all partitions
+//   at 70s loss 0.05                change the loss rate
+//
+// Nodes are `all`, a number or a range `first-last`. Durations take an ms, s or min suffix.
+
+#include "ndnsd/simulation/simulator.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace po = boost::program_options;
+using namespace ndnsd::simulation;
+
+static ndn::time::milliseconds
+parseDuration(const std::string& text)
+{
+  size_t end = 0;
+  double value = std::stod(text, &end);
+  std::string unit = text.substr(end);
+  double factor = unit == "ms" ? 1 : unit == "s" ? 1000 : unit == "min" ? 60000 : -1;
+  if (factor < 0 || value < 0) {
+    throw std::invalid_argument("invalid duration " + text);
+  }
+  return ndn::time::milliseconds(static_cast<int64_t>(value * factor));
+}
+
+static std::pair<size_t, size_t>
+parseNodes(const std::string& text, size_t nNodes)
+{
+  if (text == "all") {
+    return {0, nNodes - 1};
+  }
+  size_t dash = text.find('-');
+  size_t first = std::stoul(text.substr(0, dash));
+  size_t last = dash == std::string::npos ? first : std::stoul(text.substr(dash + 1));
+  if (first > last || last >= nNodes) {
+    throw std::invalid_argument("invalid nodes " + text);
+  }
+  return {first, last};
+}
+
+static void
+loadScript(std::istream& is, Simulator& simulator, LinkOptions link)
+{
+  std::string line;
+  size_t lineNo = 0;
+  while (std::getline(is, line)) {
+    ++lineNo;
+    std::istringstream words(line.substr(0, line.find('#')));
+    std::string at, time, action;
+    if (!(words >> at)) {
+      continue;
+    }
+    try {
+      if (at != "at" || !(words >> time >> action)) {
+        throw std::invalid_argument("expected: at <time> <action> ...");
+      }
+      auto when = parseDuration(time);
+      std::vector<std::string> args;
+      for (std::string arg; words >> arg;) {
+        args.push_back(arg);
+      }
+      auto require = [&] (size_t n) {
+        if (args.size() < n) {
+          throw std::invalid_argument(action + " needs " + std::to_string(n) + " arguments");
+        }
+      };
+
+      if (action == "join") {
+        require(1);
+        auto [first, last] = parseNodes(args[0], simulator.size());
+        auto spread = args.size() >= 3 && args[1] == "over" ? parseDuration(args[2])
+                                                            : ndn::time::milliseconds(0);
+        for (size_t node = first; node <= last; ++node) {
+          auto offset = spread * static_cast<int64_t>(node - first) /
+                        static_cast<int64_t>(last - first + 1);
+          simulator.at(when + offset, [&simulator, node] { simulator.start(node); });
+        }
+      }
+      else if (action == "leave" || action == "restart") {
+        require(1);
+        auto [first, last] = parseNodes(args[0], simulator.size());
+        bool isRestart = action == "restart";
+        simulator.at(when, [&simulator, first = first, last = last, isRestart] {
+          for (size_t node = first; node <= last; ++node) {
+            isRestart ? simulator.restart(node) : simulator.stop(node);
+          }
+        });
+      }
+      else if (action == "publish") {
+        require(2);
+        auto [first, last] = parseNodes(args[0], simulator.size());
+        ndn::Name serviceName(args[1]);
+        auto lifetime = ndn::time::duration_cast<ndn::time::seconds>(
+          args.size() >= 3 ? parseDuration(args[2]) : ndn::time::milliseconds(3600000));
+        simulator.at(when, [&simulator, first = first, last = last, serviceName, lifetime] {
+          for (size_t node = first; node <= last; ++node) {
+            simulator.publish(node, serviceName, lifetime);
+          }
+        });
+      }
+      else if (action == "churn") {
+        require(2);
+        double fraction = std::stod(args[0]);
+        auto downtime = parseDuration(args[1]);
+        simulator.at(when, [&simulator, fraction, downtime] {
+          simulator.churn(fraction, downtime);
+        });
+      }
+      else if (action == "partition") {
+        require(2);
+        auto [first, last] = parseNodes(args[0], simulator.size());
+        uint32_t partition = static_cast<uint32_t>(std::stoul(args[1]));
+        simulator.at(when, [&simulator, first = first, last = last, partition] {
+          for (size_t node = first; node <= last; ++node) {
+            simulator.partition(node, partition);
+          }
+        });
+      }
+      else if (action == "heal") {
+        simulator.at(when, [&simulator] { simulator.heal(); });
+      }
+      else if (action == "loss") {
+        require(1);
+        link.lossRate = std::stod(args[0]);
+        simulator.at(when, [&simulator, link] { simulator.getNetwork().setLinkOptions(link); });
+      }
+      else {
+        throw std::invalid_argument("unknown action " + action);
+      }
+    }
+    catch (const std::logic_error& e) {
+      throw std::runtime_error("line " + std::to_string(lineNo) + ": " + e.what());
+    }
+  }
+}
+
+int
+main(int argc, char* argv[])
+{
+  SimulatorOptions options;
+  std::string scriptPath;
+  std::string nodesCsvPath;
+  std::string metricsPath;
+  std::string groupName;
+  std::string duration;
+  std::string latency;
+  std::string jitter;
+  std::string tick;
+  size_t nPublishers = 1;
+
+  po::options_description description("Options");
+  description.add_options()
+    ("help,h", "print this help message")
+    ("nodes,n", po::value<size_t>(&options.nNodes)->default_value(options.nNodes),
+     "number of nodes")
+    ("script,s", po::value<std::string>(&scriptPath),
+     "workload script, by default all nodes join and the first --publishers publish")
+    ("publishers,p", po::value<size_t>(&nPublishers)->default_value(nPublishers),
+     "publishing nodes of the default workload")
+    ("duration,d", po::value<std::string>(&duration)->default_value("60s"),
+     "simulated time to run")
+    ("group,g", po::value<std::string>(&groupName)->default_value(options.groupName.toUri()),
+     "service sync group name")
+    ("latency", po::value<std::string>(&latency)->default_value("10ms"), "one-way link delay")
+    ("jitter", po::value<std::string>(&jitter)->default_value("0ms"),
+     "uniform extra link delay")
+    ("loss", po::value<double>(&options.link.lossRate)->default_value(0),
+     "probability that a delivery is dropped")
+    ("seed", po::value<uint64_t>(&options.link.seed)->default_value(options.link.seed),
+     "seed of the link model and of the churn")
+    ("tick", po::value<std::string>(&tick)->default_value("1ms"),
+     "granularity of the simulated clock")
+    ("cache,c", po::value<std::string>(&options.cacheDirectory),
+     "directory of the per-node registry caches, restarted nodes then come back warm")
+    ("nodes-csv", po::value<std::string>(&nodesCsvPath), "write per-node counters as CSV")
+    ("metrics", po::value<std::string>(&metricsPath),
+     "write the metrics of all nodes, with the update latency stages, in the Prometheus "
+     "text format")
+    ("trace-hops", po::bool_switch(&options.discovery.traceHops),
+     "add the publishing node to the hop trace of every publication");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    if (vm.count("help") > 0) {
+      std::cout << "Usage: " << argv[0] << " [options]\n" << description;
+      return 0;
+    }
+    po::notify(vm);
+    options.groupName = groupName;
+    options.link.latency = parseDuration(latency);
+    options.link.jitter = parseDuration(jitter);
+    options.tick = parseDuration(tick);
+    if (options.nNodes == 0 || options.tick <= ndn::time::milliseconds::zero()) {
+      throw po::error("nodes and tick must be positive");
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << "\n" << description;
+    return 2;
+  }
+
+  try {
+    Simulator simulator(options);
+    if (scriptPath.empty()) {
+      std::string script = "at 0s join all over 1s\n";
+      if (nPublishers > 0) {
+        script += "at 2s publish 0-" + std::to_string(std::min(nPublishers, options.nNodes) - 1) +
+                  " /sim/service\n";
+      }
+      std::istringstream is(script);
+      loadScript(is, simulator, options.link);
+    }
+    else {
+      std::ifstream script(scriptPath);
+      if (!script) {
+        throw std::runtime_error("cannot open " + scriptPath);
+      }
+      loadScript(script, simulator, options.link);
+    }
+
+    simulator.run(parseDuration(duration));
+
+    auto report = simulator.getReport();
+    report.writeSummary(std::cout);
+    if (!nodesCsvPath.empty()) {
+      std::ofstream csv(nodesCsvPath);
+      report.writeNodes(csv);
+    }
+    if (!metricsPath.empty() && !simulator.getMetrics().dump(metricsPath)) {
+      throw std::runtime_error("cannot write " + metricsPath);
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
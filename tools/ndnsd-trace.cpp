@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Prints the events of a trace file written by ndnsd --trace-file, one line each.
+
+#include "ndnsd/discovery/trace-log.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace ndnsd::discovery;
+
+int
+main(int argc, char* argv[])
+{
+  if (argc != 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0) {
+    std::cerr << "Usage: " << argv[0] << " <trace-file>\n";
+    return 2;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  char magic[sizeof(TraceLog::FILE_MAGIC)];
+  if (!file.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, TraceLog::FILE_MAGIC, sizeof(magic)) != 0) {
+    std::cerr << "ERROR: " << argv[1] << " is not a trace file" << std::endl;
+    return 1;
+  }
+
+  TraceRecord record;
+  while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+    std::cout << TraceLog::format(record) << '\n';
+  }
+  if (file.gcount() != 0) {
+    // the daemon was stopped in the middle of a write
+    std::cerr << "WARNING: ignoring a truncated record at the end" << std::endl;
+  }
+  return 0;
+}
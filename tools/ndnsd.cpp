@@ -0,0 +1,217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2014-2020,  The University of Memphis
+ *
+ * This file is part of NDNSD.
+ * Author: Saurab Dulal (sdulal@memphis.edu)
+ *
+ * NDNSD is free software: you can redistribute it and/or modify it under the terms
+ * of the GNU Lesser General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * NDNSD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * NDNSD, e.g., in COPYING.md file.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+// Host-local daemon: takes part in the service group once for the host, publishes the
+// services local applications send on its Unix socket and shares the received ones in a
+// read-only shared memory registry, see LocalClient.
+
+#include "ndnsd/discovery/local-client.hpp"
+#include "ndnsd/discovery/local-server.hpp"
+#include "ndnsd/discovery/service-discovery.hpp"
+#include "ndnsd/discovery/shared-registry.hpp"
+#include "ndnsd/discovery/trace-log.hpp"
+
+#include <ndn-cxx/util/logger.hpp>
+
+#include <boost/asio/signal_set.hpp>
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <vector>
+
+NDN_LOG_INIT(ndnsd.Daemon);
+
+namespace po = boost::program_options;
+using namespace ndnsd::discovery;
+
+int
+main(int argc, char* argv[])
+{
+  std::string groupName;
+  std::string nodeName;
+  std::string socketPath;
+  std::string sharedRegistryName;
+  std::string metricsPath;
+  size_t metricsInterval = 10;
+  std::string tracePath;
+  size_t traceCapacity = 1 << 16;
+  std::string evictionPolicy = "lru";
+  std::vector<std::string> subscribedServices;
+  std::string parentGroupName;
+  std::string parentNodeName;
+  ServiceDiscoveryOptions options;
+
+  po::options_description description("Options");
+  description.add_options()
+    ("help,h", "print this help message")
+    ("group,g", po::value<std::string>(&groupName)->required(), "service sync group name")
+    ("node,n", po::value<std::string>(&nodeName)->required(), "name of this host in the group")
+    ("socket,s", po::value<std::string>(&socketPath)->default_value(LocalClient::DEFAULT_SOCKET_PATH),
+     "Unix socket for local applications")
+    ("shm,m", po::value<std::string>(&sharedRegistryName)->default_value(LocalClient::DEFAULT_SHARED_REGISTRY),
+     "shared memory registry name")
+    ("cache,c", po::value<std::string>(&options.cacheDirectory),
+     "persistent registry cache directory")
+    ("memory-budget", po::value<size_t>(&options.memoryBudget)->default_value(0),
+     "bytes the received services may take, 0 for no limit; evicted services are recovered "
+     "from --cache when asked for")
+    ("eviction-policy", po::value<std::string>(&evictionPolicy)->default_value(evictionPolicy),
+     "services evicted first over --memory-budget: lru, priority (lowest \"priority\" "
+     "metadata) or expiry (farthest lease end)")
+    ("subscribe", po::value<std::vector<std::string>>(&subscribedServices)->composing(),
+     "fetch only the services under this prefix, can be repeated; all by default")
+    ("adaptive-tuning", po::bool_switch(&options.adaptiveTuning),
+     "tune the republish window, summary interval and resyncs to the observed churn")
+    ("aggregate-into", po::value<std::string>(&parentGroupName),
+     "summarize the services of --group in this parent group and answer their lookups")
+    ("parent-node", po::value<std::string>(&parentNodeName),
+     "name of this host in --aggregate-into, --node by default")
+    ("metrics-file", po::value<std::string>(&metricsPath),
+     "file the metrics are written to in the Prometheus text format, e.g. for the node "
+     "exporter textfile collector")
+    ("metrics-interval", po::value<size_t>(&metricsInterval)->default_value(metricsInterval),
+     "seconds between two writes of --metrics-file")
+    ("trace-file", po::value<std::string>(&tracePath),
+     "file the hot path events are written to in binary instead of being logged, "
+     "read it with ndnsd-trace")
+    ("trace-capacity", po::value<size_t>(&traceCapacity)->default_value(traceCapacity),
+     "events buffered for --trace-file, more are dropped");
+
+  po::variables_map vm;
+  try {
+    po::store(po::parse_command_line(argc, argv, description), vm);
+    if (vm.count("help") > 0) {
+      std::cout << "Usage: " << argv[0] << " -g <syncGroupName> -n <nodeName> [options]\n"
+                << description;
+      return 0;
+    }
+    po::notify(vm);
+    if (metricsInterval == 0) {
+      throw po::error("metrics-interval must be positive");
+    }
+    if (evictionPolicy == "lru") {
+      options.evictionPolicy = EvictionPolicy::LEAST_RECENTLY_USED;
+    }
+    else if (evictionPolicy == "priority") {
+      options.evictionPolicy = EvictionPolicy::LOWEST_PRIORITY;
+    }
+    else if (evictionPolicy == "expiry") {
+      options.evictionPolicy = EvictionPolicy::FARTHEST_EXPIRY;
+    }
+    else {
+      throw po::error("eviction-policy must be lru, priority or expiry");
+    }
+    for (const auto& prefix : subscribedServices) {
+      options.subscriptionFilter.addService(prefix);
+    }
+  }
+  catch (const po::error& e) {
+    std::cerr << "ERROR: " << e.what() << "\n" << description;
+    return 2;
+  }
+
+  try {
+    ndn::Face face;
+    ndn::KeyChain keyChain;
+    ndn::Scheduler scheduler(face.getIoService());
+    SharedRegistryWriter sharedRegistry(sharedRegistryName);
+
+    std::unique_ptr<TraceLog> traceLog;
+    if (!tracePath.empty()) {
+      traceLog = std::make_unique<TraceLog>(traceCapacity);
+      traceLog->startWriter(tracePath);
+      TraceLog::setActive(traceLog.get());
+    }
+
+    // the daemon owns the only ServiceDiscovery of the host, refresh the shared registry
+    // when its registry changed. Every refresh copies the whole registry, so the updates of
+    // a burst are batched into one refresh shortly after the first of them
+    std::unique_ptr<ServiceDiscovery> discovery;
+    uint64_t sharedVersion = 0;
+    auto share = [&] {
+      if (discovery && discovery->getRegistryVersion() != sharedVersion) {
+        sharedVersion = discovery->getRegistryVersion();
+        sharedRegistry.update(discovery->getRegistry());
+      }
+    };
+    ndn::scheduler::ScopedEventId shareUpdatesEvent;
+    bool isShareScheduled = false;
+    auto shareUpdates = [&] (const Details&) {
+      if (isShareScheduled) {
+        return;
+      }
+      isShareScheduled = true;
+      shareUpdatesEvent = scheduler.schedule(ndn::time::milliseconds(100), [&] {
+        isShareScheduled = false;
+        share();
+      });
+    };
+    discovery = std::make_unique<ServiceDiscovery>(groupName, nodeName, face, keyChain,
+                                                   shareUpdates, options);
+    if (!parentGroupName.empty() &&
+        !discovery->aggregateInto(parentGroupName,
+                                  parentNodeName.empty() ? nodeName : parentNodeName)) {
+      throw std::invalid_argument("cannot aggregate " + groupName + " into " + parentGroupName);
+    }
+
+    // expiries, heartbeats and evictions do not trigger the callback
+    ndn::scheduler::ScopedEventId shareEvent;
+    std::function<void()> shareExpired = [&] {
+      share();
+      shareEvent = scheduler.schedule(ndn::time::seconds(1), shareExpired);
+    };
+    shareExpired();
+
+    ndn::scheduler::ScopedEventId metricsEvent;
+    std::function<void()> dumpMetrics = [&] {
+      discovery->getMetrics().dump(metricsPath);
+      metricsEvent = scheduler.schedule(ndn::time::seconds(metricsInterval), dumpMetrics);
+    };
+    if (!metricsPath.empty()) {
+      dumpMetrics();
+    }
+
+    LocalServer server(face.getIoService(), socketPath, [&] (const Details& details) {
+      NDN_LOG_DEBUG("Publishing local service " << details.serviceName);
+      discovery->publishServiceDetail(details);
+    });
+    server.start();
+
+    boost::asio::signal_set signals(face.getIoService(), SIGINT, SIGTERM);
+    signals.async_wait([&] (const boost::system::error_code& ec, int) {
+      if (!ec) {
+        NDN_LOG_INFO("Stopping");
+        face.getIoService().stop();
+      }
+    });
+
+    NDN_LOG_INFO("Serving group " << groupName << " as " << nodeName);
+    face.processEvents();
+    if (traceLog && traceLog->getDropCount() > 0) {
+      NDN_LOG_WARN(traceLog->getDropCount() << " trace events were dropped, "
+                   "consider a larger --trace-capacity");
+    }
+  }
+  catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    NDN_LOG_ERROR(e.what());
+    return 1;
+  }
+  return 0;
+}